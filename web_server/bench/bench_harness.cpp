@@ -0,0 +1,104 @@
+#include "bench_harness.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace {
+    std::atomic<size_t> allocations{0};
+    size_t repetitions = 5;
+    
+    // Wall time of one repetition, from the moment all threads are released
+    double timeRepetition(size_t threads, size_t iterations, const Bench::Body& body) {
+        if (threads == 1) {
+            auto started = std::chrono::steady_clock::now();
+            body(0, iterations);
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+        }
+        
+        std::atomic<size_t> ready{0};
+        std::atomic<bool> go{false};
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                ready.fetch_add(1);
+                while (!go.load(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+                body(t, iterations);
+            });
+        }
+        while (ready.load() < threads) {
+            std::this_thread::yield();
+        }
+        
+        auto started = std::chrono::steady_clock::now();
+        go.store(true, std::memory_order_release);
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+    }
+}
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace Bench {
+    size_t allocationCount() {
+        return allocations.load(std::memory_order_relaxed);
+    }
+    
+    void setRepetitions(size_t count) {
+        repetitions = std::max<size_t>(count, 1);
+    }
+    
+    Result run(const std::string& name, size_t threads, size_t iterations, const Body& body) {
+        timeRepetition(threads, iterations, body);
+        
+        std::vector<double> times;
+        times.reserve(repetitions);
+        size_t allocations_before = allocationCount();
+        for (size_t r = 0; r < repetitions; ++r) {
+            times.push_back(timeRepetition(threads, iterations, body));
+        }
+        size_t allocated = allocationCount() - allocations_before;
+        
+        std::sort(times.begin(), times.end());
+        double median = times[times.size() / 2];
+        double ops = static_cast<double>(threads) * static_cast<double>(iterations);
+        
+        Result result;
+        result.ns_per_op = median * static_cast<double>(threads) / ops;
+        result.allocations_per_op = static_cast<double>(allocated) / (ops * static_cast<double>(repetitions));
+        result.ops_per_sec = ops / (median / 1e9);
+        result.spread_percent = (times.back() - times.front()) / median * 100.0;
+        
+        std::printf("%-40s %7zu %11.1f %11.2f %14.0f %8.1f%%\n", name.c_str(), threads, result.ns_per_op,
+                    result.allocations_per_op, result.ops_per_sec, result.spread_percent);
+        std::fflush(stdout);
+        return result;
+    }
+    
+    void printHeader() {
+        std::printf("%-40s %7s %11s %11s %14s %9s\n", "benchmark", "threads", "ns/op", "allocs/op", "ops/s",
+                    "spread");
+    }
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <string>
+#include <functional>
+#include <cstddef>
+
+// Small harness shared by the microbenchmarks. A case is run once to warm
+// up and then for a number of timed repetitions; the report shows the
+// median, so one noisy repetition does not move the numbers. Heap
+// allocations are counted by replacing the global operator new.
+namespace Bench {
+    struct Result {
+        double ns_per_op;           // Wall time per operation and thread
+        double allocations_per_op;
+        double ops_per_sec;         // Over all threads
+        double spread_percent;      // Slowest minus fastest repetition, relative to the median
+    };
+    
+    // Body of a case: perform iterations operations on thread number thread
+    using Body = std::function<void(size_t thread, size_t iterations)>;
+    
+    // Heap allocations made so far, by all threads
+    size_t allocationCount();
+    
+    void setRepetitions(size_t repetitions);
+    
+    // Run body on threads threads at once, each doing iterations operations,
+    // print a report line and return it
+    Result run(const std::string& name, size_t threads, size_t iterations, const Body& body);
+    
+    void printHeader();
+    
+    // Keep the compiler from discarding a computed value
+    template <typename T>
+    inline void doNotOptimize(const T& value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+}
+
+#endif // BENCH_HARNESS_H
\ No newline at end of file
@@ -0,0 +1,205 @@
+// Microbenchmarks for the hot paths: protocol encoding and parsing, the
+// cache under contention and the logger. Run with --help for the options.
+#include "bench_harness.h"
+#include <common/protocol.h>
+#include <common/logger.h>
+#include <server/data_cache.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+    const char* BENCH_LOG_FILE = "microbench_log.txt";
+    const size_t CACHE_ENTRIES = 1000;
+    const size_t CACHE_SHARDS = 8;
+    
+    struct Options {
+        std::string filter;
+        size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+        double scale = 1.0;
+    };
+    
+    Options options;
+    
+    bool selected(const std::string& name) {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    }
+    
+    size_t scaled(size_t iterations) {
+        return std::max<size_t>(1, static_cast<size_t>(static_cast<double>(iterations) * options.scale));
+    }
+    
+    // 1, 2, 4, ... up to max_threads, which is always included
+    std::vector<size_t> threadCounts() {
+        std::vector<size_t> counts;
+        for (size_t threads = 1; threads < options.max_threads; threads *= 2) {
+            counts.push_back(threads);
+        }
+        counts.push_back(options.max_threads);
+        return counts;
+    }
+    
+    void runCase(const std::string& name, size_t threads, size_t iterations, const Bench::Body& body) {
+        if (selected(name)) {
+            Bench::run(name, threads, iterations, body);
+        }
+    }
+    
+    void protocolCases() {
+        const std::string_view methods[] = {"GET", "post", "Post", "PUT"};
+        runCase("protocol/parseMethod", 1, scaled(20000000), [&](size_t, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                Bench::doNotOptimize(Protocol::parseMethod(methods[i % 4]));
+            }
+        });
+        
+        const std::string_view paths[] = {"/status", "/data", "/stats", "/data/search", "/missing"};
+        runCase("protocol/pathToId", 1, scaled(20000000), [&](size_t, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                Bench::doNotOptimize(Protocol::pathToId(paths[i % 5]));
+            }
+        });
+        
+        const std::string requests[] = {
+            "GET /status",
+            "GET /data?since=1200&limit=100",
+            "POST /data temperature=21.5 humidity=40 station=north-ridge-07",
+        };
+        runCase("protocol/parseRequest", 1, scaled(10000000), [&](size_t, size_t count) {
+            Protocol::Method method;
+            std::string_view target, payload;
+            for (size_t i = 0; i < count; ++i) {
+                Bench::doNotOptimize(Protocol::parseRequest(requests[i % 3], method, target, payload));
+            }
+        });
+        
+        const std::string path(Protocol::PATH_DATA);
+        const std::string payload = "temperature=21.5 humidity=40 station=north-ridge-07";
+        runCase("protocol/formatRequest", 1, scaled(2000000), [&](size_t, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                Bench::doNotOptimize(Protocol::formatRequest(Protocol::Method::POST, path, payload));
+            }
+        });
+        runCase("protocol/encodeBinaryRequest", 1, scaled(5000000), [&](size_t, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                Bench::doNotOptimize(Protocol::encodeBinaryRequest(Protocol::Method::POST, path, payload));
+            }
+        });
+    }
+    
+    void cacheCases() {
+        const std::string entry(64, 'x');
+        
+        // Every thread appends to the same cache; eviction keeps it bounded
+        for (size_t threads : threadCounts()) {
+            DataCache cache(CACHE_SHARDS, 16 * 1024 * 1024);
+            runCase("cache/addData", threads, scaled(1000000), [&](size_t, size_t count) {
+                for (size_t i = 0; i < count; ++i) {
+                    Bench::doNotOptimize(cache.addData(entry));
+                }
+            });
+        }
+        
+        // One op is a batch of 64 entries: compare with 64 addData calls
+        const std::vector<std::string_view> batch(64, entry);
+        for (size_t threads : threadCounts()) {
+            DataCache cache(CACHE_SHARDS, 16 * 1024 * 1024);
+            runCase("cache/addBatch(64)", threads, scaled(20000), [&](size_t, size_t count) {
+                uint64_t first_seq = 0;
+                uint64_t last_seq = 0;
+                for (size_t i = 0; i < count; ++i) {
+                    Bench::doNotOptimize(cache.addBatch(batch, first_seq, last_seq));
+                }
+            });
+        }
+        
+        DataCache cache(CACHE_SHARDS);
+        for (size_t i = 0; i < CACHE_ENTRIES; ++i) {
+            cache.addData("sensor-" + std::to_string(i) + " " + entry);
+        }
+        for (size_t threads : threadCounts()) {
+            runCase("cache/getData(1000)", threads, scaled(500), [&](size_t, size_t count) {
+                for (size_t i = 0; i < count; ++i) {
+                    Bench::doNotOptimize(cache.getData().size());
+                }
+            });
+        }
+        for (size_t threads : threadCounts()) {
+            runCase("cache/readSince(100)", threads, scaled(50000), [&](size_t, size_t count) {
+                for (size_t i = 0; i < count; ++i) {
+                    Bench::doNotOptimize(cache.readSince(CACHE_ENTRIES - 100, 100).entries.size());
+                }
+            });
+        }
+    }
+    
+    void loggerCases() {
+        const std::string message = "Client 127.0.0.1:50412 sent GET /data?since=1200&limit=100";
+        
+        // Producers only enqueue; the writer thread drains in the background,
+        // so the queue may overflow and drop records at high thread counts
+        size_t dropped_before = Logger::getDroppedRecords();
+        for (size_t threads : threadCounts()) {
+            runCase("logger/logMessage", threads, scaled(100000), [&](size_t, size_t count) {
+                for (size_t i = 0; i < count; ++i) {
+                    Logger::logMessage(message, BENCH_LOG_FILE);
+                }
+                Logger::flush();
+            });
+        }
+        
+        // Below the runtime level a record costs one atomic load
+        runCase("logger/debug(filtered)", 1, scaled(50000000), [&](size_t, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                Logger::debug("Client ", i, " sent ", message);
+            }
+        });
+        
+        size_t dropped = Logger::getDroppedRecords() - dropped_before;
+        if (dropped > 0) {
+            std::printf("logger dropped %zu records while the queue was full\n", dropped);
+        }
+        unlink(BENCH_LOG_FILE);
+    }
+    
+    void printUsage(const char* program) {
+        std::printf("Usage: %s [options]\n", program);
+        std::printf("  --filter TEXT       Only run benchmarks whose name contains TEXT\n");
+        std::printf("  --repetitions N     Timed repetitions per benchmark (default: 5)\n");
+        std::printf("  --max-threads N     Highest thread count for contended cases (default: cores)\n");
+        std::printf("  --scale X           Multiply the iteration counts by X (default: 1)\n");
+    }
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--filter" && has_value) {
+            options.filter = argv[++i];
+        } else if (arg == "--repetitions" && has_value) {
+            Bench::setRepetitions(std::strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--max-threads" && has_value) {
+            options.max_threads = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--scale" && has_value) {
+            options.scale = std::atof(argv[++i]);
+        } else {
+            printUsage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+    if (options.scale <= 0) {
+        std::fprintf(stderr, "--scale must be positive\n");
+        return 1;
+    }
+    
+    Bench::printHeader();
+    protocolCases();
+    cacheCases();
+    loggerCases();
+    return 0;
+}
\ No newline at end of file
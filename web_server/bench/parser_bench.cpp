@@ -0,0 +1,140 @@
+// Request parser microbenchmark: the original istringstream parser against
+// Protocol::parseRequest, reporting time and heap allocations per request.
+#include "bench_harness.h"
+#include <common/protocol.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    // The parser as it was before requests were split in place
+    namespace Legacy {
+        Protocol::Method parseMethod(const std::string& methodStr) {
+            std::string upperMethod = methodStr;
+            std::transform(upperMethod.begin(), upperMethod.end(), upperMethod.begin(), ::toupper);
+            
+            if (upperMethod == "GET") {
+                return Protocol::Method::GET;
+            } else if (upperMethod == "POST") {
+                return Protocol::Method::POST;
+            } else {
+                return Protocol::Method::UNKNOWN;
+            }
+        }
+        
+        bool parseRequest(const std::string& request, Protocol::Method& method,
+                          std::string& path, std::string& payload) {
+            std::istringstream request_stream(request);
+            std::string method_str;
+            
+            if (!(request_stream >> method_str >> path)) {
+                return false;
+            }
+            
+            method = parseMethod(method_str);
+            if (method == Protocol::Method::UNKNOWN) {
+                return false;
+            }
+            
+            std::getline(request_stream, payload);
+            if (!payload.empty() && payload[0] == ' ') {
+                payload = payload.substr(1);
+            }
+            
+            return true;
+        }
+        
+        Protocol::PathId pathToId(const std::string& path) {
+            if (path == Protocol::PATH_STATUS) {
+                return Protocol::PathId::STATUS;
+            } else if (path == Protocol::PATH_DATA) {
+                return Protocol::PathId::DATA;
+            } else if (path == Protocol::PATH_SHUTDOWN) {
+                return Protocol::PathId::SHUTDOWN;
+            } else if (path == Protocol::PATH_STATS) {
+                return Protocol::PathId::STATS;
+            } else if (path == Protocol::PATH_DATA_SEARCH) {
+                return Protocol::PathId::DATA_SEARCH;
+            }
+            return Protocol::PathId::UNKNOWN;
+        }
+    }
+    
+    const size_t DEFAULT_ITERATIONS = 2000000;
+    
+    // Request lines as they sit in the receive buffer, delimiter stripped
+    std::vector<std::string> sampleRequests() {
+        return {
+            "GET /status",
+            "get /stats",
+            "GET /data?since=1200&limit=100",
+            "GET /data/search?contains=sensor%2042&limit=50",
+            "POST /data temperature=21.5 humidity=40 station=north-ridge-07",
+            "POST /data " + std::string(200, 'x'),
+            "PUT /data nope",
+            "GET /unknown",
+        };
+    }
+    
+    // Path id plus payload length, or 0 for a rejected request
+    size_t parseLegacy(const std::string& request) {
+        Protocol::Method method;
+        std::string path, payload;
+        if (!Legacy::parseRequest(request, method, path, payload)) {
+            return 0;
+        }
+        std::string::size_type query = path.find('?');
+        return static_cast<size_t>(Legacy::pathToId(path.substr(0, query))) + payload.size();
+    }
+    
+    size_t parseCurrent(const std::string& request) {
+        Protocol::Method method;
+        std::string_view target, path, query, payload;
+        if (!Protocol::parseRequest(request, method, target, payload)) {
+            return 0;
+        }
+        Protocol::splitQuery(target, path, query);
+        return static_cast<size_t>(Protocol::pathToId(path)) + payload.size();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : DEFAULT_ITERATIONS;
+    if (iterations == 0) {
+        std::fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+    
+    std::vector<std::string> requests = sampleRequests();
+    
+    // Both parsers must agree on every sample
+    for (const std::string& request : requests) {
+        if (parseLegacy(request) != parseCurrent(request)) {
+            std::fprintf(stderr, "Parsers disagree on \"%s\"\n", request.c_str());
+            return 1;
+        }
+    }
+    
+    std::printf("%zu distinct request lines\n", requests.size());
+    Bench::printHeader();
+    Bench::Result legacy = Bench::run("parser/istringstream", 1, iterations, [&](size_t, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            Bench::doNotOptimize(parseLegacy(requests[i % requests.size()]));
+        }
+    });
+    Bench::Result current = Bench::run("parser/string_view", 1, iterations, [&](size_t, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            Bench::doNotOptimize(parseCurrent(requests[i % requests.size()]));
+        }
+    });
+    std::printf("speedup %.1fx\n", legacy.ns_per_op / current.ns_per_op);
+    
+    if (current.allocations_per_op != 0) {
+        std::fprintf(stderr, "string_view parser allocated on the heap\n");
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
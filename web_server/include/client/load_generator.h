@@ -0,0 +1,68 @@
+#ifndef LOAD_GENERATOR_H
+#define LOAD_GENERATOR_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <chrono>
+#include <cstdint>
+#include <common/protocol.h>
+#include <common/latency_histogram.h>
+
+// Settings of one benchmark run
+struct BenchConfig {
+    std::string host = Protocol::DEFAULT_HOST;
+    std::string port = Protocol::DEFAULT_PORT;
+    size_t connections = 16;
+    size_t threads = 2;
+    uint64_t duration_s = 10;
+    uint64_t warmup_s = 1;          // Requests sent during warmup are not measured
+    uint64_t rate = 0;              // Requests per second over all connections; 0 = closed loop
+    size_t payload_size = 64;       // Bytes per POST /data
+    unsigned post_percent = 50;     // Share of POST /data; the rest is GET /status
+    Protocol::Encoding encoding = Protocol::Encoding::TEXT;
+    uint32_t seed = 1;              // Seeds the request mix and payload bytes
+};
+
+struct BenchResult {
+    uint64_t requests = 0;          // Responses to measured requests
+    uint64_t errors = 0;            // Of those, non-2xx responses
+    uint64_t unfinished = 0;        // Measured requests still unanswered at the end
+    uint64_t failed_connections = 0;
+    double elapsed_s = 0;           // Length of the measured interval
+    LatencyHistogram latency_ns;
+};
+
+// Load generator behind "client bench". Each thread drives its share of
+// the connections through one poll loop with non-blocking sockets.
+//
+// Closed loop: every connection keeps one request outstanding and sends the
+// next as soon as the response arrives, which measures peak throughput.
+// Open loop: every connection sends on a fixed schedule whether or not
+// earlier responses have arrived, pipelining when the server lags. Latency
+// is measured from the scheduled send time, so a stalled server shows up
+// as latency instead of silently lowering the request rate (coordinated
+// omission).
+class LoadGenerator {
+public:
+    explicit LoadGenerator(const BenchConfig& config);
+    
+    // Connect, run warmup and measurement, and collect the results. Returns
+    // false if the connections cannot be opened.
+    bool run(BenchResult& result);
+    
+    static void printReport(const BenchConfig& config, const BenchResult& result, std::ostream& out);
+    static std::string toJson(const BenchConfig& config, const BenchResult& result);
+    
+private:
+    BenchConfig config_;
+    
+    // Blocking connect, then switch to non-blocking with Nagle disabled
+    int openConnection() const;
+    
+    // Drive sockets, numbered from first_connection, until the run ends
+    void runThread(size_t index, const std::vector<int>& sockets, size_t first_connection,
+                   std::chrono::steady_clock::time_point start, BenchResult& result) const;
+};
+
+#endif // LOAD_GENERATOR_H
\ No newline at end of file
@@ -2,7 +2,10 @@
 #define TCP_CLIENT_H
 
 #include <string>
+#include <vector>
+#include <functional>
 #include <common/protocol.h>
+#include <common/input_buffer.h>
 
 class TCPClient {
 public:
@@ -13,14 +16,39 @@ public:
     
     bool connect();
     void disconnect();
+    
+    // Send a request and wait for its response. The connection is kept open
+    // and reused by later calls; returns an empty string on failure.
     std::string sendRequest(Protocol::Method method, const std::string& path, const std::string& payload = "");
     
+    // Pipelining: queued requests are sent back to back by flush(), which
+    // hands the responses over in request order. At most the pipeline
+    // window of requests is unanswered at a time, which bounds the memory
+    // held in socket buffers on both ends.
+    using ResponseHandler = std::function<void(size_t index, const std::string& response)>;
+    void queueRequest(Protocol::Method method, const std::string& path, const std::string& payload = "");
+    size_t getQueuedRequests() const { return pipeline_.size(); }
+    
+    // Send every queued request and deliver each response with its index in
+    // the queue. Requests are not retried: if the connection fails, the
+    // responses received so far have been delivered, the rest of the queue
+    // is dropped and false is returned.
+    bool flush(const ResponseHandler& handler);
+    bool flush(std::vector<std::string>& responses);
+    
+    void setPipelineWindow(size_t requests) { pipeline_window_ = requests > 0 ? requests : 1; }
+    size_t getPipelineWindow() const { return pipeline_window_; }
+    
     // Auto-reconnection settings
     void setAutoReconnect(bool enabled) { auto_reconnect_ = enabled; }
     bool getAutoReconnect() const { return auto_reconnect_; }
     void setReconnectAttempts(int attempts) { max_reconnect_attempts_ = attempts; }
     int getReconnectAttempts() const { return max_reconnect_attempts_; }
     
+    // Wire encoding used for requests (responses come back in the same one)
+    void setEncoding(Protocol::Encoding encoding) { encoding_ = encoding; }
+    Protocol::Encoding getEncoding() const { return encoding_; }
+    
 private:
     std::string host_;
     std::string port_;
@@ -28,9 +56,21 @@ private:
     bool connected_;
     bool auto_reconnect_;
     int max_reconnect_attempts_;
+    Protocol::Encoding encoding_;
+    
+    // Bytes received past the end of the last response
+    InputBuffer recv_buffer_;
+    
+    // Encoded requests waiting for flush()
+    std::vector<std::string> pipeline_;
+    size_t pipeline_window_;
     
     bool isConnected() const { return connected_; }
     bool tryReconnect();
+    std::string encodeRequest(Protocol::Method method, const std::string& path, const std::string& payload) const;
+    bool sendAll(const std::string& data);
+    bool receiveResponse(std::string& response);
+    bool extractResponse(std::string& response);
 };
 
 #endif // TCP_CLIENT_H 
\ No newline at end of file
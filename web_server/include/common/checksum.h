@@ -0,0 +1,11 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32 (IEEE 802.3, as used by zlib). Pass a previous result as crc to
+// checksum data that arrives in pieces.
+uint32_t crc32(const void* data, size_t length, uint32_t crc = 0);
+
+#endif // CHECKSUM_H
\ No newline at end of file
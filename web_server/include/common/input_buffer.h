@@ -0,0 +1,49 @@
+#ifndef INPUT_BUFFER_H
+#define INPUT_BUFFER_H
+
+#include <string_view>
+#include <memory>
+#include <cstddef>
+#include <sys/types.h>
+
+// Growable per-connection receive buffer. Bytes are read straight from the
+// socket into one contiguous region, so a frame that arrives over several
+// reads can be parsed in place through string_views without copying it.
+// Consumed bytes are reclaimed by compacting the unread tail to the front.
+class InputBuffer {
+public:
+    explicit InputBuffer(size_t max_message_size);
+    
+    // Read once from a socket. Returns the recv() result; fails with
+    // EMSGSIZE when the buffer already holds more than a maximal message.
+    ssize_t readFrom(int fd);
+    
+    // Copy bytes received by other means, such as a kernel-provided buffer.
+    // Returns the bytes taken: fewer than length once the buffer holds more
+    // than a maximal message.
+    size_t append(const char* data, size_t length);
+    
+    // Unconsumed bytes, valid until the next read or consume
+    std::string_view data() const;
+    
+    // Drop bytes from the front once they have been parsed
+    void consume(size_t length);
+    
+    void clear();
+    size_t size() const;
+    bool empty() const;
+    size_t capacity() const;
+    size_t getMaxMessageSize() const;
+    
+private:
+    std::unique_ptr<char[]> buffer_;
+    size_t capacity_;
+    size_t read_pos_;
+    size_t write_pos_;
+    size_t max_message_size_;
+    
+    // Make room for at least min_free bytes after write_pos_, up to the limit
+    size_t reserve(size_t min_free);
+};
+
+#endif // INPUT_BUFFER_H
\ No newline at end of file
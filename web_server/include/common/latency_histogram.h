@@ -0,0 +1,44 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Log-linear histogram in the style of HdrHistogram: values below 128 get
+// a bucket each, larger ones fall into 64 buckets per power of two, so any
+// recorded value is reported within 1.6% over the whole uint64_t range.
+// Recording is a few instructions and never allocates. Not thread-safe;
+// give each thread its own histogram and merge them.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+    
+    void record(uint64_t value);
+    
+    // Add every value recorded in other
+    void merge(const LatencyHistogram& other);
+    
+    void reset();
+    
+    uint64_t getCount() const;
+    uint64_t getMin() const;
+    uint64_t getMax() const;
+    double getMean() const;
+    
+    // Smallest value that percentile percent of the recorded values do not
+    // exceed, reported as the upper end of its bucket (0 when empty)
+    uint64_t getPercentile(double percentile) const;
+    
+private:
+    std::vector<uint64_t> counts_;
+    uint64_t count_;
+    uint64_t min_;
+    uint64_t max_;
+    double sum_;
+    
+    static size_t bucketIndex(uint64_t value);
+    static uint64_t bucketUpperBound(size_t index);
+};
+
+#endif // LATENCY_HISTOGRAM_H
\ No newline at end of file
@@ -2,16 +2,118 @@
 #define LOGGER_H
 
 #include <string>
-#include <mutex>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <atomic>
+#include <cstddef>
 
+enum class LogLevel {
+    TRACE = 0,
+    DEBUG = 1,
+    INFO = 2,
+    WARN = 3,
+    ERROR = 4
+};
+
+// Levels below this threshold are compiled out entirely. Set it with
+// -DWEBSERVER_LOG_LEVEL=<level> at configure time.
+#ifndef WEBSERVER_LOG_MIN_LEVEL
+#define WEBSERVER_LOG_MIN_LEVEL 0
+#endif
+
+// Asynchronous logger. Callers only append a record to a bounded lock-free
+// queue; a background thread keeps the log files open, formats timestamps
+// and writes records in batches. If the queue stays full for a moment the
+// record is dropped and counted rather than blocking the caller.
+//
+// The level helpers take the message as a list of pieces that are only
+// concatenated once the level is known to be enabled. A piece may be a
+// string, a number, a character or a callable returning one of those, so
+// expensive details (e.g. a getpeername() lookup) can be deferred:
+//
+//     Logger::debug("Request received from ", [&] { return getClientIP(); });
 class Logger {
 public:
+    static constexpr LogLevel COMPILED_MIN_LEVEL = static_cast<LogLevel>(WEBSERVER_LOG_MIN_LEVEL);
+    
     static void logMessage(const std::string& msg, const std::string& logFile = "log.txt");
     static void logError(const std::string& msg, const std::string& logFile = "log.txt");
     
+    // Records below the runtime level are discarded before formatting
+    static void setLevel(LogLevel level);
+    static LogLevel getLevel();
+    
+    static bool isEnabled(LogLevel level) {
+        return level >= COMPILED_MIN_LEVEL &&
+               static_cast<int>(level) >= runtime_level_.load(std::memory_order_relaxed);
+    }
+    
+    template <LogLevel Level, typename... Args>
+    static void log(Args&&... args) {
+        if constexpr (Level >= COMPILED_MIN_LEVEL) {
+            if (!isEnabled(Level)) {
+                return;
+            }
+            std::string message;
+            (appendPiece(message, std::forward<Args>(args)), ...);
+            write(Level, std::move(message));
+        }
+    }
+    
+    template <typename... Args>
+    static void trace(Args&&... args) { log<LogLevel::TRACE>(std::forward<Args>(args)...); }
+    
+    template <typename... Args>
+    static void debug(Args&&... args) { log<LogLevel::DEBUG>(std::forward<Args>(args)...); }
+    
+    template <typename... Args>
+    static void info(Args&&... args) { log<LogLevel::INFO>(std::forward<Args>(args)...); }
+    
+    template <typename... Args>
+    static void warn(Args&&... args) { log<LogLevel::WARN>(std::forward<Args>(args)...); }
+    
+    template <typename... Args>
+    static void error(Args&&... args) { log<LogLevel::ERROR>(std::forward<Args>(args)...); }
+    
+    // Parse "trace", "debug", "info", "warn" or "error"
+    static bool parseLevel(const std::string& name, LogLevel& level);
+    static const char* levelToString(LogLevel level);
+    
+    // Block until every record logged so far has been written
+    static void flush();
+    
+    // Drain the queue, close the files and stop the writer thread. Later
+    // records are written synchronously. Registered with atexit().
+    static void shutdown();
+    
+    // Records waiting to be written
+    static size_t getQueueDepth();
+    
+    // Records discarded because the queue was full
+    static size_t getDroppedRecords();
+    
 private:
-    static std::mutex log_mutex_;
-    static std::string getCurrentTimestamp();
+    static inline std::atomic<int> runtime_level_{static_cast<int>(LogLevel::INFO)};
+    
+    // Hand a formatted record to the writer; errors are echoed to stderr
+    static void write(LogLevel level, std::string&& message);
+    
+    template <typename T>
+    static void appendPiece(std::string& out, T&& piece) {
+        using Piece = std::decay_t<T>;
+        if constexpr (std::is_invocable_v<Piece&>) {
+            appendPiece(out, piece());
+        } else if constexpr (std::is_same_v<Piece, char>) {
+            out += piece;
+        } else if constexpr (std::is_same_v<Piece, bool>) {
+            out += piece ? "true" : "false";
+        } else if constexpr (std::is_arithmetic_v<Piece>) {
+            out += std::to_string(piece);
+        } else {
+            out += std::string_view(piece);
+        }
+    }
 };
 
-#endif // LOGGER_H 
\ No newline at end of file
+#endif // LOGGER_H
\ No newline at end of file
@@ -2,12 +2,32 @@
 #define PROTOCOL_H
 
 #include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
 
 namespace Protocol {
     // Default server configuration
     const std::string DEFAULT_HOST = "127.0.0.1";
     const std::string DEFAULT_PORT = "8080";
     const int DEFAULT_BUFLEN = 512;
+    const size_t DEFAULT_MAX_MESSAGE_SIZE = 8 * 1024 * 1024;
+    
+    // Requests a pipelining client keeps unanswered at most
+    const size_t DEFAULT_PIPELINE_WINDOW = 128;
+    
+    // Cursor reads (GET /data?since=&limit=): entries per response by
+    // default and at most, and the payload bytes after which a response stops
+    const size_t DEFAULT_READ_LIMIT = 100;
+    const size_t MAX_READ_LIMIT = 1000;
+    const size_t MAX_READ_BYTES = 1024 * 1024;
+    
+    // Records one POST /data/batch may carry
+    const size_t MAX_BATCH_RECORDS = 65536;
+    
+    // Requests and responses are newline-delimited so one connection can carry many
+    const char FRAME_DELIMITER = '\n';
     
     // HTTP-like methods
     enum class Method {
@@ -19,17 +39,147 @@ namespace Protocol {
     // Standard responses
     const std::string RESPONSE_STATUS_OK = "200 OK – Server running";
     const std::string RESPONSE_DATA_CREATED = "201 Created – Data received";
+    const std::string RESPONSE_BATCH_CREATED = "201 Created – ";
+    const std::string RESPONSE_SUBSCRIBED = "200 OK – Subscribed; next=";
+    const std::string RESPONSE_BAD_REQUEST = "400 Bad Request";
     const std::string RESPONSE_NOT_FOUND = "404 Not Found";
+    const std::string RESPONSE_PAYLOAD_TOO_LARGE = "413 Payload Too Large";
+    const std::string RESPONSE_TOO_MANY_REQUESTS = "429 Too Many Requests";
+    const std::string RESPONSE_SERVER_BUSY = "503 Service Unavailable – Server busy";
+    const std::string RESPONSE_SHUTTING_DOWN = "200 OK - Server shutting down";
+    
+    // Standard paths; views so the path lookup table is built at compile time
+    constexpr std::string_view PATH_STATUS = "/status";
+    constexpr std::string_view PATH_DATA = "/data";
+    constexpr std::string_view PATH_SHUTDOWN = "/shutdown";
+    constexpr std::string_view PATH_STATS = "/stats";
+    constexpr std::string_view PATH_DATA_SEARCH = "/data/search";
+    constexpr std::string_view PATH_METRICS = "/metrics";
+    constexpr std::string_view PATH_DATA_BATCH = "/data/batch";
+    constexpr std::string_view PATH_DATA_SUBSCRIBE = "/data/subscribe";
+    
+    // Wire encodings; the server tells them apart by the first byte of each frame
+    enum class Encoding {
+        TEXT,
+        BINARY
+    };
     
-    // Standard paths
-    const std::string PATH_STATUS = "/status";
-    const std::string PATH_DATA = "/data";
-    const std::string PATH_SHUTDOWN = "/shutdown";
+    // Binary TLV framing. Every frame is a fixed header followed by
+    // payload_length raw bytes. Header layout (multi-byte fields big-endian):
+    //   [0] magic  [1] version  [2] opcode  [3] flags
+    //   [4..5] path id (status code in responses)  [6..7] reserved
+    //   [8..11] payload length
+    const uint8_t BINARY_MAGIC = 0xB7;     // Never the first byte of a text request
+    const uint8_t BINARY_VERSION = 1;
+    const size_t BINARY_HEADER_SIZE = 12;
+    
+    enum class Opcode : uint8_t {
+        GET = 0x01,
+        POST = 0x02,
+        RESPONSE = 0x80
+    };
+    
+    // Numeric ids for the standard paths
+    enum class PathId : uint16_t {
+        UNKNOWN = 0,
+        STATUS = 1,
+        DATA = 2,
+        SHUTDOWN = 3,
+        STATS = 4,
+        DATA_SEARCH = 5,
+        METRICS = 6,
+        DATA_BATCH = 7,
+        DATA_SUBSCRIBE = 8
+    };
+    
+    struct BinaryHeader {
+        uint8_t version;
+        Opcode opcode;
+        uint8_t flags;
+        uint16_t path_id;
+        uint32_t payload_length;
+    };
     
     // Utility functions
-    Method parseMethod(const std::string& methodStr);
+    Method parseMethod(std::string_view method);
     std::string methodToString(Method method);
     std::string formatRequest(Method method, const std::string& path, const std::string& payload = "");
+    std::string formatResponse(const std::string& response);
+    
+    // Split a text request line "METHOD PATH [PAYLOAD]" without copying:
+    // path and payload are views into request. Returns false if the method
+    // or path is missing or the method is unknown.
+    bool parseRequest(std::string_view request, Method& method, std::string_view& path, std::string_view& payload);
+    
+    // Binary protocol helpers
+    Encoding detectEncoding(uint8_t first_byte);
+    PathId pathToId(std::string_view path);
+    std::string_view idToPath(PathId id);
+    uint16_t responseStatus(std::string_view response);
+    std::string encodeBinaryRequest(Method method, const std::string& path, const std::string& payload = "");
+    std::string encodeBinaryResponse(const std::string& response);
+    
+    // Write a BINARY_HEADER_SIZE-byte frame header to out
+    void writeBinaryHeader(char* out, Opcode opcode, uint16_t id, uint32_t payload_length);
+    
+    // A fixed response framed once for both encodings, so answering with
+    // it needs no formatting or allocation
+    class PreparedResponse {
+    public:
+        explicit PreparedResponse(const std::string& response);
+        
+        // Complete frame: the line plus delimiter, or header plus body
+        std::string_view encoded(Encoding encoding) const;
+        
+        uint16_t getStatus() const;
+        
+    private:
+        std::string text_;
+        std::string binary_;
+        uint16_t status_;
+    };
+    
+    extern const PreparedResponse PREPARED_STATUS_OK;
+    extern const PreparedResponse PREPARED_DATA_CREATED;
+    extern const PreparedResponse PREPARED_BAD_REQUEST;
+    extern const PreparedResponse PREPARED_NOT_FOUND;
+    extern const PreparedResponse PREPARED_PAYLOAD_TOO_LARGE;
+    extern const PreparedResponse PREPARED_TOO_MANY_REQUESTS;
+    extern const PreparedResponse PREPARED_SERVER_BUSY;
+    extern const PreparedResponse PREPARED_SHUTTING_DOWN;
+    
+    // Decode a header from the start of data. Returns false if fewer than
+    // BINARY_HEADER_SIZE bytes are available or the magic byte is wrong.
+    bool decodeBinaryHeader(std::string_view data, BinaryHeader& header);
+    
+    // Find the response frame at the start of data, in either encoding.
+    // Returns false until it is complete; then body is the response line
+    // (text) or payload (binary) and frame_length the bytes to consume.
+    bool nextResponseFrame(std::string_view data, std::string_view& body, size_t& frame_length);
+    
+    // POST /data/batch payload: "COUNT LEN:DATA LEN:DATA ...", the same in
+    // both encodings. LEN is the byte length of DATA, so records may hold
+    // spaces (and, in binary frames, any byte). Returns false unless exactly
+    // COUNT well-formed records (1..MAX_BATCH_RECORDS) fill the payload.
+    bool parseBatch(std::string_view payload, std::vector<std::string_view>& records);
+    
+    // Query strings ("since=5&limit=10") follow '?' in text request paths
+    // and travel as the payload of binary GET requests
+    void splitQuery(std::string_view target, std::string_view& path, std::string_view& query);
+    bool queryParameter(std::string_view query, std::string_view name, std::string_view& value);
+    bool parseUnsigned(std::string_view text, uint64_t& value);
+    
+    // Decode %XX escapes in a query value. Returns false on a malformed escape.
+    bool decodeQueryValue(std::string_view text, std::string& value);
+    
+    // Text responses are one line, so payloads echoed in them are escaped:
+    // backslash, CR and LF become \\, \r and \n
+    void appendEscaped(std::string& out, std::string_view data);
+    size_t escapedLength(std::string_view data);
+    
+    // Write the escaped form of data, escapedLength(data) bytes, to out and
+    // return the end of what was written
+    char* writeEscaped(char* out, std::string_view data);
 }
 
 #endif // PROTOCOL_H 
\ No newline at end of file
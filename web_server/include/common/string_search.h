@@ -0,0 +1,19 @@
+#ifndef STRING_SEARCH_H
+#define STRING_SEARCH_H
+
+#include <cstddef>
+#include <string_view>
+
+// Position of the first occurrence of needle in haystack, or
+// std::string_view::npos. Candidates are found by comparing the first and
+// last needle bytes against 16 (SSE2) or 32 (AVX2) haystack positions at
+// once; only those are checked in full. Falls back to a scalar search when
+// neither instruction set is available at compile time.
+size_t findSubstring(std::string_view haystack, std::string_view needle);
+
+// Position of the first byte equal to a or b at or after pos, or
+// text.size() if there is none. Scans 16 or 32 bytes per step like
+// findSubstring().
+size_t findEitherByte(std::string_view text, char a, char b, size_t pos = 0);
+
+#endif // STRING_SEARCH_H
\ No newline at end of file
@@ -0,0 +1,133 @@
+#ifndef ADMISSION_CONTROL_H
+#define ADMISSION_CONTROL_H
+
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <sys/socket.h>
+#include "server_metrics.h"
+
+// Token bucket kept as the single time at which it will be full again:
+// every token taken pushes that time one refill interval further out, and
+// the bucket is empty while it lies more than its capacity ahead of now.
+// Taking a token is one compare-and-swap, so many threads can share it.
+class TokenBucket {
+public:
+    TokenBucket();
+    
+    // Take a token at now_ns from a bucket refilled one token per
+    // interval_ns and holding capacity_ns / interval_ns tokens. Returns
+    // false, taking nothing, if it is empty.
+    bool take(int64_t now_ns, int64_t interval_ns, int64_t capacity_ns);
+    
+    // Full buckets hold no state worth keeping
+    bool isFull(int64_t now_ns) const;
+    
+private:
+    std::atomic<int64_t> full_at_ns_;
+};
+
+// Connection and request budgets of one peer address. Every connection
+// from the address holds a reference, so a request is charged without a
+// table lookup.
+class PeerBudget {
+public:
+    PeerBudget(int64_t request_interval_ns, int64_t request_capacity_ns);
+    
+    // Take a token from the request bucket (thread-safe); false if the
+    // peer is over its request rate
+    bool takeRequest();
+    
+private:
+    friend class AdmissionControl;
+    
+    int64_t request_interval_ns_;
+    int64_t request_capacity_ns_;
+    TokenBucket connections_;
+    TokenBucket requests_;
+};
+
+// Decides at accept whether a connection is served. A connection is turned
+// away with a "503 busy" line, before anything is allocated for it, when
+// max_connections are already open or its peer address has used up its
+// connection bucket. Admitted connections carry their peer's budget, which
+// also limits the rate of requests.
+//
+// Budgets live in a hash table keyed on the address and split into stripes,
+// each with its own lock, so accepts from different peers rarely contend.
+// A stripe drops the budgets no connection holds once their buckets have
+// refilled, so the table only grows with the peers active recently.
+class AdmissionControl {
+public:
+    static const size_t STRIPES = 64;
+    
+    // Each limit is disabled by 0. A burst of 0 allows one second's worth.
+    AdmissionControl(ServerMetrics& metrics, size_t max_connections, size_t connection_rate,
+                     size_t connection_burst, size_t request_rate, size_t request_burst);
+    
+    AdmissionControl(const AdmissionControl&) = delete;
+    AdmissionControl& operator=(const AdmissionControl&) = delete;
+    
+    // Admit a connection accepted from peer_addr while open_connections are
+    // being served. On success budget holds the peer's budget, or nullptr if
+    // no per-peer limit is set. Otherwise the client has been refused.
+    bool admitConnection(int client_socket, const struct sockaddr_storage& peer_addr, size_t open_connections,
+                         std::shared_ptr<PeerBudget>& budget);
+    
+    // Send the client the busy response without blocking, close it and
+    // count the rejection
+    void refuse(int client_socket, ServerMetrics::RejectReason reason);
+    
+    // Peer addresses with a budget in the table
+    size_t getTrackedPeers() const;
+    
+private:
+    // IPv4 addresses are stored IPv4-mapped, so a client reaching a
+    // dual-stack listener over either family shares one budget
+    struct PeerKey {
+        uint8_t bytes[16];
+        
+        bool operator==(const PeerKey& other) const;
+    };
+    
+    struct PeerKeyHash {
+        size_t operator()(const PeerKey& key) const;
+    };
+    
+    // Padded to a cache line so neighbouring locks are not shared
+    struct alignas(64) Stripe {
+        mutable std::mutex mutex;
+        std::unordered_map<PeerKey, std::shared_ptr<PeerBudget>, PeerKeyHash> peers;
+        size_t prune_at = 0;
+    };
+    
+    ServerMetrics& metrics_;
+    size_t max_connections_;
+    bool per_peer_;
+    int64_t connection_interval_ns_;
+    int64_t connection_capacity_ns_;
+    int64_t request_interval_ns_;
+    int64_t request_capacity_ns_;
+    std::unique_ptr<Stripe[]> stripes_;
+    
+    // Charge a connection to the peer's bucket and return its budget, or
+    // nullptr if the bucket is empty
+    std::shared_ptr<PeerBudget> chargeConnection(const PeerKey& key, int64_t now_ns);
+    
+    // Forget the budgets of a stripe that are unused and full again; the
+    // stripe lock must be held
+    static void prune(Stripe& stripe, int64_t now_ns);
+    
+    // False for address families other than IPv4 and IPv6
+    static bool makeKey(const struct sockaddr_storage& addr, PeerKey& key);
+    
+    // Refill interval of a bucket for rate tokens per second (0 if
+    // unlimited), and its capacity for burst tokens
+    static int64_t refillInterval(size_t rate);
+    static int64_t bucketCapacity(size_t rate, size_t burst);
+};
+
+#endif // ADMISSION_CONTROL_H
\ No newline at end of file
@@ -0,0 +1,104 @@
+#ifndef CACHE_SNAPSHOT_H
+#define CACHE_SNAPSHOT_H
+
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include "data_cache.h"
+#include "write_ahead_log.h"
+
+// Snapshot file layout, in host byte order:
+//   SnapshotHeader
+//   offset table: entry_count SnapshotEntry items, ascending seq
+//   record region: records back to back, in table order, each a 64-bit
+//   sequence number and a 32-bit length followed by the payload bytes
+// The record region uses DataCache's arena record format, so a mapped
+// snapshot can be adopted by the cache as read-only chunks without copying.
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t byte_order;        // SNAPSHOT_BYTE_ORDER as written by the host
+    uint32_t table_crc;         // CRC-32 of the offset table
+    uint32_t records_crc;       // CRC-32 of the record region
+    uint32_t reserved;
+    uint64_t entry_count;
+    uint64_t wal_offset;        // Log position covered by the snapshot
+    uint64_t committed_seq;     // Every entry below it is in the snapshot or was evicted
+    uint64_t table_offset;
+    uint64_t records_offset;
+    uint64_t records_size;
+    int64_t created_ms;         // Wall-clock creation time
+};
+
+struct SnapshotEntry {
+    uint64_t seq;
+    uint64_t offset;            // Payload offset within the record region
+    uint32_t length;
+    uint32_t reserved;
+};
+
+// A snapshot file mapped into memory. The mapping is released when the
+// last chunk referencing it goes away.
+struct SnapshotImage {
+    std::shared_ptr<char[]> mapping;
+    const SnapshotEntry* entries = nullptr;
+    size_t entry_count = 0;
+    char* records = nullptr;
+    size_t records_size = 0;
+    uint64_t wal_offset = 0;
+    uint64_t committed_seq = 0;
+};
+
+// Writes DataCache snapshots, periodically on a background thread or on
+// demand. Capturing the cache holds each shard lock only long enough to
+// collect views of its entries; the payload bytes are written from the
+// immutable arena chunks afterwards, so addData() is never blocked by
+// file I/O. Files are written to a temporary name, synced, and renamed into
+// place, and the directory is synced so the rename survives a crash.
+class CacheSnapshot {
+public:
+    CacheSnapshot(const std::string& path, DataCache& cache, WriteAheadLog* wal, int interval_ms);
+    ~CacheSnapshot();
+    
+    CacheSnapshot(const CacheSnapshot&) = delete;
+    CacheSnapshot& operator=(const CacheSnapshot&) = delete;
+    
+    // Start/stop the periodic snapshot thread
+    void start();
+    void stop();
+    
+    // Write a snapshot now, unless nothing changed since the last one
+    bool takeSnapshot();
+    
+    size_t getSnapshotCount() const;
+    
+    // Write batch, which must be in ascending seq order, to path
+    static bool write(const std::string& path, const CacheBatch& batch, uint64_t wal_offset,
+                      uint64_t committed_seq);
+    
+    // Map a snapshot file and validate its header, offset table and records
+    static bool load(const std::string& path, SnapshotImage& image);
+    
+private:
+    std::string path_;
+    DataCache& cache_;
+    WriteAheadLog* wal_;
+    int interval_ms_;
+    
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_;
+    
+    std::mutex snapshot_mutex_;             // Serializes takeSnapshot()
+    uint64_t last_seq_;
+    uint64_t last_wal_offset_;
+    std::atomic<size_t> snapshots_;
+    
+    void run();
+};
+
+#endif // CACHE_SNAPSHOT_H
\ No newline at end of file
@@ -2,38 +2,182 @@
 #define CLIENT_HANDLER_H
 
 #include <string>
+#include <string_view>
 #include <atomic>
+#include <memory>
+#include <vector>
+#include <chrono>
 #include "data_cache.h"
+#include "client_stats.h"
+#include "server_metrics.h"
+#include "server_config.h"
+#include "output_queue.h"
+#include "subscription_hub.h"
+#include "admission_control.h"
 #include <common/protocol.h>
+#include <common/input_buffer.h>
 
 class ClientHandler {
 public:
-    ClientHandler(int client_socket, DataCache& cache, std::atomic<bool>& server_running);
+    ClientHandler(std::shared_ptr<ConnectionContext> context, DataCache& cache, ClientStats& stats,
+                  ServerMetrics& metrics, std::atomic<bool>& server_running, const ServerConfig& config);
     ~ClientHandler();
     
-    // Main method to handle client request
-    void handleRequest();
+    // Serve requests on this connection from a thread-pool worker until the
+    // peer closes or goes quiet. Returns true if it is open but quiet: the
+    // caller waits until the socket, or the subscription, is readable and
+    // calls handleRequest() again.
+    bool handleRequest();
+    
+    // Consume every complete frame in input, text or binary, and append the
+    // framed responses to output. Returns false when the connection should
+    // be closed. POSTs are acknowledged once their entries are durable,
+    // which blocks here unless acknowledgements are deferred.
+    bool processInput(InputBuffer& input, OutputQueue& output);
+    
+    // Let processInput() return before the entries it added are durable.
+    // For event loops, which must not block: they hold the output back
+    // until acksDurable() allows it, and call processInput() again only then.
+    void deferAcks();
+    
+    // With deferred acknowledgements, whether the responses in output may
+    // be sent: false while the entries they acknowledge are not durable yet.
+    // If the log has failed, output is dropped and keep_open cleared.
+    bool acksDurable(OutputQueue& output, bool& keep_open);
+    
+    // Parse and dispatch a single text request, queueing the response line
+    void processRequest(std::string_view request, OutputQueue& output);
+    
+    // Start the latency clock for requests in data just read
+    void markReceived();
+    
+    // Everything queued so far has been written: record the latencies
+    void responsesSent();
+    
+    // True once the connection has subscribed to new entries. It then only
+    // streams: input is discarded and the idle timeout no longer applies.
+    bool isSubscribed() const;
+    
+    // Readable while stream frames wait to be queued by processInput();
+    // -1 without a subscription
+    int getSubscriptionFd() const;
+    
+    // Client IP address, resolved once at accept
+    const std::string& getClientIP() const;
+    
+    int getSocket() const;
     
 private:
+    // How waiting for a thread-pool connection's next request ended
+    enum class WaitResult {
+        READY,
+        QUIET,
+        CLOSED
+    };
+    
+    std::shared_ptr<ConnectionContext> context_;
     int client_socket_;
     DataCache& cache_;
+    ClientStats& stats_;
+    ServerMetrics& metrics_;
     std::atomic<bool>& server_running_;
+    const ServerConfig& config_;
+    
+    // Write-ahead log position of the newest entry this connection added
+    // that has not been confirmed durable yet (0 if none)
+    uint64_t pending_log_position_;
+    bool defer_acks_;
+    
+    // Thread-pool connections only: received bytes, kept while the
+    // connection is parked between handleRequest() calls
+    InputBuffer input_;
+    bool started_;
+    
+    // Records of the batch being added; views into the request
+    std::vector<std::string_view> batch_records_;
+    
+    // GET /data/subscribe state: entries up to stream_since_ are not sent,
+    // and while catching up, missed entries after stream_cursor_ are read
+    // from the cache a page at a time
+    std::shared_ptr<Subscription> subscription_;
+    uint64_t stream_since_;
+    uint64_t stream_cursor_;
+    bool catching_up_;
+    std::vector<StreamFrame> stream_frames_;
     
-    // Parse incoming request
-    bool parseRequest(const std::string& request, Protocol::Method& method, 
-                      std::string& path, std::string& payload);
+    // Labels of the request being processed, for the metrics
+    Protocol::Method request_method_;
+    Protocol::PathId request_path_;
+    uint16_t response_status_;              // 0 until a response is queued
+    
+    // When the data holding the current requests arrived, and the answered
+    // requests whose responses are still queued
+    std::chrono::steady_clock::time_point received_at_;
+    bool timed_from_accept_;                // The first read keeps the accept time
+    std::vector<std::pair<Protocol::PathId, std::chrono::steady_clock::time_point>> unsent_;
+    
+    // Check without waiting whether the socket is readable, or a
+    // subscription has frames; readable tells which
+    WaitResult waitForData(bool& readable);
+    
+    // Handle one frame at the start of pending. Return the bytes consumed,
+    // or 0 if the frame is not complete yet.
+    size_t processTextFrame(std::string_view pending, OutputQueue& output);
+    size_t processBinaryFrame(std::string_view pending, OutputQueue& output, bool& keep_open);
+    
+    // Answer a frame that exceeds the maximum message size
+    void rejectOversizedFrame(std::string_view pending, OutputQueue& output);
+    
+    // Route a parsed request to the GET/POST processors
+    void dispatch(Protocol::Method method, std::string_view path, std::string_view payload,
+                  Protocol::Encoding encoding, OutputQueue& output);
     
     // Process GET requests
-    std::string processGET(const std::string& path);
+    void processGET(Protocol::PathId path_id, std::string_view path, std::string_view query,
+                    Protocol::Encoding encoding, OutputQueue& output);
+    
+    // Return cached entries after the "since" cursor. Text responses escape
+    // the payloads; binary responses carry them raw.
+    void processDataRead(std::string_view query, Protocol::Encoding encoding, OutputQueue& output);
+    
+    // Return cached entries matching a contains= or prefix= pattern
+    void processSearch(std::string_view query, Protocol::Encoding encoding, OutputQueue& output);
+    
+    // Queue a batch as "200 OK – N entries; next=SEQ; SEQ:LEN:DATA ...",
+    // referencing large payloads in their arena chunks
+    void writeEntries(const CacheBatch& batch, Protocol::Encoding encoding, OutputQueue& output);
+    
+    // Subscribe to new entries, after first sending the cached ones past
+    // an optional since= cursor
+    void processSubscribe(std::string_view query, Protocol::Encoding encoding, OutputQueue& output);
+    
+    // Queue the next page of missed entries or, once caught up, the frames
+    // waiting in the subscription. False once the subscription was cut off.
+    bool pumpSubscription(OutputQueue& output);
     
     // Process POST requests
-    std::string processPOST(const std::string& path, const std::string& payload);
+    void processPOST(Protocol::PathId path_id, std::string_view path, std::string_view payload,
+                     Protocol::Encoding encoding, OutputQueue& output);
+    
+    // Add the records of a POST /data/batch and answer with their sequence range
+    void processBatch(std::string_view payload, Protocol::Encoding encoding, OutputQueue& output);
+    
+    // Render the per-client statistics as a single response line
+    std::string formatStats() const;
+    
+    // Render the metrics; text responses carry them on one escaped line
+    std::string formatMetrics(Protocol::Encoding encoding) const;
+    
+    // Queue a framed response: fixed ones are referenced, not copied
+    void respond(OutputQueue& output, Protocol::Encoding encoding, const Protocol::PreparedResponse& response);
+    void respond(OutputQueue& output, Protocol::Encoding encoding, std::string_view response);
     
-    // Send response to client
-    void sendResponse(const std::string& response);
+    // Send queued responses to the client, handling partial writes
+    bool sendResponse(OutputQueue& output);
     
-    // Get client IP address for logging
-    std::string getClientIP() const;
+    // The log lost entries this connection added: drop the responses
+    // acknowledging them
+    void dropUnloggedResponses(OutputQueue& output);
 };
 
 #endif // CLIENT_HANDLER_H 
\ No newline at end of file
@@ -0,0 +1,100 @@
+#ifndef CLIENT_STATS_H
+#define CLIENT_STATS_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <sys/socket.h>
+#include <common/protocol.h>
+
+class PeerBudget;
+
+// Request counters of one connection. Only the thread serving the connection
+// writes them, so updates are plain load/store pairs on relaxed atomics: no
+// locks and no contended read-modify-write on the request path. Readers on
+// other threads see slightly stale but consistent-enough values.
+struct ConnectionCounters {
+    std::atomic<uint64_t> get_requests{0};
+    std::atomic<uint64_t> post_requests{0};
+    std::atomic<uint64_t> other_requests{0};
+    std::atomic<uint64_t> bytes_in{0};
+    std::atomic<uint64_t> bytes_out{0};
+    std::atomic<uint64_t> response_time_ns{0};
+    
+    // Single-writer helpers
+    void recordCommand(Protocol::Method method);
+    void recordRequest(size_t request_bytes, size_t response_bytes, std::chrono::nanoseconds elapsed);
+};
+
+// Per-connection state created once at accept, so the peer address is not
+// looked up again for every log line
+struct ConnectionContext {
+    ConnectionContext(int socket, const struct sockaddr_storage& peer_addr);
+    
+    int socket;
+    std::string peer_ip;
+    std::chrono::steady_clock::time_point connected_at;
+    ConnectionCounters counters;
+    
+    // Rate limits of the peer address; null when none are configured
+    std::shared_ptr<PeerBudget> budget;
+    
+    // Printable form of an IPv4 or IPv6 address
+    static std::string addressToString(const struct sockaddr_storage& addr);
+};
+
+// Aggregated statistics of one client address
+struct ClientSummary {
+    std::string ip;
+    uint64_t connections = 0;
+    uint64_t active_connections = 0;
+    uint64_t get_requests = 0;
+    uint64_t post_requests = 0;
+    uint64_t other_requests = 0;
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+    uint64_t response_time_ns = 0;
+    
+    uint64_t totalRequests() const;
+    
+    // Mean time to produce a response, in microseconds
+    double meanResponseTimeUs() const;
+};
+
+// Server-wide per-client statistics. The lock is only taken when a
+// connection opens or closes and when the table is read; live connections
+// are merged with the totals of closed ones at read time.
+class ClientStats {
+public:
+    ClientStats() = default;
+    
+    ClientStats(const ClientStats&) = delete;
+    ClientStats& operator=(const ClientStats&) = delete;
+    
+    void connectionOpened(const std::shared_ptr<ConnectionContext>& context);
+    
+    // Fold the connection's counters into its client's totals
+    void connectionClosed(const std::shared_ptr<ConnectionContext>& context);
+    
+    // Current per-client totals, busiest clients first
+    std::vector<ClientSummary> snapshot() const;
+    
+private:
+    // Closed-connection totals are kept for at most this many addresses;
+    // the rest are folded into a single "other" entry
+    static const size_t MAX_TRACKED_CLIENTS = 4096;
+    
+    mutable std::mutex mutex_;
+    std::unordered_set<std::shared_ptr<ConnectionContext>> live_;
+    std::unordered_map<std::string, ClientSummary> closed_;
+    
+    static void accumulate(ClientSummary& summary, const ConnectionCounters& counters);
+};
+
+#endif // CLIENT_STATS_H
\ No newline at end of file
@@ -2,30 +2,307 @@
 #define DATA_CACHE_H
 
 #include <vector>
+#include <deque>
+#include <unordered_map>
 #include <string>
+#include <string_view>
 #include <mutex>
-#include <shared_mutex>
+#include <atomic>
+#include <memory>
+#include <cstdint>
 
+class WriteAheadLog;
+class SubscriptionHub;
+class ThreadPool;
+struct SnapshotImage;
+
+// Result of a cursor read. Payloads are views into arena chunks that the
+// batch keeps alive, so they remain valid after the entries are evicted
+// and no payload bytes are copied out of the cache.
+struct CacheBatch {
+    struct Entry {
+        uint64_t seq;
+        std::string_view data;
+    };
+    
+    std::vector<Entry> entries;             // Ascending seq
+    uint64_t next_seq = 0;                  // Pass as "since" to continue reading
+    std::vector<std::shared_ptr<const char[]>> chunks;
+};
+
+// How DataCache makes room once its byte budget is used up
+enum class EvictionPolicy {
+    FIFO,   // Drop the oldest entries
+    LRU,    // Approximate LRU: entries read since the last pass get a second chance
+    TTL     // Entries expire after a fixed time; FIFO when the budget runs out first
+};
+
+// How search() matches payloads against a pattern
+enum class SearchMode {
+    PREFIX,     // The payload starts with the pattern
+    CONTAINS    // The pattern occurs anywhere in the payload
+};
+
+// In-memory store for POSTed data. Entries are spread over independent
+// shards so concurrent writers rarely share a lock; each entry gets a
+// global sequence number (starting at 1) so reads can return them in
+// insertion order and readers can resume from the last one they saw.
+//
+// Payload bytes are packed into large arena chunks that each shard uses as
+// a ring: new records go into the newest chunk and memory is reclaimed a
+// whole chunk at a time from the oldest end, so allocation stays bounded by
+// the byte budget and the arena never fragments. A compact index ordered by
+// sequence number maps each entry to its offset and length in the arena.
+// Prefix indexes map the first 3 and the first 8 bytes of each payload to
+// the entries that start with them, for prefix searches.
 class DataCache {
 public:
-    DataCache();
+    static constexpr size_t DEFAULT_MAX_BYTES = 256 * 1024 * 1024;
+    static constexpr size_t INDEXED_PREFIX_LENGTH = 3;      // Shortest prefix answered from an index
+    
+    explicit DataCache(size_t shard_count = 1, size_t max_bytes = DEFAULT_MAX_BYTES,
+                       EvictionPolicy policy = EvictionPolicy::FIFO, int ttl_ms = 0);
     ~DataCache();
     
-    // Add data to cache (thread-safe)
-    void addData(const std::string& data);
+    DataCache(const DataCache&) = delete;
+    DataCache& operator=(const DataCache&) = delete;
+    
+    // Add data to cache (thread-safe). Returns false if the entry is larger
+    // than a shard's share of the byte budget. With a write-ahead log
+    // attached the entry is also queued for it and log_position, if given,
+    // receives the position to pass to waitDurable().
+    bool addData(std::string_view data, uint64_t* log_position = nullptr);
+    
+    // Add several entries under consecutive sequence numbers (thread-safe).
+    // The shard lock is taken, and the write-ahead log appended to, once for
+    // the whole batch. Returns false without adding anything if the batch is
+    // larger than a shard's share of the byte budget. Otherwise first_seq
+    // and last_seq receive the range of the batch still cached: making room
+    // for the last entries can evict the first ones along with the chunk
+    // they were added to.
+    bool addBatch(const std::vector<std::string_view>& entries, uint64_t& first_seq, uint64_t& last_seq,
+                  uint64_t* log_position = nullptr);
+    
+    // Insert an entry recovered from persistent storage under its original
+    // sequence number. Later addData() calls continue after the highest
+    // restored seq. Entries already present in any shard are skipped.
+    // Not thread-safe with concurrent writers; call before serving.
+    bool restoreEntry(uint64_t seq, std::string_view data);
+    
+    // Log new entries to wal (not owned). Attach before serving requests.
+    void attachWriteAheadLog(WriteAheadLog* wal);
     
-    // Get all cached data (thread-safe)
+    // Queue new entries for the subscribers of hub (not owned). Attach
+    // before serving requests.
+    void attachSubscriptions(SubscriptionHub* hub);
+    SubscriptionHub* getSubscriptions() const;
+    
+    // Block until the log holds everything up to log_position durably.
+    // Returns true right away when no log is attached.
+    bool waitDurable(uint64_t log_position);
+    
+    // waitDurable() without blocking; durable is set once the log holds
+    // everything up to log_position. Returns false if the log has failed.
+    bool pollDurable(uint64_t log_position, bool& durable) const;
+    
+    // Have the attached log signal event_fd as entries become durable; see
+    // WriteAheadLog::addDurableWatcher(). False if no log is attached.
+    bool watchDurable(int event_fd);
+    void unwatchDurable(int event_fd);
+    
+    // Entries with a sequence number greater than since, oldest first, at
+    // most limit entries and roughly max_bytes of payload (thread-safe).
+    // Shard locks are held only to look the entries up; the batch then
+    // references the arena directly.
+    CacheBatch readSince(uint64_t since, size_t limit, size_t max_bytes = SIZE_MAX) const;
+    
+    // readSince() without marking the entries as recently read; used to
+    // publish them to subscribers (thread-safe)
+    CacheBatch peekSince(uint64_t since, size_t limit, size_t max_bytes = SIZE_MAX) const;
+    
+    // Entries after since whose payload matches pattern, oldest first, at
+    // most limit entries and roughly max_bytes of payload (thread-safe).
+    // Prefixes of at least INDEXED_PREFIX_LENGTH bytes are looked up in the
+    // longest prefix index they cover; other patterns are found by scanning
+    // the arena chunks of all shards in parallel, one chunk per lock hold.
+    CacheBatch search(SearchMode mode, std::string_view pattern, uint64_t since, size_t limit,
+                      size_t max_bytes = SIZE_MAX) const;
+    
+    // All stored entries, oldest first, without marking them as recently
+    // read. Unlike readSince() it includes entries past the committed
+    // watermark, since they may already be logged. Used to write snapshots
+    // (thread-safe).
+    CacheBatch capture() const;
+    
+    // Serve the entries of a mapped snapshot in place: its record region is
+    // split into read-only chunks dealt round-robin over the shards. Call on
+    // an empty cache before serving. Returns the number of entries adopted.
+    size_t adoptSnapshot(const SnapshotImage& image);
+    
+    // Get all cached data in insertion order (thread-safe)
     std::vector<std::string> getData() const;
     
-    // Get cache size (thread-safe)
+    // Sequence number the next added entry will get (thread-safe)
+    uint64_t getNextSeq() const;
+    
+    // Every entry below this sequence number has been stored. Numbers are
+    // taken in order but stored on several shards at once, so the ones from
+    // here on may still be in flight; reads stop short of it, so a cursor
+    // never moves past an entry that is yet to appear (thread-safe).
+    uint64_t getCommittedSeq() const;
+    
+    // Get number of entries held, including expired ones not yet reclaimed
+    // (thread-safe, lock-free)
     size_t size() const;
     
     // Clear all cached data (thread-safe)
     void clear();
     
+    size_t getShardCount() const;
+    EvictionPolicy getEvictionPolicy() const;
+    
+    // Byte budget and arena bytes currently allocated for payloads
+    size_t getMaxBytes() const;
+    size_t getMemoryUsage() const;
+    
+    // Payload bytes of the entries held
+    size_t getStoredBytes() const;
+    
+    // Entries dropped to stay within the budget, and entries that expired
+    size_t getEvictedEntries() const;
+    size_t getExpiredEntries() const;
+    
+    // Parse "fifo", "lru" or "ttl"
+    static bool parseEvictionPolicy(const std::string& name, EvictionPolicy& policy);
+    static const char* evictionPolicyToString(EvictionPolicy policy);
+    
 private:
-    std::vector<std::string> data_;
-    mutable std::shared_mutex mutex_;
+    // Chunks hold records back to back: a 64-bit sequence number and a
+    // 32-bit length, followed by the payload bytes
+    struct Chunk {
+        std::shared_ptr<char[]> data;       // Shared with readers of its records
+        size_t capacity = 0;
+        size_t used = 0;
+        int64_t newest_ms = 0;              // Insertion time of the newest record
+        uint64_t min_seq = UINT64_MAX;      // Range of sequence numbers written to it
+        uint64_t max_seq = 0;
+        bool ordered = true;                // Records were written in ascending seq order
+    };
+    
+    struct IndexEntry {
+        uint64_t seq;
+        uint64_t chunk_id;
+        uint32_t offset;                    // Payload offset within the chunk
+        uint32_t length;
+        int64_t inserted_ms;
+        bool live;
+        bool referenced;                    // Read since the last eviction pass (LRU)
+    };
+    
+    // Ascending sequence numbers of the entries sharing a payload prefix.
+    // Entries mostly die oldest first, so dead ones are dropped from the
+    // front; the rest are skipped on lookup until they reach it.
+    struct Postings {
+        std::vector<uint64_t> seqs;
+        size_t head = 0;                    // First sequence number still in use
+    };
+    
+    // Padded to a cache line so writers on different shards do not
+    // invalidate each other's lock or counters
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::deque<Chunk> chunks;           // Oldest first
+        uint64_t first_chunk_id = 0;        // Id of chunks.front()
+        std::deque<IndexEntry> index;       // Sorted by seq
+        std::unordered_map<uint64_t, Postings> prefix_index[2];    // 3- and 8-byte prefixes
+        
+        // Lower bound of the sequence numbers being stored under the lock,
+        // UINT64_MAX while none are
+        std::atomic<uint64_t> inserting{UINT64_MAX};
+        
+        std::atomic<size_t> count{0};
+        std::atomic<size_t> stored_bytes{0};
+        std::atomic<size_t> allocated_bytes{0};
+        std::atomic<size_t> evicted{0};
+        std::atomic<size_t> expired{0};
+    };
+    
+    std::unique_ptr<Shard[]> shards_;
+    size_t shard_count_;
+    size_t max_bytes_;
+    size_t shard_budget_;
+    size_t chunk_size_;
+    EvictionPolicy policy_;
+    int ttl_ms_;
+    WriteAheadLog* wal_;
+    SubscriptionHub* subscriptions_;
+    std::unique_ptr<ThreadPool> scan_pool_; // Scans shards in parallel (none with one shard)
+    alignas(64) std::atomic<uint64_t> next_seq_;
+    
+    // Sum one of the per-shard counters without locking
+    size_t sumCounters(std::atomic<size_t> Shard::*counter) const;
+    
+    // Shard used by the calling thread
+    Shard& shardForThisThread();
+    
+    // Cursor read of the entries in (since, before), shared by readSince()
+    // and capture()
+    CacheBatch collect(uint64_t since, uint64_t before, size_t limit, size_t max_bytes, bool mark_read) const;
+    
+    // Append the live entries of one shard in (since, before) to run
+    void collectShard(Shard& shard, uint64_t since, uint64_t before, size_t limit, size_t max_bytes,
+                      bool mark_read, int64_t now_ms, CacheBatch& run) const;
+    
+    // k-way merge of per-shard runs by sequence number
+    static CacheBatch mergeRuns(std::vector<CacheBatch>& runs, uint64_t since, size_t limit, size_t max_bytes);
+    
+    // Take sequence numbers for count entries on a locked shard, announcing
+    // them as in flight first; finishInsert() clears the announcement
+    uint64_t beginInsert(Shard& shard, size_t count);
+    static void finishInsert(Shard& shard);
+    
+    // Search one shard through the prefix index, or by scanning it
+    void searchIndex(Shard& shard, std::string_view prefix, uint64_t since, uint64_t before, size_t limit,
+                     int64_t now_ms, CacheBatch& run) const;
+    void scanShard(Shard& shard, SearchMode mode, std::string_view pattern, uint64_t since, uint64_t before,
+                   size_t limit, CacheBatch& run) const;
+    
+    // Append the matching live records of one chunk to run; the shard lock must be held
+    void scanChunk(Shard& shard, uint64_t chunk_id, SearchMode mode, std::string_view pattern,
+                   uint64_t since, uint64_t before, size_t limit, int64_t now_ms, CacheBatch& run) const;
+    
+    // Maintain the prefix index; the shard lock must be held
+    void indexPrefix(Shard& shard, uint64_t seq, const char* payload, size_t length);
+    void unindexPrefix(Shard& shard, const char* payload, size_t length);
+    
+    // Prefix index key of a payload; false if it is too short to index
+    static bool prefixKey(const char* payload, size_t length, size_t level, uint64_t& key);
+    
+    // Make room for and store a record; the shard lock must be held, and
+    // with the TTL policy expired chunks released first
+    void insertRecord(Shard& shard, uint64_t seq, std::string_view data, int64_t now_ms);
+    
+    // Whether appending a record of record_size bytes keeps a non-empty
+    // shard within its budget, counting the chunk it may have to start
+    bool fitsBudget(const Shard& shard, size_t record_size) const;
+    
+    // Copy a record into the newest chunk, starting a new chunk when it is full
+    void appendRecord(Shard& shard, IndexEntry& entry, const char* payload);
+    
+    // Release the oldest chunk, evicting or relocating the records it holds.
+    // A record is only relocated if it fits the budget while the oldest
+    // chunk is still allocated; otherwise it is evicted.
+    void releaseOldestChunk(Shard& shard, int64_t now_ms);
+    
+    // Release chunks whose records have all expired (TTL policy)
+    void expireChunks(Shard& shard, int64_t now_ms);
+    
+    // Drop dead entries from the front of the index
+    void trimIndex(Shard& shard);
+    
+    IndexEntry* findEntry(Shard& shard, uint64_t seq) const;
+    bool isExpired(const IndexEntry& entry, int64_t now_ms) const;
+    static int64_t nowMs();
 };
 
-#endif // DATA_CACHE_H 
\ No newline at end of file
+#endif // DATA_CACHE_H
\ No newline at end of file
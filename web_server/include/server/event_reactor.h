@@ -0,0 +1,106 @@
+#ifndef EVENT_REACTOR_H
+#define EVENT_REACTOR_H
+
+#include <string>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <unordered_map>
+#include <unordered_set>
+#include "client_handler.h"
+#include "data_cache.h"
+#include "client_stats.h"
+#include "server_metrics.h"
+#include "server_config.h"
+#include "admission_control.h"
+#include "output_queue.h"
+#include <common/input_buffer.h>
+
+// Single-threaded, edge-triggered epoll event loop. Accepts connections from
+// a non-blocking listening socket and drives each client through a
+// read -> parse -> write state machine without blocking. Connections are
+// persistent: after a response is flushed the client goes back to reading
+// until it closes or stays idle past the timeout. Responses acknowledging
+// POSTs are held until the write-ahead log has the entries durable; the
+// log wakes the loop through an eventfd meanwhile. In REUSEPORT mode one
+// reactor runs per listener, each on its own thread; listener is the index
+// its accepts are counted under.
+class EventReactor {
+public:
+    EventReactor(int listen_socket, size_t listener, DataCache& cache, ClientStats& stats, ServerMetrics& metrics,
+                 AdmissionControl& admission, std::atomic<bool>& server_running,
+                 std::atomic<size_t>& active_connections, const ServerConfig& config);
+    ~EventReactor();
+    
+    // Run the event loop until the server stops
+    void run();
+    
+private:
+    enum class ConnectionState {
+        READING,   // Waiting for a complete request frame
+        WRITING,   // Responses queued, socket not yet drained
+        CLOSING    // Flush what is queued, then close
+    };
+    
+    struct Connection {
+        explicit Connection(size_t max_message_size) : input(max_message_size) {}
+        
+        std::unique_ptr<ClientHandler> handler;
+        ConnectionState state = ConnectionState::READING;
+        InputBuffer input;
+        OutputQueue output;
+        bool peer_closed = false;
+        bool read_blocked = false;  // Input buffer hit its limit before EAGAIN
+        bool syncing = false;       // Output held until the entries it acknowledges are durable
+        int wake_fd = -1;           // Subscription eventfd registered with epoll
+        std::chrono::steady_clock::time_point last_activity;
+    };
+    
+    int listen_socket_;
+    size_t listener_;
+    int epoll_fd_;
+    DataCache& cache_;
+    ClientStats& stats_;
+    ServerMetrics& metrics_;
+    AdmissionControl& admission_;
+    std::atomic<bool>& server_running_;
+    std::atomic<size_t>& active_connections_;
+    const ServerConfig& config_;
+    std::unordered_map<int, Connection> connections_;
+    std::unordered_map<int, int> stream_wakeups_;  // Subscription eventfd -> connection
+    int durable_fd_;                        // Signalled by the write-ahead log; -1 without one
+    std::unordered_set<int> syncing_;       // Connections waiting for it
+    std::chrono::steady_clock::time_point last_idle_sweep_;
+    
+    // Accept every pending connection on the listening socket
+    void acceptPending();
+    
+    // Read if readable, then advance the connection and close it once done
+    void service(int fd, Connection& conn, bool readable);
+    
+    // Send the held output of connections whose entries are now durable
+    void resumeSyncing();
+    
+    // Drain the socket into the input buffer
+    void handleReadable(int fd, Connection& conn);
+    
+    // Process buffered requests and queue their responses
+    void handleParse(int fd, Connection& conn);
+    
+    // Wake the connection through epoll when its subscription has frames
+    void watchSubscription(int fd, Connection& conn);
+    
+    // Write as much pending output as the socket accepts
+    void handleWritable(int fd, Connection& conn);
+    
+    // Advance the state machine as far as possible without blocking
+    void advance(int fd, Connection& conn);
+    
+    // Close connections that have been idle past the timeout
+    void closeIdleConnections();
+    
+    // Deregister and close a connection
+    void closeConnection(int fd);
+};
+
+#endif // EVENT_REACTOR_H
\ No newline at end of file
@@ -0,0 +1,76 @@
+#ifndef IDLE_POLLER_H
+#define IDLE_POLLER_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include "client_handler.h"
+
+// Holds the thread-pool connections that are quiet between requests, so a
+// keep-alive client does not tie up a worker while it is not sending. One
+// thread waits on their sockets, and on the eventfds of their
+// subscriptions, with epoll. A connection that becomes readable is handed
+// to resume, which gives it back to the pool; one quiet for the idle
+// timeout is closed. Subscribed connections never time out. Descriptors are
+// registered one-shot the first time they are parked, so each later park
+// re-arms them with a single epoll_ctl and a wake-up needs none.
+class IdlePoller {
+public:
+    using Resume = std::function<void(std::shared_ptr<ClientHandler>)>;
+    
+    IdlePoller(int idle_timeout_ms, std::atomic<size_t>& active_connections, Resume resume);
+    ~IdlePoller();
+    
+    IdlePoller(const IdlePoller&) = delete;
+    IdlePoller& operator=(const IdlePoller&) = delete;
+    
+    // Start the polling thread; false if it could not be set up
+    bool start();
+    
+    // Watch a quiet connection until it is readable (thread-safe). Once
+    // stopped, the connection is closed instead.
+    void park(std::shared_ptr<ClientHandler> handler);
+    
+    // Join the polling thread and close the parked connections
+    void stop();
+    
+    // Connections currently parked
+    size_t getParkedConnections() const;
+    
+private:
+    struct Parked {
+        std::shared_ptr<ClientHandler> handler;
+        std::chrono::steady_clock::time_point since;
+    };
+    
+    int epoll_fd_;
+    int wake_fd_;                           // Written by stop() to end the wait
+    int idle_timeout_ms_;
+    std::atomic<size_t>& active_connections_;
+    Resume resume_;
+    
+    mutable std::mutex mutex_;
+    std::unordered_map<int, Parked> parked_;    // By client socket
+    bool stopped_;
+    std::thread thread_;
+    
+    // Polling loop: resume ready connections, close idle ones
+    void run();
+    
+    // Close the unsubscribed connections parked for the idle timeout
+    void closeIdle(std::chrono::steady_clock::time_point now);
+    
+    // Watch fd for the next event reported as socket's, registering it if
+    // epoll does not know it yet
+    bool arm(int fd, int socket);
+    
+    // Stop watching a connection's descriptors before it is closed; the
+    // mutex must be held
+    void unwatch(const ClientHandler& handler);
+};
+
+#endif // IDLE_POLLER_H
\ No newline at end of file
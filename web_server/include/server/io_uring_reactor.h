@@ -0,0 +1,166 @@
+#ifndef IO_URING_REACTOR_H
+#define IO_URING_REACTOR_H
+
+#include <string>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+#include <liburing.h>
+#include "client_handler.h"
+#include "data_cache.h"
+#include "client_stats.h"
+#include "server_metrics.h"
+#include "server_config.h"
+#include "admission_control.h"
+#include "output_queue.h"
+#include <common/input_buffer.h>
+
+// Single-threaded event loop on io_uring. One multishot accept keeps taking
+// connections, every connection has one multishot recv that fills buffers
+// from a ring the kernel picks from, and responses are written with sendmsg
+// requests. Everything queued while handling a batch of completions goes to
+// the kernel in one io_uring_enter, together with the wait for the next
+// batch. Requests are parsed and answered by ClientHandler::processInput, as
+// in the epoll reactor, which is the fallback when io_uring is unavailable.
+// A subscribed connection also keeps a poll of its subscription eventfd in
+// flight, which completes when new entries are waiting to be sent. Likewise
+// a read of an eventfd the write-ahead log signals releases the responses
+// held until the entries they acknowledge are durable.
+class IoUringReactor {
+public:
+    IoUringReactor(int listen_socket, DataCache& cache, ClientStats& stats, ServerMetrics& metrics,
+                   AdmissionControl& admission, std::atomic<bool>& server_running,
+                   std::atomic<size_t>& active_connections, const ServerConfig& config);
+    ~IoUringReactor();
+    
+    IoUringReactor(const IoUringReactor&) = delete;
+    IoUringReactor& operator=(const IoUringReactor&) = delete;
+    
+    // Set up the ring and the receive buffers. False if the kernel lacks
+    // io_uring or one of the features used.
+    bool open();
+    
+    // Run the event loop until the server stops
+    void run();
+    
+private:
+    // Segments one sendmsg request carries
+    static const size_t SEND_IOVECS = 64;
+    
+    // Operation of a submission, kept in the low bits of its user data
+    enum class Operation : uint8_t {
+        ACCEPT,
+        RECV,
+        SEND,
+        WAKE,
+        DURABLE,
+        CANCEL
+    };
+    
+    // Part of a receive buffer that did not fit into a full input buffer
+    struct HeldBuffer {
+        uint16_t id;
+        size_t offset;
+        size_t length;
+    };
+    
+    struct Connection {
+        explicit Connection(size_t max_message_size) : input(max_message_size) {}
+        
+        std::unique_ptr<ClientHandler> handler;
+        InputBuffer input;
+        OutputQueue output;
+        std::deque<HeldBuffer> held;    // Returned to the ring once copied into input
+        
+        // The in-flight sendmsg reads these and output until it completes
+        struct msghdr message;
+        struct iovec iov[SEND_IOVECS];
+        
+        size_t in_flight = 0;           // Submitted requests that will still complete
+        bool receiving = false;         // The multishot recv is armed
+        bool sending = false;
+        bool watching = false;          // The subscription eventfd poll is armed
+        bool paused = false;            // Input is full; recv cancelled until it drains
+        bool starved = false;           // recv ended because every buffer was taken
+        bool peer_closed = false;
+        bool syncing = false;           // Output held until the entries it acknowledges are durable
+        bool closing = false;           // Flush the output, then close
+        bool closed = false;            // Waiting for in-flight requests before the socket is closed
+        std::chrono::steady_clock::time_point last_activity;
+    };
+    
+    int listen_socket_;
+    DataCache& cache_;
+    ClientStats& stats_;
+    ServerMetrics& metrics_;
+    AdmissionControl& admission_;
+    std::atomic<bool>& server_running_;
+    std::atomic<size_t>& active_connections_;
+    const ServerConfig& config_;
+    
+    struct io_uring ring_;
+    bool ring_ready_;
+    struct io_uring_buf_ring* buffer_ring_;
+    std::unique_ptr<char[]> buffers_;
+    bool accepting_;
+    
+    // Connections whose recv waits for a buffer to be returned to the ring
+    std::vector<int> starved_;
+    bool buffers_returned_;
+    
+    // Signalled by the write-ahead log (-1 without one), and the
+    // connections whose output waits for it
+    int durable_fd_;
+    uint64_t durable_count_;
+    std::unordered_set<int> syncing_;
+    
+    std::unordered_map<int, Connection> connections_;
+    std::chrono::steady_clock::time_point last_idle_sweep_;
+    
+    // A free submission entry, submitting the queued ones if the ring is full
+    struct io_uring_sqe* nextSqe();
+    
+    void armAccept();
+    void armRecv(int fd, Connection& conn);
+    void submitSend(int fd, Connection& conn);
+    void armWake(int fd, Connection& conn);
+    void armDurable();
+    void cancel(int fd, Operation operation);
+    
+    // Dispatch one completion
+    void handleCompletion(const struct io_uring_cqe* cqe);
+    void handleAccept(const struct io_uring_cqe* cqe);
+    void handleRecv(int fd, Connection& conn, const struct io_uring_cqe* cqe);
+    void handleSend(int fd, Connection& conn, const struct io_uring_cqe* cqe);
+    void handleWake(int fd, Connection& conn, const struct io_uring_cqe* cqe);
+    void handleDurable(const struct io_uring_cqe* cqe);
+    
+    // Copy received bytes into the input buffer, holding back what does not fit
+    void deliver(int fd, Connection& conn, uint16_t buffer_id, size_t length);
+    
+    // Move held bytes into the input buffer as parsing frees space
+    void drainHeld(Connection& conn);
+    
+    // Hand a receive buffer back to the kernel
+    void recycleBuffer(uint16_t buffer_id);
+    
+    // Re-arm the recv of starved connections once buffers are back
+    void resumeStarved();
+    
+    // Parse buffered requests and start sending their responses
+    void advance(int fd, Connection& conn);
+    
+    // Close connections that have been idle past the timeout
+    void closeIdleConnections();
+    
+    // Stop all I/O on a connection and close it once nothing is in flight
+    void closeConnection(int fd);
+    void releaseIfIdle(int fd, Connection& conn);
+};
+
+#endif // IO_URING_REACTOR_H
\ No newline at end of file
@@ -0,0 +1,70 @@
+#ifndef OUTPUT_QUEUE_H
+#define OUTPUT_QUEUE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+// Bytes queued for one connection, written to the socket with scatter-gather
+// sendmsg(). Small pieces are copied into an internal buffer; preserialized
+// responses and large payloads are referenced in place, so they reach the
+// kernel without another copy. Storage keeps its capacity once the queue
+// drains, so a warmed-up connection queues responses without allocating.
+class OutputQueue {
+public:
+    OutputQueue();
+    
+    // Copy data into the queue
+    void append(std::string_view data);
+    
+    // Reference data that stays valid until it has been written, such as a
+    // preserialized response or a payload in a chunk passed to retain()
+    void appendView(std::string_view data);
+    
+    // Keep owner alive until the queue has been drained
+    void retain(std::shared_ptr<const char[]> owner);
+    
+    // Queue length bytes to be filled in through at(); returns their position
+    size_t reserve(size_t length);
+    
+    // Reserved bytes at position; valid until the next append or reserve
+    char* at(size_t position);
+    
+    // Bytes queued and not yet written
+    size_t size() const;
+    bool empty() const;
+    
+    // Write as much as the socket accepts in one sendmsg() call. Returns the
+    // bytes written, or -1 with errno set (EAGAIN on a full non-blocking socket).
+    ssize_t writeTo(int fd);
+    
+    // Describe up to max pending segments in iov, for a caller that submits
+    // the write itself. Returns the iovecs filled; they stay valid until the
+    // next append, reserve or consume.
+    size_t gather(struct iovec* iov, size_t max) const;
+    
+    // Drop bytes that have been written from the front of the queue
+    void consume(size_t length);
+    
+    void clear();
+    
+private:
+    struct Segment {
+        const char* data;   // nullptr for bytes in buffer_
+        size_t offset;      // Position in buffer_ when data is nullptr
+        size_t length;
+    };
+    
+    std::string buffer_;
+    std::vector<Segment> segments_;
+    std::vector<std::shared_ptr<const char[]>> owners_;
+    size_t head_;           // First segment not completely written
+    size_t head_written_;   // Bytes of the head segment already written
+    size_t size_;
+};
+
+#endif // OUTPUT_QUEUE_H
\ No newline at end of file
@@ -0,0 +1,84 @@
+#ifndef SERVER_CONFIG_H
+#define SERVER_CONFIG_H
+
+#include <string>
+#include <common/protocol.h>
+#include <common/logger.h>
+#include "thread_pool.h"
+#include "data_cache.h"
+#include "write_ahead_log.h"
+#include "subscription_hub.h"
+
+// Connection handling model used by TCPServer
+enum class ServerMode {
+    THREAD_POOL,            // Blocking accept, clients served by a bounded worker pool
+    EPOLL,                  // Edge-triggered epoll reactor with non-blocking sockets
+    REUSEPORT,              // One SO_REUSEPORT listener and epoll reactor per worker thread
+    IO_URING                // io_uring event loop; falls back to EPOLL where unavailable
+};
+
+// Startup configuration for TCPServer
+struct ServerConfig {
+    std::string port = Protocol::DEFAULT_PORT;
+    ServerMode mode = ServerMode::THREAD_POOL;
+    
+    // Persistent connections are closed after this long without traffic
+    int idle_timeout_ms = 30000;
+    
+    // Largest request frame a client may send before it is disconnected
+    size_t max_message_size = Protocol::DEFAULT_MAX_MESSAGE_SIZE;
+    
+    // Worker pool settings (THREAD_POOL mode); 0 workers means one per core.
+    // In REUSEPORT mode worker_threads is the number of listeners.
+    size_t worker_threads = 0;
+    size_t queue_capacity = 1024;
+    OverflowPolicy overflow_policy = OverflowPolicy::REJECT;
+    
+    // Pin each REUSEPORT listener thread to its own CPU
+    bool cpu_affinity = false;
+    
+    // Independent DataCache shards; 0 means one per core
+    size_t cache_shards = 1;
+    
+    // Payload bytes the cache may hold, and how it makes room when full.
+    // The TTL applies to EvictionPolicy::TTL only.
+    size_t cache_max_bytes = DataCache::DEFAULT_MAX_BYTES;
+    EvictionPolicy eviction_policy = EvictionPolicy::FIFO;
+    int cache_ttl_ms = 300000;
+    
+    // Write-ahead log for cached entries; empty disables persistence.
+    // POSTs are acknowledged once durable in the chosen sync mode.
+    std::string wal_path;
+    WalSyncMode wal_sync_mode = WalSyncMode::FSYNC;
+    int wal_sync_interval_ms = 100;
+    
+    // Periodic cache snapshot; empty disables snapshots. At startup the
+    // snapshot is mapped and only the log written after it is replayed.
+    std::string snapshot_path;
+    int snapshot_interval_ms = 60000;
+    
+    // Frames each GET /data/subscribe connection may have waiting, and what
+    // happens to a subscriber that falls that far behind
+    size_t subscriber_queue = SubscriptionHub::DEFAULT_QUEUE_CAPACITY;
+    SlowSubscriberPolicy slow_subscriber_policy = SlowSubscriberPolicy::DROP;
+    
+    // Admission control; 0 disables each limit. Past max_connections open
+    // connections new ones are refused at accept. Each peer address may
+    // open connection_rate connections and send request_rate requests per
+    // second, in bursts of up to the burst size (0: one second's worth).
+    size_t max_connections = 0;
+    size_t connection_rate = 0;
+    size_t connection_burst = 0;
+    size_t request_rate = 0;
+    size_t request_burst = 0;
+    
+    // THREAD_POOL mode: refuse new connections while this many wait for a
+    // worker, below the queue capacity so queued clients are served
+    // promptly; 0 disables shedding
+    size_t shed_queue_depth = 0;
+    
+    // Records below this level are discarded without being formatted
+    LogLevel log_level = LogLevel::INFO;
+};
+
+#endif // SERVER_CONFIG_H
\ No newline at end of file
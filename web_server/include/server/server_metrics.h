@@ -0,0 +1,114 @@
+#ifndef SERVER_METRICS_H
+#define SERVER_METRICS_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+#include <cstdint>
+#include <common/protocol.h>
+
+// Server-wide counters and per-path latency histograms, exported in the
+// Prometheus text format by GET /metrics.
+//
+// Every thread records into its own slot, registered on first use, with
+// relaxed load/store pairs on single-writer atomics: the request path takes
+// no lock and performs no contended read-modify-write. Histograms have
+// fixed buckets, so recording is a short search over constant bounds.
+// Slots are only summed when the metrics are scraped. Values such as the
+// cache size are read at scrape time through registered gauges.
+class ServerMetrics {
+public:
+    using Gauge = std::function<double()>;
+    
+    // Why a connection was turned away at accept
+    enum class RejectReason {
+        QUEUE_FULL,         // The worker queue was at capacity
+        OVERLOADED,         // The worker queue was past the shedding threshold
+        CONNECTION_LIMIT,   // The server had its maximum of connections open
+        CONNECTION_RATE     // The peer address was over its connection rate
+    };
+    
+    // Accepts are also counted per listening socket, each written only by
+    // the thread that accepts on it
+    explicit ServerMetrics(size_t listeners = 1);
+    
+    ServerMetrics(const ServerMetrics&) = delete;
+    ServerMetrics& operator=(const ServerMetrics&) = delete;
+    
+    // A request answered with status, and the bytes it took on the wire
+    void recordRequest(Protocol::Method method, Protocol::PathId path, uint16_t status,
+                       size_t bytes_in, size_t bytes_out);
+    
+    // Time from receiving a request to having sent its response
+    void recordLatency(Protocol::PathId path, std::chrono::nanoseconds latency);
+    
+    // Connections accepted on a listener, and connections then turned away
+    void recordAccepted(size_t listener = 0);
+    void recordRejected(RejectReason reason);
+    
+    size_t getListenerCount() const;
+    uint64_t getAcceptedConnections(size_t listener) const;
+    
+    // Export value() as a gauge. Register before serving requests.
+    void addGauge(const std::string& name, const std::string& help, Gauge value);
+    
+    // All metrics in the Prometheus text exposition format
+    std::string render() const;
+    
+    // Label value of a reject reason, e.g. "queue_full"
+    static const char* rejectReasonToString(RejectReason reason);
+    
+private:
+    static const size_t METHOD_LABELS = 3;      // GET, POST, anything else
+    static const size_t PATH_LABELS = static_cast<size_t>(Protocol::PathId::DATA_SUBSCRIBE) + 1;  // UNKNOWN first
+    static const size_t STATUS_LABELS = 8;      // STATUS_CODES plus "other"
+    static const size_t REJECT_REASONS = static_cast<size_t>(RejectReason::CONNECTION_RATE) + 1;
+    static const size_t LATENCY_BUCKETS = 20;   // LATENCY_BOUNDS_NS plus +Inf
+    
+    // Padded to a cache line so threads never share one
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> requests[METHOD_LABELS][PATH_LABELS];
+        std::atomic<uint64_t> responses[STATUS_LABELS];
+        std::atomic<uint64_t> bytes_in;
+        std::atomic<uint64_t> bytes_out;
+        std::atomic<uint64_t> rejected[REJECT_REASONS];
+        std::atomic<uint64_t> latency_buckets[PATH_LABELS][LATENCY_BUCKETS];   // Not cumulative
+        std::atomic<uint64_t> latency_sum_ns[PATH_LABELS];
+    };
+    
+    // Also one cache line each, so listener threads do not share one
+    struct alignas(64) ListenerCounter {
+        std::atomic<uint64_t> accepted{0};
+    };
+    
+    struct RegisteredGauge {
+        std::string name;
+        std::string help;
+        Gauge value;
+    };
+    
+    // Identifies this instance in the thread-local slot cache; addresses
+    // can be reused, ids are not
+    const uint64_t id_;
+    
+    size_t listener_count_;
+    std::unique_ptr<ListenerCounter[]> listeners_;
+    
+    mutable std::mutex mutex_;
+    std::unordered_map<std::thread::id, std::unique_ptr<Slot>> slots_;
+    std::vector<RegisteredGauge> gauges_;
+    
+    // Slot of the calling thread; the lock is taken only the first time
+    Slot& slotForThisThread();
+    
+    static size_t statusIndex(uint16_t status);
+    static size_t latencyBucket(std::chrono::nanoseconds latency);
+};
+
+#endif // SERVER_METRICS_H
\ No newline at end of file
@@ -0,0 +1,176 @@
+#ifndef SUBSCRIPTION_HUB_H
+#define SUBSCRIPTION_HUB_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <common/protocol.h>
+
+class DataCache;
+
+// What happens to a subscriber whose queue is full when a new entry arrives
+enum class SlowSubscriberPolicy {
+    DROP,       // Skip the entry; the subscriber sees a gap in the sequence numbers
+    DISCONNECT  // End the subscription and close the connection
+};
+
+// A new entry framed as a one-entry GET /data response in one encoding.
+// Every subscriber using that encoding queues the same buffer.
+struct StreamFrame {
+    uint64_t seq = 0;
+    std::shared_ptr<const char[]> data;
+    size_t length = 0;
+};
+
+// Receiving end of GET /data/subscribe. Writer threads queue frames
+// through the hub; the connection that owns the subscription takes them on
+// its own thread, woken through an eventfd that becomes readable when the
+// queue stops being empty. The queue is bounded, so a subscriber that does
+// not keep up costs memory for at most capacity frames.
+class Subscription {
+public:
+    Subscription(Protocol::Encoding encoding, size_t capacity, SlowSubscriberPolicy policy, uint64_t live_from);
+    ~Subscription();
+    
+    Subscription(const Subscription&) = delete;
+    Subscription& operator=(const Subscription&) = delete;
+    
+    // Readable while frames are waiting; -1 if the eventfd could not be created
+    int getWakeFd() const;
+    
+    Protocol::Encoding getEncoding() const;
+    
+    // Entries from this sequence number on arrive as frames; the ones
+    // before it were in the cache when the subscription started
+    uint64_t getLiveFrom() const;
+    
+    // Move the queued frames to the end of frames and reset the wake-up.
+    // Returns false once the subscription has been cut off.
+    bool take(std::vector<StreamFrame>& frames);
+    
+    // Frames skipped because the queue was full
+    uint64_t getDroppedFrames() const;
+    
+private:
+    friend class SubscriptionHub;
+    
+    Protocol::Encoding encoding_;
+    size_t capacity_;
+    SlowSubscriberPolicy policy_;
+    uint64_t live_from_;
+    int wake_fd_;
+    
+    mutable std::mutex mutex_;
+    std::deque<StreamFrame> queue_;
+    bool cut_off_;
+    std::atomic<uint64_t> dropped_;
+    
+    // Queue a frame without ever waiting for the owner. A full queue drops
+    // it, or cuts the subscription off under the DISCONNECT policy.
+    // Returns false if the frame was not queued.
+    bool offer(const StreamFrame& frame);
+    
+    // Make the wake-up descriptor readable; the mutex must be held
+    void wake();
+};
+
+// Fans new cache entries out to the open subscriptions. DataCache calls
+// publish() after storing entries and releasing the shard lock; it only
+// wakes the hub's publisher thread, so writers never frame or queue entries
+// themselves. Writers on different shards finish in any order, so the
+// publisher reads the entries up to the cache's committed watermark and
+// delivers them in sequence order. Each entry is framed once per encoding
+// in use and the frame is shared by reference between the subscriber
+// queues, so delivery never copies a payload per subscriber. With no
+// subscribers a publish is one atomic load.
+class SubscriptionHub {
+public:
+    static constexpr size_t DEFAULT_QUEUE_CAPACITY = 1024;
+    
+    // Entries a publisher reads from the cache per lookup
+    static constexpr size_t PUBLISH_PAGE = 256;
+    
+    explicit SubscriptionHub(DataCache& cache, size_t queue_capacity = DEFAULT_QUEUE_CAPACITY,
+                             SlowSubscriberPolicy policy = SlowSubscriberPolicy::DROP);
+    ~SubscriptionHub();
+    
+    SubscriptionHub(const SubscriptionHub&) = delete;
+    SubscriptionHub& operator=(const SubscriptionHub&) = delete;
+    
+    // Start a subscription that receives every entry from its live_from on,
+    // in sequence order; all entries before it are already in the cache
+    // (thread-safe). Returns nullptr if its eventfd cannot be created.
+    std::shared_ptr<Subscription> subscribe(Protocol::Encoding encoding);
+    
+    // Stop queueing frames for a subscription (thread-safe). Returns false
+    // if it had already ended.
+    bool unsubscribe(const std::shared_ptr<Subscription>& subscription);
+    
+    // Have the publisher thread deliver the newly committed entries to every
+    // subscriber (thread-safe). Never waits for a delivery.
+    void publish();
+    
+    size_t getSubscriberCount() const;
+    
+    // Frames dropped and subscribers disconnected because a queue was full
+    uint64_t getDroppedFrames() const;
+    uint64_t getDisconnectedSubscribers() const;
+    
+    // Parse "drop" or "disconnect"
+    static bool parsePolicy(const std::string& name, SlowSubscriberPolicy& policy);
+    static const char* policyToString(SlowSubscriberPolicy policy);
+    
+private:
+    using SubscriberList = std::vector<std::shared_ptr<Subscription>>;
+    
+    DataCache& cache_;
+    size_t queue_capacity_;
+    SlowSubscriberPolicy policy_;
+    
+    // Replaced on every change, never modified, so publishers only hold
+    // the mutex to copy the pointer
+    mutable std::mutex mutex_;
+    std::shared_ptr<const SubscriberList> subscribers_;
+    std::atomic<size_t> subscriber_count_;
+    
+    // Held by the publisher while delivering; published_ is the first
+    // sequence number it has not delivered yet
+    std::mutex publish_mutex_;
+    uint64_t published_;
+    
+    // Raised by writers, cleared by the publisher before each delivery. The
+    // signal mutex only orders the flag with the publisher going to sleep.
+    std::atomic<bool> publish_pending_;
+    std::mutex signal_mutex_;
+    std::condition_variable publish_cv_;
+    bool stopping_;
+    std::thread publisher_;
+    
+    std::atomic<uint64_t> dropped_frames_;
+    std::atomic<uint64_t> disconnected_;
+    
+    // Current subscribers, or nullptr if there are none
+    std::shared_ptr<const SubscriberList> snapshot() const;
+    
+    // Publisher thread: deliver whenever a writer raised the flag
+    void publishLoop();
+    
+    // Deliver the entries from published_ up to the committed watermark;
+    // publish_mutex_ must be held
+    void deliverCommitted();
+    
+    // Queue one entry for the subscriptions it is live for
+    void deliver(const SubscriberList& subscribers, uint64_t seq, std::string_view data);
+    
+    // Frame an entry as "200 OK – 1 entries; next=SEQ; SEQ:LEN:DATA"
+    static StreamFrame makeFrame(uint64_t seq, std::string_view data, Protocol::Encoding encoding);
+};
+
+#endif // SUBSCRIPTION_HUB_H
\ No newline at end of file
@@ -3,15 +3,24 @@
 
 #include <string>
 #include <vector>
-#include <thread>
 #include <atomic>
 #include <memory>
 #include "data_cache.h"
+#include "client_stats.h"
+#include "server_metrics.h"
+#include "server_config.h"
+#include "thread_pool.h"
+#include "idle_poller.h"
+#include "write_ahead_log.h"
+#include "cache_snapshot.h"
+#include "subscription_hub.h"
+#include "admission_control.h"
 #include <common/protocol.h>
 
 class TCPServer {
 public:
     TCPServer(const std::string& port = Protocol::DEFAULT_PORT);
+    explicit TCPServer(const ServerConfig& config);
     ~TCPServer();
     
     // Start the server
@@ -29,26 +38,86 @@ public:
     // Get number of active connections
     size_t getActiveConnections() const;
     
+    // Get number of connections waiting for a worker
+    size_t getQueueDepth() const;
+    
+    // Get number of connections parked until they send again
+    size_t getIdleConnections() const;
+    
+    // Get fraction of workers currently serving a client (0.0 - 1.0)
+    double getWorkerUtilization() const;
+    
+    // Get number of connections rejected because the queue was full
+    size_t getRejectedConnections() const;
+    
+    // Get per-client request statistics
+    const ClientStats& getClientStats() const;
+    
+    // Get the counters and histograms served by GET /metrics
+    const ServerMetrics& getMetrics() const;
+    
 private:
+    ServerConfig config_;
     std::string port_;
     int sockfd_;
+    std::vector<int> reuseport_sockets_;    // One per listener in REUSEPORT mode
     std::atomic<bool> running_;
     std::atomic<size_t> active_connections_;
     
     DataCache cache_;
-    std::vector<std::thread> client_threads_;
+    SubscriptionHub subscriptions_;
+    ClientStats stats_;
+    ServerMetrics metrics_;
+    AdmissionControl admission_;
+    std::unique_ptr<ThreadPool> pool_;
+    std::unique_ptr<IdlePoller> idle_poller_;   // Quiet connections in THREAD_POOL mode
+    std::unique_ptr<WriteAheadLog> wal_;
+    std::unique_ptr<CacheSnapshot> snapshots_;
+    
+    // Export connection, worker, admission, cache, subscription and logger
+    // state as gauges
+    void registerGauges();
+    
+    // Load the latest snapshot and the log written after it, then start
+    // logging and periodic snapshots as configured
+    bool restoreCache();
+    
+    // Open the write-ahead log, replay the records from offset with a
+    // sequence number of at least first_seq into the cache and start logging
+    bool openWriteAheadLog(uint64_t offset, uint64_t first_seq);
     
     // Initialize socket and bind to port
     bool initializeSocket();
     
+    // Open a listening socket on port_, with SO_REUSEPORT if reuse_port.
+    // Returns -1 on failure.
+    int openListeningSocket(bool reuse_port);
+    
+    // Listeners to open in REUSEPORT mode
+    static size_t listenerCount(const ServerConfig& config);
+    
     // Accept incoming connections
     void acceptConnections();
     
-    // Handle individual client in separate thread
-    void handleClient(int client_socket);
+    // Serve all connections from one event loop: io_uring in IO_URING mode
+    // where the build and the kernel support it, epoll otherwise
+    void runEventLoop();
+    
+    // Run one event loop per SO_REUSEPORT listener, each on its own thread
+    void runListeners();
+    
+    // Handle individual client on a worker thread
+    void handleClient(const std::shared_ptr<ConnectionContext>& context);
+    
+    // Serve a client on a worker thread until it closes or goes quiet,
+    // then park it with the idle poller
+    void serveClient(std::shared_ptr<ClientHandler> handler);
+    
+    // Give a parked client that became readable back to the workers
+    void resumeClient(std::shared_ptr<ClientHandler> handler);
     
-    // Cleanup finished threads
-    void cleanupThreads();
+    // Turn away a client when the worker queue is full
+    void rejectClient(int client_socket);
     
     // Setup signal handlers for graceful shutdown
     void setupSignalHandlers();
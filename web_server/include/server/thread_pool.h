@@ -0,0 +1,62 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+// What submit() does when the task queue is full
+enum class OverflowPolicy {
+    REJECT,  // Fail immediately so the caller can shed the work
+    BLOCK    // Wait for a free slot, deferring the caller
+};
+
+// Fixed-size pool of worker threads fed by a bounded FIFO task queue
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+    
+    // A worker count of 0 sizes the pool from the number of cores
+    ThreadPool(size_t num_workers = 0, size_t queue_capacity = 1024,
+               OverflowPolicy policy = OverflowPolicy::REJECT);
+    ~ThreadPool();
+    
+    // Queue a task (thread-safe). Returns false if it was rejected.
+    bool submit(Task task);
+    
+    // Run the queued tasks to completion and join all workers
+    void shutdown();
+    
+    // Statistics (thread-safe)
+    size_t getWorkerCount() const;
+    size_t getQueueCapacity() const;
+    size_t getQueueDepth() const;
+    size_t getBusyWorkers() const;
+    double getUtilization() const;
+    size_t getRejectedTasks() const;
+    
+private:
+    std::vector<std::thread> workers_;
+    
+    // Ring buffer of pending tasks
+    std::vector<Task> queue_;
+    size_t head_;
+    size_t count_;
+    
+    OverflowPolicy policy_;
+    bool stopping_;
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    
+    std::atomic<size_t> busy_workers_;
+    std::atomic<size_t> rejected_tasks_;
+    
+    // Worker loop: pop and run tasks until shutdown
+    void workerLoop();
+};
+
+#endif // THREAD_POOL_H
\ No newline at end of file
@@ -0,0 +1,122 @@
+#ifndef WRITE_AHEAD_LOG_H
+#define WRITE_AHEAD_LOG_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <cstdint>
+
+// When an appended record counts as durable
+enum class WalSyncMode {
+    FSYNC,      // After the batch holding it has been fdatasync'ed
+    INTERVAL,   // After it has been written; the file is synced every interval
+    OS          // After it has been written; the kernel decides when to sync
+};
+
+// Append-only log of cache entries. Every record carries its sequence
+// number and a CRC-32, so a torn or corrupt tail is detected on replay and
+// cut off. Appends from many threads are group-committed: writers copy
+// their record into a shared buffer and a flusher thread writes each
+// accumulated batch with one write() and, in FSYNC mode, one fdatasync().
+//
+// File layout: an 8-byte magic, then records of
+//   [u32 payload length][u32 crc of seq and payload][u64 seq][payload]
+// with integers in little-endian byte order.
+class WriteAheadLog {
+public:
+    WriteAheadLog(const std::string& path, WalSyncMode mode, int sync_interval_ms);
+    ~WriteAheadLog();
+    
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+    
+    // Open or create the file and check its header
+    bool open();
+    
+    // Hand every intact record from offset on to apply, in file order, then
+    // truncate whatever follows the last intact record. Payload views are
+    // only valid during the call. Must run before start().
+    bool replay(uint64_t offset, const std::function<void(uint64_t seq, std::string_view payload)>& apply);
+    
+    // Start the flusher thread
+    void start();
+    
+    // Queue a record (thread-safe). Returns the log position to pass to
+    // waitDurable().
+    uint64_t append(uint64_t seq, std::string_view payload);
+    
+    // Queue records with consecutive sequence numbers from first_seq under
+    // a single lock (thread-safe). Returns the position after the last one.
+    uint64_t appendBatch(uint64_t first_seq, const std::vector<std::string_view>& payloads);
+    
+    // Block until everything up to position is durable in the configured
+    // mode. Returns false if the log has failed.
+    bool waitDurable(uint64_t position);
+    
+    // waitDurable() without blocking: durable tells whether everything up
+    // to position is durable yet. Returns false if the log has failed.
+    bool pollDurable(uint64_t position, bool& durable) const;
+    
+    // Make event_fd (an eventfd) readable whenever the durable position
+    // advances or the log fails or closes, so an event loop can wait for
+    // pollDurable() to change instead of blocking (thread-safe)
+    void addDurableWatcher(int event_fd);
+    void removeDurableWatcher(int event_fd);
+    
+    // Write out and sync what is queued, then stop the flusher
+    void close();
+    
+    const std::string& getPath() const;
+    WalSyncMode getSyncMode() const;
+    
+    // Log position (bytes) that is durable in the configured mode
+    uint64_t getDurablePosition() const;
+    
+    // Log position just past the newest queued record
+    uint64_t getAppendedPosition() const;
+    
+    // Batches written and records appended since start
+    size_t getBatchCount() const;
+    size_t getRecordCount() const;
+    
+    // Parse "fsync", "interval" or "os"
+    static bool parseSyncMode(const std::string& name, WalSyncMode& mode);
+    static const char* syncModeToString(WalSyncMode mode);
+    
+private:
+    std::string path_;
+    WalSyncMode mode_;
+    int sync_interval_ms_;
+    int fd_;
+    
+    std::thread flusher_;
+    mutable std::mutex mutex_;
+    std::condition_variable pending_cv_;    // Flusher waits for records
+    std::condition_variable durable_cv_;    // Writers wait for their batch
+    std::vector<int> durable_watchers_;     // Eventfds woken along with durable_cv_
+    std::string pending_;                   // Records not yet handed to write()
+    uint64_t appended_position_;            // End of the last queued record
+    uint64_t written_position_;             // End of the data passed to write()
+    uint64_t synced_position_;              // End of the data known to be on disk
+    bool stopping_;
+    bool running_;
+    bool failed_;
+    
+    std::atomic<size_t> batches_;
+    std::atomic<size_t> records_;
+    
+    void flushLoop();
+    
+    // Signal the durable watchers; the mutex must be held
+    void notifyWatchers();
+    
+    // Write a whole buffer, retrying partial writes
+    bool writeAll(const std::string& data);
+};
+
+#endif // WRITE_AHEAD_LOG_H
\ No newline at end of file
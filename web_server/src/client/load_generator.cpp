@@ -0,0 +1,354 @@
+#include <client/load_generator.h>
+#include <common/input_buffer.h>
+#include <common/logger.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <deque>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <thread>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+    
+    // Connections start sending a moment after all threads are up
+    const auto START_DELAY = std::chrono::milliseconds(50);
+    
+    // Percentiles in the report and the JSON summary
+    const double REPORT_PERCENTILES[] = {50.0, 90.0, 99.0, 99.9, 99.99};
+    
+    struct BenchConnection {
+        explicit BenchConnection(int fd) : fd(fd), input(Protocol::DEFAULT_MAX_MESSAGE_SIZE) {}
+        
+        int fd;
+        bool open = true;
+        InputBuffer input;
+        std::string output;
+        size_t output_sent = 0;
+        std::deque<Clock::time_point> in_flight;   // Intended send times, oldest first
+        Clock::time_point next_send;               // Open loop only
+    };
+    
+    double toMicros(uint64_t nanos) {
+        return static_cast<double>(nanos) / 1000.0;
+    }
+    
+    std::string percentileKey(double percentile) {
+        std::ostringstream key;
+        key << "p" << percentile;
+        std::string text = key.str();
+        std::replace(text.begin(), text.end(), '.', '_');
+        return text;
+    }
+}
+
+LoadGenerator::LoadGenerator(const BenchConfig& config) : config_(config) {
+    config_.connections = std::max<size_t>(config_.connections, 1);
+    config_.threads = std::min(std::max<size_t>(config_.threads, 1), config_.connections);
+    config_.post_percent = std::min(config_.post_percent, 100u);
+}
+
+bool LoadGenerator::run(BenchResult& result) {
+    std::vector<std::vector<int>> sockets(config_.threads);
+    for (size_t i = 0; i < config_.connections; ++i) {
+        int fd = openConnection();
+        if (fd == -1) {
+            for (const std::vector<int>& thread_sockets : sockets) {
+                for (int open_fd : thread_sockets) {
+                    close(open_fd);
+                }
+            }
+            return false;
+        }
+        sockets[i % config_.threads].push_back(fd);
+    }
+    
+    // Each thread fills its own result; they are merged once all have finished
+    std::vector<BenchResult> thread_results(config_.threads);
+    std::vector<std::thread> threads;
+    Clock::time_point start = Clock::now() + START_DELAY;
+    size_t first_connection = 0;
+    for (size_t i = 0; i < config_.threads; ++i) {
+        threads.emplace_back(&LoadGenerator::runThread, this, i, std::cref(sockets[i]), first_connection, start,
+                             std::ref(thread_results[i]));
+        first_connection += sockets[i].size();
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    
+    result = BenchResult();
+    result.elapsed_s = static_cast<double>(config_.duration_s);
+    for (const BenchResult& thread_result : thread_results) {
+        result.requests += thread_result.requests;
+        result.errors += thread_result.errors;
+        result.unfinished += thread_result.unfinished;
+        result.failed_connections += thread_result.failed_connections;
+        result.latency_ns.merge(thread_result.latency_ns);
+    }
+    
+    for (const std::vector<int>& thread_sockets : sockets) {
+        for (int fd : thread_sockets) {
+            close(fd);
+        }
+    }
+    return true;
+}
+
+int LoadGenerator::openConnection() const {
+    struct addrinfo hints, *servinfo, *p;
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    
+    int rv = getaddrinfo(config_.host.c_str(), config_.port.c_str(), &hints, &servinfo);
+    if (rv != 0) {
+        Logger::logError("getaddrinfo: " + std::string(gai_strerror(rv)));
+        return -1;
+    }
+    
+    int fd = -1;
+    for (p = servinfo; p != NULL; p = p->ai_next) {
+        fd = socket(p->ai_family, p->ai_socktype | SOCK_CLOEXEC, p->ai_protocol);
+        if (fd == -1) {
+            continue;
+        }
+        if (::connect(fd, p->ai_addr, p->ai_addrlen) == 0) {
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(servinfo);
+    
+    if (fd == -1) {
+        Logger::logError("bench: failed to connect to " + config_.host + ":" + config_.port);
+        return -1;
+    }
+    
+    int yes = 1;
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes)) == -1 ||
+        flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+        Logger::logError("bench: failed to configure socket: " + std::string(strerror(errno)));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void LoadGenerator::runThread(size_t index, const std::vector<int>& sockets, size_t first_connection,
+                              Clock::time_point start, BenchResult& result) const {
+    std::mt19937 rng(config_.seed + static_cast<uint32_t>(index));
+    std::uniform_int_distribution<unsigned> percent(0, 99);
+    
+    // Requests are encoded once; the payload is printable and free of delimiters
+    std::string payload(config_.payload_size, '\0');
+    std::uniform_int_distribution<int> printable('!', '~');
+    for (char& c : payload) {
+        c = static_cast<char>(printable(rng));
+    }
+    auto encode = [this](Protocol::Method method, const std::string& path, const std::string& body) {
+        return config_.encoding == Protocol::Encoding::BINARY ? Protocol::encodeBinaryRequest(method, path, body)
+                                                              : Protocol::formatRequest(method, path, body);
+    };
+    const std::string get_request = encode(Protocol::Method::GET, std::string(Protocol::PATH_STATUS), "");
+    const std::string post_request = encode(Protocol::Method::POST, std::string(Protocol::PATH_DATA), payload);
+    
+    Clock::time_point measure_from = start + std::chrono::seconds(config_.warmup_s);
+    Clock::time_point end = measure_from + std::chrono::seconds(config_.duration_s);
+    bool open_loop = config_.rate > 0;
+    auto interval = open_loop ? std::chrono::nanoseconds(std::max<uint64_t>(
+                                    1000000000ull * config_.connections / config_.rate, 1))
+                              : std::chrono::nanoseconds(0);
+    
+    std::vector<BenchConnection> connections;
+    connections.reserve(sockets.size());
+    for (size_t i = 0; i < sockets.size(); ++i) {
+        connections.emplace_back(sockets[i]);
+        // Spread the open-loop schedules so connections do not send in bursts
+        connections.back().next_send = start + interval * (first_connection + i) / config_.connections;
+    }
+    
+    auto queueRequest = [&](BenchConnection& conn, Clock::time_point intended) {
+        conn.output += percent(rng) < config_.post_percent ? post_request : get_request;
+        conn.in_flight.push_back(intended);
+    };
+    auto closeConnection = [&](BenchConnection& conn) {
+        conn.open = false;
+        result.failed_connections++;
+    };
+    
+    std::this_thread::sleep_until(start);
+    std::vector<struct pollfd> pfds(connections.size());
+    
+    while (true) {
+        Clock::time_point now = Clock::now();
+        if (now >= end) {
+            break;
+        }
+        
+        Clock::time_point wake = end;
+        for (BenchConnection& conn : connections) {
+            if (!conn.open) {
+                continue;
+            }
+            
+            if (open_loop) {
+                while (conn.next_send <= now) {
+                    queueRequest(conn, conn.next_send);
+                    conn.next_send += interval;
+                }
+                wake = std::min(wake, conn.next_send);
+            } else if (conn.in_flight.empty()) {
+                queueRequest(conn, now);
+            }
+            
+            // Send what the socket takes; the rest waits for POLLOUT
+            while (conn.output_sent < conn.output.size()) {
+                ssize_t sent = send(conn.fd, conn.output.data() + conn.output_sent,
+                                    conn.output.size() - conn.output_sent, MSG_NOSIGNAL);
+                if (sent > 0) {
+                    conn.output_sent += sent;
+                } else if (errno != EINTR) {
+                    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                        closeConnection(conn);
+                    }
+                    break;
+                }
+            }
+            if (conn.output_sent == conn.output.size()) {
+                conn.output.clear();
+                conn.output_sent = 0;
+            }
+        }
+        
+        for (size_t i = 0; i < connections.size(); ++i) {
+            BenchConnection& conn = connections[i];
+            pfds[i].fd = conn.open ? conn.fd : -1;
+            pfds[i].events = conn.output.empty() ? POLLIN : POLLIN | POLLOUT;
+            pfds[i].revents = 0;
+        }
+        
+        // Nanosecond timeout keeps high open-loop rates on schedule
+        auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(wake - now);
+        struct timespec timeout;
+        timeout.tv_sec = static_cast<time_t>(wait.count() / 1000000000);
+        timeout.tv_nsec = static_cast<long>(wait.count() % 1000000000);
+        if (ppoll(pfds.data(), pfds.size(), &timeout, nullptr) <= 0) {
+            continue;
+        }
+        
+        now = Clock::now();
+        for (size_t i = 0; i < connections.size(); ++i) {
+            BenchConnection& conn = connections[i];
+            if (!conn.open || !(pfds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            
+            // One read per wakeup; poll reports the socket again while data is left
+            ssize_t received = conn.input.readFrom(conn.fd);
+            if (received == 0 || (received == -1 && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                closeConnection(conn);
+                continue;
+            }
+            
+            // Responses come back in request order
+            std::string_view body;
+            size_t frame_length;
+            while (!conn.in_flight.empty() && Protocol::nextResponseFrame(conn.input.data(), body, frame_length)) {
+                Clock::time_point intended = conn.in_flight.front();
+                conn.in_flight.pop_front();
+                if (intended >= measure_from) {
+                    uint16_t status = Protocol::responseStatus(body);
+                    result.requests++;
+                    if (status < 200 || status >= 300) {
+                        result.errors++;
+                    }
+                    result.latency_ns.record(static_cast<uint64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(now - intended).count()));
+                }
+                conn.input.consume(frame_length);
+            }
+        }
+    }
+    
+    for (const BenchConnection& conn : connections) {
+        for (Clock::time_point intended : conn.in_flight) {
+            if (intended >= measure_from) {
+                result.unfinished++;
+            }
+        }
+    }
+}
+
+void LoadGenerator::printReport(const BenchConfig& config, const BenchResult& result, std::ostream& out) {
+    out << (config.rate > 0 ? "Open-loop run at " + std::to_string(config.rate) + " requests/s" : "Closed-loop run")
+        << ": " << config.duration_s << " s after " << config.warmup_s << " s warmup, "
+        << config.connections << " connections, " << config.threads << " threads, "
+        << config.post_percent << "% POST /data (" << config.payload_size << " bytes), "
+        << (100 - config.post_percent) << "% GET /status, "
+        << (config.encoding == Protocol::Encoding::BINARY ? "binary" : "text") << " encoding" << std::endl;
+    
+    double throughput = result.elapsed_s > 0 ? static_cast<double>(result.requests) / result.elapsed_s : 0.0;
+    out << std::fixed << std::setprecision(1);
+    out << "Requests:     " << result.requests << " (" << throughput << " requests/s)" << std::endl;
+    out << "Errors:       " << result.errors << " non-2xx, " << result.unfinished << " unanswered, "
+        << result.failed_connections << " connections lost" << std::endl;
+    
+    const LatencyHistogram& latency = result.latency_ns;
+    out << "Latency (us): min " << toMicros(latency.getMin()) << ", mean " << latency.getMean() / 1000.0
+        << ", max " << toMicros(latency.getMax()) << std::endl;
+    out << "Latency distribution:" << std::endl;
+    for (double percentile : REPORT_PERCENTILES) {
+        out << std::setw(10) << std::setprecision(3) << percentile << "%  "
+            << std::setw(12) << std::setprecision(1) << toMicros(latency.getPercentile(percentile)) << " us"
+            << std::endl;
+    }
+    out << std::setw(10) << std::setprecision(3) << 100.0 << "%  "
+        << std::setw(12) << std::setprecision(1) << toMicros(latency.getMax()) << " us" << std::endl;
+}
+
+std::string LoadGenerator::toJson(const BenchConfig& config, const BenchResult& result) {
+    const LatencyHistogram& latency = result.latency_ns;
+    double throughput = result.elapsed_s > 0 ? static_cast<double>(result.requests) / result.elapsed_s : 0.0;
+    
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(3);
+    json << "{\"config\":{"
+         << "\"host\":\"" << config.host << "\",\"port\":\"" << config.port << "\""
+         << ",\"mode\":\"" << (config.rate > 0 ? "open" : "closed") << "\""
+         << ",\"rate\":" << config.rate
+         << ",\"connections\":" << config.connections
+         << ",\"threads\":" << config.threads
+         << ",\"duration_s\":" << config.duration_s
+         << ",\"warmup_s\":" << config.warmup_s
+         << ",\"payload_size\":" << config.payload_size
+         << ",\"post_percent\":" << config.post_percent
+         << ",\"encoding\":\"" << (config.encoding == Protocol::Encoding::BINARY ? "binary" : "text") << "\""
+         << ",\"seed\":" << config.seed << "}";
+    json << ",\"requests\":" << result.requests
+         << ",\"errors\":" << result.errors
+         << ",\"unfinished\":" << result.unfinished
+         << ",\"failed_connections\":" << result.failed_connections
+         << ",\"elapsed_s\":" << result.elapsed_s
+         << ",\"throughput_rps\":" << throughput;
+    json << ",\"latency_us\":{"
+         << "\"min\":" << toMicros(latency.getMin())
+         << ",\"mean\":" << latency.getMean() / 1000.0;
+    for (double percentile : REPORT_PERCENTILES) {
+        json << ",\"" << percentileKey(percentile) << "\":" << toMicros(latency.getPercentile(percentile));
+    }
+    json << ",\"max\":" << toMicros(latency.getMax()) << "}}";
+    return json.str();
+}
\ No newline at end of file
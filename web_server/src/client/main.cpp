@@ -1,36 +1,241 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <chrono>
+#include <fstream>
 #include <client/tcp_client.h>
+#include <client/load_generator.h>
 #include <common/protocol.h>
 #include <common/logger.h>
 
+namespace {
+    // Requests read from stdin before they are flushed as one pipeline
+    const size_t BATCH_FLUSH_REQUESTS = 8192;
+}
+
 void printUsage(const char* programName) {
-    std::cout << "Usage: " << programName << " <METHOD> <PATH> [PAYLOAD]" << std::endl;
+    std::cout << "Usage: " << programName << " [--binary] <METHOD> <PATH> [PAYLOAD]" << std::endl;
+    std::cout << "       " << programName << " [--binary] [--window N] --batch" << std::endl;
     std::cout << "Examples:" << std::endl;
     std::cout << "  " << programName << " GET /status" << std::endl;
     std::cout << "  " << programName << " POST /data \"Hello from client\"" << std::endl;
+    std::cout << "  " << programName << " --binary POST /data \"Hello from client\"" << std::endl;
+    std::cout << "  " << programName << " --batch < requests.txt" << std::endl;
     std::cout << std::endl;
     std::cout << "Methods: GET, POST" << std::endl;
     std::cout << "Paths: /status, /data" << std::endl;
+    std::cout << std::endl;
+    std::cout << "With --batch, requests are read from stdin, one \"METHOD PATH [PAYLOAD]\" per line," << std::endl;
+    std::cout << "and pipelined with at most N unanswered (default " << Protocol::DEFAULT_PIPELINE_WINDOW << ")." << std::endl;
+    std::cout << std::endl;
+    std::cout << "Load test: " << programName << " bench [options]   (see " << programName << " bench --help)" << std::endl;
+}
+
+void printBenchUsage(const char* programName) {
+    BenchConfig defaults;
+    std::cout << "Usage: " << programName << " bench [options]" << std::endl;
+    std::cout << "  --host HOST          Server host (default " << defaults.host << ")" << std::endl;
+    std::cout << "  --port PORT          Server port (default " << defaults.port << ")" << std::endl;
+    std::cout << "  --connections N      Concurrent connections (default " << defaults.connections << ")" << std::endl;
+    std::cout << "  --threads M          Client threads sharing the connections (default " << defaults.threads << ")" << std::endl;
+    std::cout << "  --duration SECONDS   Measured run time (default " << defaults.duration_s << ")" << std::endl;
+    std::cout << "  --warmup SECONDS     Unmeasured run time before it (default " << defaults.warmup_s << ")" << std::endl;
+    std::cout << "  --rate N             Open loop at N requests/s in total; 0 = closed loop, max throughput (default)" << std::endl;
+    std::cout << "  --payload BYTES      POST /data payload size (default " << defaults.payload_size << ")" << std::endl;
+    std::cout << "  --post-percent P     Share of POST /data; the rest is GET /status (default " << defaults.post_percent << ")" << std::endl;
+    std::cout << "  --binary             Use the binary protocol" << std::endl;
+    std::cout << "  --seed N             Seed for the request mix and payloads (default " << defaults.seed << ")" << std::endl;
+    std::cout << "  --json PATH          Also write a JSON summary to PATH, or to stdout with -" << std::endl;
+    std::cout << "Example:" << std::endl;
+    std::cout << "  " << programName << " bench --connections 64 --threads 4 --rate 50000 --duration 30 --json run.json" << std::endl;
+}
+
+// Run the load generator against a server and report throughput and latency
+int runBench(int argc, char* argv[], int arg_index) {
+    BenchConfig config;
+    std::string json_path;
+    
+    for (; arg_index < argc; ++arg_index) {
+        std::string option = argv[arg_index];
+        if (option == "--help" || option == "-h") {
+            printBenchUsage(argv[0]);
+            return 0;
+        }
+        if (option == "--binary") {
+            config.encoding = Protocol::Encoding::BINARY;
+            continue;
+        }
+        if (arg_index + 1 >= argc) {
+            std::cerr << "Error: Unknown or incomplete option '" << option << "'" << std::endl;
+            printBenchUsage(argv[0]);
+            return 1;
+        }
+        
+        std::string value = argv[++arg_index];
+        uint64_t number = 0;
+        bool numeric = Protocol::parseUnsigned(value, number);
+        if (option == "--host") {
+            config.host = value;
+        } else if (option == "--port") {
+            config.port = value;
+        } else if (option == "--json") {
+            json_path = value;
+        } else if (!numeric) {
+            std::cerr << "Error: " << option << " expects a number" << std::endl;
+            return 1;
+        } else if (option == "--connections" && number > 0) {
+            config.connections = static_cast<size_t>(number);
+        } else if (option == "--threads" && number > 0) {
+            config.threads = static_cast<size_t>(number);
+        } else if (option == "--duration" && number > 0) {
+            config.duration_s = number;
+        } else if (option == "--warmup") {
+            config.warmup_s = number;
+        } else if (option == "--rate") {
+            config.rate = number;
+        } else if (option == "--payload") {
+            config.payload_size = static_cast<size_t>(number);
+        } else if (option == "--post-percent" && number <= 100) {
+            config.post_percent = static_cast<unsigned>(number);
+        } else if (option == "--seed") {
+            config.seed = static_cast<uint32_t>(number);
+        } else {
+            std::cerr << "Error: Invalid option '" << option << " " << value << "'" << std::endl;
+            printBenchUsage(argv[0]);
+            return 1;
+        }
+    }
+    
+    LoadGenerator generator(config);
+    BenchResult result;
+    if (!generator.run(result)) {
+        std::cerr << "Failed to connect to server" << std::endl;
+        return 1;
+    }
+    
+    // The report goes to stderr when the JSON summary takes stdout
+    LoadGenerator::printReport(config, result, json_path == "-" ? std::cerr : std::cout);
+    
+    if (json_path == "-") {
+        std::cout << LoadGenerator::toJson(config, result) << std::endl;
+    } else if (!json_path.empty()) {
+        std::ofstream json(json_path);
+        json << LoadGenerator::toJson(config, result) << std::endl;
+        if (!json) {
+            std::cerr << "Failed to write " << json_path << std::endl;
+            return 1;
+        }
+    }
+    return result.failed_connections == 0 ? 0 : 1;
+}
+
+// Pipeline the requests on stdin and print each response on its own line
+int runBatch(TCPClient& client) {
+    auto started = std::chrono::steady_clock::now();
+    size_t sent = 0;
+    size_t line_number = 0;
+    bool ok = true;
+    auto print = [](size_t, const std::string& response) {
+        std::cout << response << '\n';
+    };
+    
+    std::string line;
+    while (ok && std::getline(std::cin, line)) {
+        line_number++;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        
+        Protocol::Method method;
+        std::string_view path, payload;
+        if (!Protocol::parseRequest(line, method, path, payload)) {
+            if (line.find_first_not_of(" \t") != std::string::npos) {
+                std::cerr << "Skipping invalid request on line " << line_number << std::endl;
+            }
+            continue;
+        }
+        
+        client.queueRequest(method, std::string(path), std::string(payload));
+        if (client.getQueuedRequests() >= BATCH_FLUSH_REQUESTS) {
+            sent += client.getQueuedRequests();
+            ok = client.flush(print);
+        }
+    }
+    
+    if (ok) {
+        sent += client.getQueuedRequests();
+        ok = client.flush(print);
+    }
+    std::cout.flush();
+    
+    if (!ok) {
+        std::cerr << "Batch failed: connection lost" << std::endl;
+        return 1;
+    }
+    
+    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started).count();
+    std::cerr << sent << " requests in " << elapsed_ms << " ms" << std::endl;
+    return 0;
 }
 
 int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "bench") {
+        return runBench(argc, argv, 2);
+    }
+    
     std::cout << "=== WebServer CLI Client ===" << std::endl;
     
+    // Optional flags come before the request itself
+    int arg_index = 1;
+    Protocol::Encoding encoding = Protocol::Encoding::TEXT;
+    bool batch = false;
+    size_t window = Protocol::DEFAULT_PIPELINE_WINDOW;
+    while (arg_index < argc && std::string(argv[arg_index]).rfind("--", 0) == 0) {
+        std::string flag = argv[arg_index];
+        if (flag == "--binary") {
+            encoding = Protocol::Encoding::BINARY;
+        } else if (flag == "--batch") {
+            batch = true;
+        } else if (flag == "--window" && arg_index + 1 < argc) {
+            uint64_t value = 0;
+            if (!Protocol::parseUnsigned(argv[++arg_index], value) || value == 0) {
+                std::cerr << "Error: --window must be a positive number" << std::endl;
+                return 1;
+            }
+            window = static_cast<size_t>(value);
+        } else {
+            std::cerr << "Error: Unknown option '" << flag << "'" << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+        arg_index++;
+    }
+    
+    if (batch) {
+        TCPClient client;
+        client.setEncoding(encoding);
+        client.setPipelineWindow(window);
+        if (!client.connect()) {
+            std::cerr << "Failed to connect to server" << std::endl;
+            return 1;
+        }
+        return runBatch(client);
+    }
+    
     // Check command line arguments
-    if (argc < 3) {
+    if (argc - arg_index < 2) {
         std::cerr << "Error: Insufficient arguments" << std::endl;
         printUsage(argv[0]);
         return 1;
     }
     
-    std::string methodStr = argv[1];
-    std::string path = argv[2];
+    std::string methodStr = argv[arg_index];
+    std::string path = argv[arg_index + 1];
     std::string payload = "";
     
-    if (argc >= 4) {
-        payload = argv[3];
+    if (argc - arg_index >= 3) {
+        payload = argv[arg_index + 2];
     }
     
     // Parse method
@@ -50,6 +255,7 @@ int main(int argc, char* argv[]) {
     
     // Create TCP client
     TCPClient client;
+    client.setEncoding(encoding);
     
     // Connect to server
     std::cout << "Connecting to server..." << std::endl;
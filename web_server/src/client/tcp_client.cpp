@@ -7,13 +7,17 @@
 #include <unistd.h>
 #include <netdb.h>
 #include <string.h>
+#include <errno.h>
+#include <poll.h>
 #include <iostream>
 #include <thread>
 #include <chrono>
 
 TCPClient::TCPClient(const std::string& host, const std::string& port, bool auto_reconnect) 
     : host_(host), port_(port), sockfd_(-1), connected_(false), 
-      auto_reconnect_(auto_reconnect), max_reconnect_attempts_(3) {
+      auto_reconnect_(auto_reconnect), max_reconnect_attempts_(3),
+      encoding_(Protocol::Encoding::TEXT), recv_buffer_(Protocol::DEFAULT_MAX_MESSAGE_SIZE),
+      pipeline_window_(Protocol::DEFAULT_PIPELINE_WINDOW) {
 }
 
 TCPClient::~TCPClient() {
@@ -52,21 +56,26 @@ bool TCPClient::connect() {
     freeaddrinfo(servinfo);
     
     if (p == NULL) {
+        sockfd_ = -1;
         Logger::logError("client: failed to connect");
         return false;
     }
     
     connected_ = true;
+    recv_buffer_.clear();
     Logger::logMessage("Connected to server " + host_ + ":" + port_);
     return true;
 }
 
 void TCPClient::disconnect() {
-    if (connected_ && sockfd_ != -1) {
+    // A failed send/recv clears connected_ but still leaves the socket open
+    if (sockfd_ != -1) {
         close(sockfd_);
-        connected_ = false;
         sockfd_ = -1;
-        Logger::logMessage("Disconnected from server");
+        if (connected_) {
+            Logger::logMessage("Disconnected from server");
+        }
+        connected_ = false;
     }
 }
 
@@ -103,42 +112,173 @@ std::string TCPClient::sendRequest(Protocol::Method method, const std::string& p
         }
     }
     
-    std::string request = Protocol::formatRequest(method, path, payload);
-    Logger::logMessage("Sending request: " + request);
+    std::string request = encodeRequest(method, path, payload);
+    Logger::debug("Sending request: ", [method] { return Protocol::methodToString(method); }, " ", path,
+                  payload.empty() ? "" : " ", payload);
     
-    // Send request
-    if (send(sockfd_, request.c_str(), request.length(), 0) == -1) {
-        Logger::logError("Failed to send request");
-        connected_ = false;
+    std::string response;
+    if (sendAll(request) && receiveResponse(response)) {
+        Logger::debug("Received response: ", response);
+        return response;
+    }
+    
+    // The server may have closed the persistent connection while it was idle
+    disconnect();
+    if (!auto_reconnect_ || !(connect() || tryReconnect())) {
+        return "";
+    }
+    
+    Logger::logMessage("Retrying request after reconnection...");
+    if (sendAll(request) && receiveResponse(response)) {
+        Logger::debug("Received response: ", response);
+        return response;
+    }
+    
+    Logger::logError("Request failed after reconnection");
+    disconnect();
+    return "";
+}
+
+void TCPClient::queueRequest(Protocol::Method method, const std::string& path, const std::string& payload) {
+    pipeline_.push_back(encodeRequest(method, path, payload));
+}
+
+bool TCPClient::flush(const ResponseHandler& handler) {
+    if (pipeline_.empty()) {
+        return true;
+    }
+    if (!connected_ && !(auto_reconnect_ && tryReconnect())) {
+        Logger::logError("Not connected to server");
+        pipeline_.clear();
+        return false;
+    }
+    
+    std::string outgoing;
+    size_t outgoing_sent = 0;
+    size_t next_send = 0;
+    size_t next_receive = 0;
+    std::string response;
+    bool ok = true;
+    
+    // Sending never blocks, so responses keep being drained while requests
+    // go out and neither side can stall on a full socket buffer
+    while (ok && next_receive < pipeline_.size()) {
+        if (outgoing_sent == outgoing.size()) {
+            outgoing.clear();
+            outgoing_sent = 0;
+            while (next_send < pipeline_.size() && next_send - next_receive < pipeline_window_) {
+                outgoing += pipeline_[next_send++];
+            }
+        }
         
-        // Try to reconnect and resend
-        if (auto_reconnect_ && tryReconnect()) {
-            Logger::logMessage("Retrying request after reconnection...");
-            if (send(sockfd_, request.c_str(), request.length(), 0) == -1) {
-                Logger::logError("Failed to send request after reconnection");
-                return "";
+        struct pollfd pfd;
+        pfd.fd = sockfd_;
+        pfd.events = outgoing_sent < outgoing.size() ? POLLIN | POLLOUT : POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, -1) == -1) {
+            if (errno != EINTR) {
+                Logger::logError("poll failed: " + std::string(strerror(errno)));
+                ok = false;
+            }
+            continue;
+        }
+        
+        if (pfd.revents & POLLOUT) {
+            ssize_t bytes_sent = send(sockfd_, outgoing.data() + outgoing_sent, outgoing.size() - outgoing_sent,
+                                      MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (bytes_sent > 0) {
+                outgoing_sent += bytes_sent;
+            } else if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+                Logger::logError("Failed to send request");
+                ok = false;
+            }
+        }
+        
+        if (ok && (pfd.revents & (POLLIN | POLLHUP | POLLERR))) {
+            ssize_t bytes_received = recv_buffer_.readFrom(sockfd_);
+            if (bytes_received == 0) {
+                Logger::logMessage("Server closed connection");
+                ok = false;
+            } else if (bytes_received == -1 && errno != EINTR) {
+                Logger::logError(errno == EMSGSIZE ? "Response exceeds the maximum message size"
+                                                   : "Failed to receive response");
+                ok = false;
+            }
+            
+            // Responses arrive in request order
+            while (next_receive < next_send && extractResponse(response)) {
+                handler(next_receive++, response);
             }
-        } else {
-            return "";
         }
     }
     
-    // Receive response
-    char buffer[Protocol::DEFAULT_BUFLEN];
-    memset(buffer, 0, Protocol::DEFAULT_BUFLEN);
-    
-    ssize_t bytes_received = recv(sockfd_, buffer, Protocol::DEFAULT_BUFLEN - 1, 0);
-    if (bytes_received == -1) {
-        Logger::logError("Failed to receive response");
-        connected_ = false;
-        return "";
-    } else if (bytes_received == 0) {
-        Logger::logMessage("Server closed connection");
-        connected_ = false;
-        return "";
+    if (!ok) {
+        Logger::logError("Pipeline failed after " + std::to_string(next_receive) + " of " +
+                         std::to_string(pipeline_.size()) + " responses");
+        disconnect();
     }
+    pipeline_.clear();
+    return ok;
+}
+
+bool TCPClient::flush(std::vector<std::string>& responses) {
+    return flush([&responses](size_t, const std::string& response) {
+        responses.push_back(response);
+    });
+}
+
+std::string TCPClient::encodeRequest(Protocol::Method method, const std::string& path,
+                                     const std::string& payload) const {
+    return encoding_ == Protocol::Encoding::BINARY ? Protocol::encodeBinaryRequest(method, path, payload)
+                                                   : Protocol::formatRequest(method, path, payload);
+}
+
+bool TCPClient::sendAll(const std::string& data) {
+    size_t total_sent = 0;
     
-    std::string response(buffer);
-    Logger::logMessage("Received response: " + response);
-    return response;
-} 
\ No newline at end of file
+    while (total_sent < data.length()) {
+        ssize_t bytes_sent = send(sockfd_, data.c_str() + total_sent, data.length() - total_sent, MSG_NOSIGNAL);
+        if (bytes_sent == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            Logger::logError("Failed to send request");
+            connected_ = false;
+            return false;
+        }
+        total_sent += bytes_sent;
+    }
+    return true;
+}
+
+bool TCPClient::receiveResponse(std::string& response) {
+    // Keep reading until a whole response frame is buffered
+    while (!extractResponse(response)) {
+        ssize_t bytes_received = recv_buffer_.readFrom(sockfd_);
+        if (bytes_received == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            Logger::logError(errno == EMSGSIZE ? "Response exceeds the maximum message size"
+                                               : "Failed to receive response");
+            connected_ = false;
+            return false;
+        } else if (bytes_received == 0) {
+            Logger::logMessage("Server closed connection");
+            connected_ = false;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TCPClient::extractResponse(std::string& response) {
+    std::string_view body;
+    size_t frame_length;
+    if (!Protocol::nextResponseFrame(recv_buffer_.data(), body, frame_length)) {
+        return false;
+    }
+    response.assign(body.data(), body.size());
+    recv_buffer_.consume(frame_length);
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include <common/checksum.h>
+
+namespace {
+    // Slicing-by-8 tables: eight bytes are folded in per step
+    struct Crc32Tables {
+        uint32_t table[8][256];
+        
+        Crc32Tables() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; ++bit) {
+                    crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+                }
+                table[0][i] = crc;
+            }
+            for (uint32_t i = 0; i < 256; ++i) {
+                for (int slice = 1; slice < 8; ++slice) {
+                    table[slice][i] = (table[slice - 1][i] >> 8) ^ table[0][table[slice - 1][i] & 0xFF];
+                }
+            }
+        }
+    };
+    
+    const Crc32Tables& tables() {
+        static const Crc32Tables instance;
+        return instance;
+    }
+}
+
+uint32_t crc32(const void* data, size_t length, uint32_t crc) {
+    const uint32_t (*table)[256] = tables().table;
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+    
+    while (length >= 8) {
+        uint32_t low = crc ^ (static_cast<uint32_t>(bytes[0]) | static_cast<uint32_t>(bytes[1]) << 8 |
+                              static_cast<uint32_t>(bytes[2]) << 16 | static_cast<uint32_t>(bytes[3]) << 24);
+        crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^
+              table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+              table[3][bytes[4]] ^ table[2][bytes[5]] ^ table[1][bytes[6]] ^ table[0][bytes[7]];
+        bytes += 8;
+        length -= 8;
+    }
+    while (length-- > 0) {
+        crc = (crc >> 8) ^ table[0][(crc ^ *bytes++) & 0xFF];
+    }
+    return ~crc;
+}
\ No newline at end of file
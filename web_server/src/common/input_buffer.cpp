@@ -0,0 +1,124 @@
+#include <common/input_buffer.h>
+#include <sys/socket.h>
+#include <errno.h>
+#include <string.h>
+
+namespace {
+    const size_t INITIAL_CAPACITY = 4096;
+    const size_t MIN_READ_SIZE = 4096;
+    
+    // Buffers that grew for a large message are released once drained
+    const size_t RETAINED_CAPACITY = 64 * 1024;
+}
+
+InputBuffer::InputBuffer(size_t max_message_size)
+    : capacity_(0), read_pos_(0), write_pos_(0), max_message_size_(max_message_size) {
+}
+
+ssize_t InputBuffer::readFrom(int fd) {
+    size_t available = reserve(MIN_READ_SIZE);
+    if (available == 0) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    
+    ssize_t bytes_received = recv(fd, buffer_.get() + write_pos_, available, 0);
+    if (bytes_received > 0) {
+        write_pos_ += bytes_received;
+    }
+    return bytes_received;
+}
+
+size_t InputBuffer::append(const char* data, size_t length) {
+    size_t taken = 0;
+    while (taken < length) {
+        size_t available = reserve(length - taken);
+        if (available == 0) {
+            break;
+        }
+        size_t chunk = length - taken < available ? length - taken : available;
+        memcpy(buffer_.get() + write_pos_, data + taken, chunk);
+        write_pos_ += chunk;
+        taken += chunk;
+    }
+    return taken;
+}
+
+std::string_view InputBuffer::data() const {
+    if (read_pos_ == write_pos_) {
+        return std::string_view();
+    }
+    return std::string_view(buffer_.get() + read_pos_, write_pos_ - read_pos_);
+}
+
+void InputBuffer::consume(size_t length) {
+    read_pos_ += length < size() ? length : size();
+    
+    if (read_pos_ == write_pos_) {
+        read_pos_ = 0;
+        write_pos_ = 0;
+        if (capacity_ > RETAINED_CAPACITY) {
+            buffer_.reset();
+            capacity_ = 0;
+        }
+    }
+}
+
+void InputBuffer::clear() {
+    consume(size());
+}
+
+size_t InputBuffer::size() const {
+    return write_pos_ - read_pos_;
+}
+
+bool InputBuffer::empty() const {
+    return read_pos_ == write_pos_;
+}
+
+size_t InputBuffer::capacity() const {
+    return capacity_;
+}
+
+size_t InputBuffer::getMaxMessageSize() const {
+    return max_message_size_;
+}
+
+size_t InputBuffer::reserve(size_t min_free) {
+    // One read of slack past the limit lets the parser see that a frame is oversized
+    size_t limit = max_message_size_ + MIN_READ_SIZE;
+    size_t unread = size();
+    if (unread >= limit) {
+        return 0;
+    }
+    
+    if (capacity_ - write_pos_ >= min_free) {
+        return capacity_ - write_pos_;
+    }
+    
+    // Reclaim consumed space first; only grow when that is not enough
+    if (read_pos_ > 0 && capacity_ - unread >= min_free) {
+        memmove(buffer_.get(), buffer_.get() + read_pos_, unread);
+        read_pos_ = 0;
+        write_pos_ = unread;
+        return capacity_ - write_pos_;
+    }
+    
+    size_t new_capacity = capacity_ > 0 ? capacity_ * 2 : INITIAL_CAPACITY;
+    while (new_capacity - unread < min_free) {
+        new_capacity *= 2;
+    }
+    if (new_capacity > limit) {
+        new_capacity = limit > unread + min_free ? limit : unread + min_free;
+    }
+    
+    std::unique_ptr<char[]> grown(new char[new_capacity]);
+    if (unread > 0) {
+        memcpy(grown.get(), buffer_.get() + read_pos_, unread);
+    }
+    buffer_ = std::move(grown);
+    capacity_ = new_capacity;
+    read_pos_ = 0;
+    write_pos_ = unread;
+    return capacity_ - write_pos_;
+}
\ No newline at end of file
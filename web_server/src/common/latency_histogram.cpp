@@ -0,0 +1,99 @@
+#include <common/latency_histogram.h>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Values below 2^LINEAR_BITS are exact; above, each power of two is
+    // split into 2^(LINEAR_BITS - 1) buckets
+    const unsigned LINEAR_BITS = 7;
+    const uint64_t LINEAR_LIMIT = uint64_t(1) << LINEAR_BITS;
+    const uint64_t SUB_BUCKETS = LINEAR_LIMIT / 2;
+    const size_t BUCKET_COUNT = LINEAR_LIMIT + (64 - LINEAR_BITS) * SUB_BUCKETS;
+}
+
+LatencyHistogram::LatencyHistogram()
+    : counts_(BUCKET_COUNT, 0), count_(0), min_(UINT64_MAX), max_(0), sum_(0) {
+}
+
+void LatencyHistogram::record(uint64_t value) {
+    counts_[bucketIndex(value)]++;
+    count_++;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+    sum_ += static_cast<double>(value);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    sum_ += other.sum_;
+}
+
+void LatencyHistogram::reset() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    count_ = 0;
+    min_ = UINT64_MAX;
+    max_ = 0;
+    sum_ = 0;
+}
+
+uint64_t LatencyHistogram::getCount() const {
+    return count_;
+}
+
+uint64_t LatencyHistogram::getMin() const {
+    return count_ == 0 ? 0 : min_;
+}
+
+uint64_t LatencyHistogram::getMax() const {
+    return max_;
+}
+
+double LatencyHistogram::getMean() const {
+    return count_ == 0 ? 0.0 : sum_ / static_cast<double>(count_);
+}
+
+uint64_t LatencyHistogram::getPercentile(double percentile) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    
+    percentile = std::min(std::max(percentile, 0.0), 100.0);
+    uint64_t rank = static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(count_)));
+    rank = std::max<uint64_t>(rank, 1);
+    
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += counts_[i];
+        if (seen >= rank) {
+            // The bucket bound can overshoot the largest value recorded
+            return std::min(bucketUpperBound(i), max_);
+        }
+    }
+    return max_;
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t value) {
+    if (value < LINEAR_LIMIT) {
+        return static_cast<size_t>(value);
+    }
+    
+    // Keep the top LINEAR_BITS - 1 bits below the leading one
+    unsigned magnitude = 63 - __builtin_clzll(value);
+    unsigned shift = magnitude - (LINEAR_BITS - 1);
+    return static_cast<size_t>(LINEAR_LIMIT + (shift - 1) * SUB_BUCKETS + ((value >> shift) - SUB_BUCKETS));
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index) {
+    if (index < LINEAR_LIMIT) {
+        return index;
+    }
+    
+    uint64_t shift = (index - LINEAR_LIMIT) / SUB_BUCKETS + 1;
+    uint64_t sub_bucket = (index - LINEAR_LIMIT) % SUB_BUCKETS + SUB_BUCKETS;
+    return ((sub_bucket + 1) << shift) - 1;
+}
\ No newline at end of file
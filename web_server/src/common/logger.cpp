@@ -1,31 +1,345 @@
 #include <common/logger.h>
+#include <common/mpsc_queue.h>
 #include <fstream>
 #include <iostream>
-#include <sstream>
 #include <chrono>
 #include <ctime>
-#include <iomanip>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <map>
+#include <cstdlib>
+#include <algorithm>
 
-std::mutex Logger::log_mutex_;
+namespace {
+    const size_t QUEUE_CAPACITY = 16384;
+    const size_t FLUSH_BYTES = 64 * 1024;
+    const auto FLUSH_INTERVAL = std::chrono::milliseconds(50);
+    
+    // How long a producer backs off on a full queue before dropping its record
+    const auto FULL_QUEUE_BACKOFF = std::chrono::milliseconds(1);
+    
+    struct LogRecord {
+        std::chrono::system_clock::time_point time;
+        std::string file;
+        std::string message;
+    };
+    
+    // Formats "YYYY-MM-DD HH:MM:SS", recomputing only when the second changes
+    class TimestampCache {
+    public:
+        const std::string& format(std::chrono::system_clock::time_point time) {
+            std::time_t seconds = std::chrono::system_clock::to_time_t(time);
+            if (seconds != cached_seconds_ || formatted_.empty()) {
+                std::tm local_time;
+                localtime_r(&seconds, &local_time);
+                char buffer[32];
+                size_t length = std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %X", &local_time);
+                formatted_.assign(buffer, length);
+                cached_seconds_ = seconds;
+            }
+            return formatted_;
+        }
+        
+    private:
+        std::time_t cached_seconds_ = 0;
+        std::string formatted_;
+    };
+    
+    class LogWriter {
+    public:
+        LogWriter() : queue_(QUEUE_CAPACITY), stopping_(false), flush_requested_(false),
+                      running_(false), enqueued_(0), written_(0), dropped_(0) {}
+        
+        void start() {
+            running_ = true;
+            thread_ = std::thread(&LogWriter::run, this);
+        }
+        
+        void submit(std::string&& message, const std::string& file) {
+            LogRecord record{std::chrono::system_clock::now(), file, std::move(message)};
+            
+            if (!running_.load(std::memory_order_acquire)) {
+                writeSynchronously(record);
+                return;
+            }
+            
+            if (queue_.tryPush(std::move(record))) {
+                enqueued_.fetch_add(1, std::memory_order_relaxed);
+                // Only wake the writer early when the queue is filling up
+                if (queue_.size() > queue_.capacity() / 2) {
+                    wakeup_.notify_one();
+                }
+                return;
+            }
+            
+            // Full: give the writer a moment to catch up, then drop the record
+            auto deadline = std::chrono::steady_clock::now() + FULL_QUEUE_BACKOFF;
+            do {
+                wakeup_.notify_one();
+                std::this_thread::yield();
+                if (queue_.tryPush(std::move(record))) {
+                    enqueued_.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            } while (std::chrono::steady_clock::now() < deadline);
+            
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+        
+        void flush() {
+            size_t target = enqueued_.load(std::memory_order_relaxed);
+            
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!stopping_ && written_.load(std::memory_order_relaxed) < target) {
+                flush_requested_ = true;
+                wakeup_.notify_one();
+                flushed_.wait_for(lock, std::chrono::milliseconds(10));
+            }
+        }
+        
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (stopping_) {
+                    return;
+                }
+                stopping_ = true;
+                // Records logged from here on are written synchronously
+                running_.store(false, std::memory_order_release);
+            }
+            wakeup_.notify_one();
+            thread_.join();
+            
+            // Pick up records pushed by callers that raced with the flag change
+            LogRecord record;
+            while (queue_.tryPop(record)) {
+                writeSynchronously(record);
+            }
+        }
+        
+        size_t queueDepth() const {
+            return queue_.size();
+        }
+        
+        size_t dropped() const {
+            return dropped_.load(std::memory_order_relaxed);
+        }
+        
+    private:
+        MPSCQueue<LogRecord> queue_;
+        std::thread thread_;
+        std::mutex mutex_;
+        std::condition_variable wakeup_;
+        std::condition_variable flushed_;
+        bool stopping_;
+        bool flush_requested_;
+        std::atomic<bool> running_;
+        std::atomic<size_t> enqueued_;
+        std::atomic<size_t> written_;
+        std::atomic<size_t> dropped_;
+        
+        // Writer thread state
+        TimestampCache timestamps_;
+        std::map<std::string, std::ofstream> files_;
+        std::map<std::string, std::string> pending_;
+        size_t pending_bytes_ = 0;
+        size_t reported_drops_ = 0;
+        std::mutex sync_mutex_;
+        
+        void run() {
+            auto last_flush = std::chrono::steady_clock::now();
+            size_t unwritten = 0;
+            
+            while (true) {
+                bool stopping;
+                bool flush_requested;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    if (!stopping_ && !flush_requested_ && queue_.size() == 0) {
+                        wakeup_.wait_for(lock, FLUSH_INTERVAL);
+                    }
+                    stopping = stopping_;
+                    flush_requested = flush_requested_;
+                    flush_requested_ = false;
+                }
+                
+                unwritten += drainQueue();
+                
+                // Batch writes: flush on size, on the interval, or on request
+                auto now = std::chrono::steady_clock::now();
+                if (pending_bytes_ >= FLUSH_BYTES || now - last_flush >= FLUSH_INTERVAL ||
+                    stopping || flush_requested) {
+                    writePending();
+                    last_flush = now;
+                    written_.fetch_add(unwritten, std::memory_order_relaxed);
+                    unwritten = 0;
+                    
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    flushed_.notify_all();
+                }
+                
+                if (stopping && queue_.size() == 0) {
+                    break;
+                }
+            }
+            
+            files_.clear();
+        }
+        
+        size_t drainQueue() {
+            LogRecord record;
+            size_t count = 0;
+            
+            while (pending_bytes_ < FLUSH_BYTES && queue_.tryPop(record)) {
+                appendRecord(record);
+                count++;
+            }
+            
+            size_t drops = dropped_.load(std::memory_order_relaxed);
+            if (drops != reported_drops_) {
+                LogRecord notice{std::chrono::system_clock::now(), "log.txt",
+                                 "Logger queue full, dropped " + std::to_string(drops - reported_drops_) + " records"};
+                appendRecord(notice);
+                reported_drops_ = drops;
+            }
+            return count;
+        }
+        
+        void appendRecord(const LogRecord& record) {
+            std::string& buffer = pending_[record.file];
+            size_t before = buffer.size();
+            buffer += '[';
+            buffer += timestamps_.format(record.time);
+            buffer += "] ";
+            buffer += record.message;
+            buffer += '\n';
+            pending_bytes_ += buffer.size() - before;
+        }
+        
+        void writePending() {
+            for (auto& entry : pending_) {
+                if (entry.second.empty()) {
+                    continue;
+                }
+                
+                auto it = files_.find(entry.first);
+                if (it == files_.end()) {
+                    it = files_.emplace(entry.first, std::ofstream(entry.first, std::ios::app)).first;
+                }
+                if (it->second.is_open()) {
+                    it->second.write(entry.second.data(), entry.second.size());
+                    it->second.flush();
+                }
+                entry.second.clear();
+            }
+            pending_bytes_ = 0;
+        }
+        
+        // Used before start() and after stop(), e.g. from static destructors
+        void writeSynchronously(const LogRecord& record) {
+            std::lock_guard<std::mutex> guard(sync_mutex_);
+            std::ofstream file(record.file, std::ios::app);
+            if (file.is_open()) {
+                TimestampCache timestamp;
+                file << "[" << timestamp.format(record.time) << "] " << record.message << '\n';
+            }
+        }
+    };
+    
+    // Intentionally leaked so it outlives every static object that logs
+    LogWriter& writer() {
+        static LogWriter* instance = [] {
+            LogWriter* created = new LogWriter();
+            created->start();
+            std::atexit(Logger::shutdown);
+            return created;
+        }();
+        return *instance;
+    }
+}
 
 void Logger::logMessage(const std::string& msg, const std::string& logFile) {
-    std::lock_guard<std::mutex> guard(log_mutex_);
-    
-    std::ofstream file(logFile, std::ios::app);
-    if (file.is_open()) {
-        file << "[" << getCurrentTimestamp() << "] " << msg << std::endl;
+    if (isEnabled(LogLevel::INFO)) {
+        writer().submit(std::string(msg), logFile);
     }
 }
 
 void Logger::logError(const std::string& msg, const std::string& logFile) {
     std::cerr << "ERROR: " << msg << std::endl;
-    logMessage("ERROR: " + msg, logFile);
+    writer().submit("ERROR: " + msg, logFile);
+}
+
+void Logger::write(LogLevel level, std::string&& message) {
+    if (level == LogLevel::INFO) {
+        writer().submit(std::move(message), "log.txt");
+        return;
+    }
+    
+    if (level == LogLevel::ERROR) {
+        std::cerr << "ERROR: " << message << std::endl;
+    }
+    writer().submit(std::string(levelToString(level)) + ": " + message, "log.txt");
+}
+
+void Logger::setLevel(LogLevel level) {
+    runtime_level_.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+LogLevel Logger::getLevel() {
+    return static_cast<LogLevel>(runtime_level_.load(std::memory_order_relaxed));
+}
+
+bool Logger::parseLevel(const std::string& name, LogLevel& level) {
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    
+    if (lower == "trace") {
+        level = LogLevel::TRACE;
+    } else if (lower == "debug") {
+        level = LogLevel::DEBUG;
+    } else if (lower == "info") {
+        level = LogLevel::INFO;
+    } else if (lower == "warn" || lower == "warning") {
+        level = LogLevel::WARN;
+    } else if (lower == "error") {
+        level = LogLevel::ERROR;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* Logger::levelToString(LogLevel level) {
+    switch (level) {
+        case LogLevel::TRACE:
+            return "TRACE";
+        case LogLevel::DEBUG:
+            return "DEBUG";
+        case LogLevel::INFO:
+            return "INFO";
+        case LogLevel::WARN:
+            return "WARN";
+        case LogLevel::ERROR:
+            return "ERROR";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+void Logger::flush() {
+    writer().flush();
+}
+
+void Logger::shutdown() {
+    writer().stop();
+}
+
+size_t Logger::getQueueDepth() {
+    return writer().queueDepth();
 }
 
-std::string Logger::getCurrentTimestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto in_time_t = std::chrono::system_clock::to_time_t(now);
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&in_time_t), "%Y-%m-%d %X");
-    return ss.str();
-} 
\ No newline at end of file
+size_t Logger::getDroppedRecords() {
+    return writer().dropped();
+}
\ No newline at end of file
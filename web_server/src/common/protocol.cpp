@@ -1,19 +1,81 @@
 #include <common/protocol.h>
-#include <algorithm>
+#include <common/string_search.h>
+#include <array>
 #include <sstream>
+#include <charconv>
 
 namespace Protocol {
-    
-    Method parseMethod(const std::string& methodStr) {
-        std::string upperMethod = methodStr;
-        std::transform(upperMethod.begin(), upperMethod.end(), upperMethod.begin(), ::toupper);
+
+    namespace {
+        // Case-insensitive compare against a lower-case ASCII word. Setting
+        // bit 0x20 lower-cases letters and maps no other byte onto a letter.
+        bool equalsLower(std::string_view text, const char* lower) {
+            for (size_t i = 0; i < text.size(); ++i) {
+                if ((text[i] | 0x20) != lower[i]) {
+                    return false;
+                }
+            }
+            return true;
+        }
         
-        if (upperMethod == "GET") {
-            return Method::GET;
-        } else if (upperMethod == "POST") {
-            return Method::POST;
-        } else {
-            return Method::UNKNOWN;
+        // Perfect hash over the standard paths: four times the length plus
+        // the last byte picks a slot, and the table is checked for collisions at compile time
+        struct PathSlot {
+            std::string_view path;
+            PathId id;
+        };
+        
+        constexpr PathSlot STANDARD_PATHS[] = {
+            {PATH_STATUS, PathId::STATUS},
+            {PATH_DATA, PathId::DATA},
+            {PATH_SHUTDOWN, PathId::SHUTDOWN},
+            {PATH_STATS, PathId::STATS},
+            {PATH_DATA_SEARCH, PathId::DATA_SEARCH},
+            {PATH_METRICS, PathId::METRICS},
+            {PATH_DATA_BATCH, PathId::DATA_BATCH},
+            {PATH_DATA_SUBSCRIBE, PathId::DATA_SUBSCRIBE},
+        };
+        
+        constexpr size_t PATH_TABLE_SIZE = 16;
+        
+        constexpr size_t pathSlot(std::string_view path) {
+            return (path.size() * 4 + static_cast<unsigned char>(path.back())) % PATH_TABLE_SIZE;
+        }
+        
+        constexpr std::array<PathSlot, PATH_TABLE_SIZE> buildPathTable() {
+            std::array<PathSlot, PATH_TABLE_SIZE> table{};
+            for (const PathSlot& slot : STANDARD_PATHS) {
+                table[pathSlot(slot.path)] = slot;
+            }
+            return table;
+        }
+        
+        constexpr std::array<PathSlot, PATH_TABLE_SIZE> PATH_TABLE = buildPathTable();
+        
+        constexpr bool pathTableComplete() {
+            for (const PathSlot& slot : STANDARD_PATHS) {
+                if (PATH_TABLE[pathSlot(slot.path)].id != slot.id) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        
+        static_assert(pathTableComplete(), "standard paths collide in PATH_TABLE; adjust pathSlot()");
+        
+        bool isSpace(char c) {
+            return c == ' ' || c == '\t';
+        }
+    }
+    
+    Method parseMethod(std::string_view method) {
+        switch (method.size()) {
+            case 3:
+                return equalsLower(method, "get") ? Method::GET : Method::UNKNOWN;
+            case 4:
+                return equalsLower(method, "post") ? Method::POST : Method::UNKNOWN;
+            default:
+                return Method::UNKNOWN;
         }
     }
     
@@ -36,7 +98,311 @@ namespace Protocol {
             request << " " << payload;
         }
         
+        request << FRAME_DELIMITER;
         return request.str();
     }
     
+    std::string formatResponse(const std::string& response) {
+        return response + FRAME_DELIMITER;
+    }
+    
+    bool parseRequest(std::string_view request, Method& method, std::string_view& path, std::string_view& payload) {
+        size_t pos = 0;
+        
+        // Tokens end at the first space or tab, found 16 or 32 bytes at a time
+        while (pos < request.size() && isSpace(request[pos])) {
+            pos++;
+        }
+        size_t method_end = findEitherByte(request, ' ', '\t', pos);
+        std::string_view method_str = request.substr(pos, method_end - pos);
+        
+        pos = method_end;
+        while (pos < request.size() && isSpace(request[pos])) {
+            pos++;
+        }
+        size_t path_end = findEitherByte(request, ' ', '\t', pos);
+        path = request.substr(pos, path_end - pos);
+        
+        if (method_str.empty() || path.empty()) {
+            return false;
+        }
+        
+        method = parseMethod(method_str);
+        if (method == Method::UNKNOWN) {
+            return false;
+        }
+        
+        // The rest of the line is the payload, minus the separating space
+        payload = request.substr(path_end);
+        if (!payload.empty() && payload[0] == ' ') {
+            payload.remove_prefix(1);
+        }
+        
+        return true;
+    }
+    
+    Encoding detectEncoding(uint8_t first_byte) {
+        return first_byte == BINARY_MAGIC ? Encoding::BINARY : Encoding::TEXT;
+    }
+    
+    PathId pathToId(std::string_view path) {
+        if (path.empty()) {
+            return PathId::UNKNOWN;
+        }
+        const PathSlot& slot = PATH_TABLE[pathSlot(path)];
+        return slot.path == path ? slot.id : PathId::UNKNOWN;
+    }
+    
+    std::string_view idToPath(PathId id) {
+        switch (id) {
+            case PathId::STATUS:
+                return PATH_STATUS;
+            case PathId::DATA:
+                return PATH_DATA;
+            case PathId::SHUTDOWN:
+                return PATH_SHUTDOWN;
+            case PathId::STATS:
+                return PATH_STATS;
+            case PathId::DATA_SEARCH:
+                return PATH_DATA_SEARCH;
+            case PathId::METRICS:
+                return PATH_METRICS;
+            case PathId::DATA_BATCH:
+                return PATH_DATA_BATCH;
+            case PathId::DATA_SUBSCRIBE:
+                return PATH_DATA_SUBSCRIBE;
+            default:
+                return std::string_view();
+        }
+    }
+    
+    uint16_t responseStatus(std::string_view response) {
+        uint16_t status = 0;
+        for (size_t i = 0; i < response.size() && i < 3; ++i) {
+            if (response[i] < '0' || response[i] > '9') {
+                return 0;
+            }
+            status = status * 10 + (response[i] - '0');
+        }
+        return status;
+    }
+    
+    void writeBinaryHeader(char* out, Opcode opcode, uint16_t id, uint32_t payload_length) {
+        out[0] = static_cast<char>(BINARY_MAGIC);
+        out[1] = static_cast<char>(BINARY_VERSION);
+        out[2] = static_cast<char>(opcode);
+        out[3] = 0;
+        out[4] = static_cast<char>(id >> 8);
+        out[5] = static_cast<char>(id & 0xFF);
+        out[6] = 0;
+        out[7] = 0;
+        out[8] = static_cast<char>(payload_length >> 24);
+        out[9] = static_cast<char>((payload_length >> 16) & 0xFF);
+        out[10] = static_cast<char>((payload_length >> 8) & 0xFF);
+        out[11] = static_cast<char>(payload_length & 0xFF);
+    }
+    
+    namespace {
+        std::string encodeBinaryFrame(Opcode opcode, uint16_t id, std::string_view payload) {
+            std::string frame(BINARY_HEADER_SIZE, '\0');
+            writeBinaryHeader(&frame[0], opcode, id, static_cast<uint32_t>(payload.size()));
+            frame.append(payload.data(), payload.size());
+            return frame;
+        }
+    }
+    
+    std::string encodeBinaryRequest(Method method, const std::string& path, const std::string& payload) {
+        std::string_view base, query;
+        splitQuery(path, base, query);
+        
+        // Paths travel as ids; a GET's query string becomes its payload
+        if (method == Method::POST) {
+            return encodeBinaryFrame(Opcode::POST, static_cast<uint16_t>(pathToId(base)), payload);
+        }
+        return encodeBinaryFrame(Opcode::GET, static_cast<uint16_t>(pathToId(base)), query);
+    }
+    
+    std::string encodeBinaryResponse(const std::string& response) {
+        return encodeBinaryFrame(Opcode::RESPONSE, responseStatus(response), response);
+    }
+    
+    PreparedResponse::PreparedResponse(const std::string& response)
+        : text_(formatResponse(response)), binary_(encodeBinaryResponse(response)),
+          status_(responseStatus(response)) {
+    }
+    
+    std::string_view PreparedResponse::encoded(Encoding encoding) const {
+        return encoding == Encoding::BINARY ? binary_ : text_;
+    }
+    
+    uint16_t PreparedResponse::getStatus() const {
+        return status_;
+    }
+    
+    const PreparedResponse PREPARED_STATUS_OK(RESPONSE_STATUS_OK);
+    const PreparedResponse PREPARED_DATA_CREATED(RESPONSE_DATA_CREATED);
+    const PreparedResponse PREPARED_BAD_REQUEST(RESPONSE_BAD_REQUEST);
+    const PreparedResponse PREPARED_NOT_FOUND(RESPONSE_NOT_FOUND);
+    const PreparedResponse PREPARED_PAYLOAD_TOO_LARGE(RESPONSE_PAYLOAD_TOO_LARGE);
+    const PreparedResponse PREPARED_TOO_MANY_REQUESTS(RESPONSE_TOO_MANY_REQUESTS);
+    const PreparedResponse PREPARED_SERVER_BUSY(RESPONSE_SERVER_BUSY);
+    const PreparedResponse PREPARED_SHUTTING_DOWN(RESPONSE_SHUTTING_DOWN);
+    
+    bool decodeBinaryHeader(std::string_view data, BinaryHeader& header) {
+        if (data.size() < BINARY_HEADER_SIZE || static_cast<uint8_t>(data[0]) != BINARY_MAGIC) {
+            return false;
+        }
+        
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data.data());
+        header.version = bytes[1];
+        header.opcode = static_cast<Opcode>(bytes[2]);
+        header.flags = bytes[3];
+        header.path_id = static_cast<uint16_t>((bytes[4] << 8) | bytes[5]);
+        header.payload_length = (static_cast<uint32_t>(bytes[8]) << 24) |
+                                (static_cast<uint32_t>(bytes[9]) << 16) |
+                                (static_cast<uint32_t>(bytes[10]) << 8) |
+                                static_cast<uint32_t>(bytes[11]);
+        return true;
+    }
+    
+    bool nextResponseFrame(std::string_view data, std::string_view& body, size_t& frame_length) {
+        if (data.empty()) {
+            return false;
+        }
+        
+        if (detectEncoding(static_cast<uint8_t>(data[0])) == Encoding::BINARY) {
+            BinaryHeader header;
+            if (!decodeBinaryHeader(data, header) || data.size() - BINARY_HEADER_SIZE < header.payload_length) {
+                return false;
+            }
+            body = data.substr(BINARY_HEADER_SIZE, header.payload_length);
+            frame_length = BINARY_HEADER_SIZE + header.payload_length;
+            return true;
+        }
+        
+        size_t delimiter = data.find(FRAME_DELIMITER);
+        if (delimiter == std::string_view::npos) {
+            return false;
+        }
+        body = data.substr(0, delimiter);
+        frame_length = delimiter + 1;
+        return true;
+    }
+    
+    void splitQuery(std::string_view target, std::string_view& path, std::string_view& query) {
+        size_t mark = target.find('?');
+        if (mark == std::string_view::npos) {
+            path = target;
+            query = std::string_view();
+        } else {
+            path = target.substr(0, mark);
+            query = target.substr(mark + 1);
+        }
+    }
+    
+    bool queryParameter(std::string_view query, std::string_view name, std::string_view& value) {
+        while (!query.empty()) {
+            size_t end = query.find('&');
+            std::string_view pair = query.substr(0, end);
+            query = end == std::string_view::npos ? std::string_view() : query.substr(end + 1);
+            
+            size_t equals = pair.find('=');
+            if (pair.substr(0, equals) == name) {
+                value = equals == std::string_view::npos ? std::string_view() : pair.substr(equals + 1);
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    bool parseUnsigned(std::string_view text, uint64_t& value) {
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        return result.ec == std::errc() && result.ptr == text.data() + text.size() && !text.empty();
+    }
+    
+    bool parseBatch(std::string_view payload, std::vector<std::string_view>& records) {
+        records.clear();
+        
+        size_t pos = payload.find(' ');
+        uint64_t count = 0;
+        if (!parseUnsigned(payload.substr(0, pos), count) || count == 0 || count > MAX_BATCH_RECORDS) {
+            return false;
+        }
+        // Every record takes at least " 0:", so a larger count cannot fit
+        if (pos == std::string_view::npos || count > (payload.size() - pos) / 3) {
+            return false;
+        }
+        records.reserve(count);
+        
+        while (records.size() < count) {
+            if (pos >= payload.size() || payload[pos] != ' ') {
+                return false;
+            }
+            size_t colon = payload.find(':', pos + 1);
+            uint64_t length = 0;
+            if (colon == std::string_view::npos || !parseUnsigned(payload.substr(pos + 1, colon - pos - 1), length) ||
+                length > payload.size() - colon - 1) {
+                return false;
+            }
+            records.push_back(payload.substr(colon + 1, length));
+            pos = colon + 1 + length;
+        }
+        return pos == payload.size();
+    }
+    
+    bool decodeQueryValue(std::string_view text, std::string& value) {
+        value.clear();
+        value.reserve(text.size());
+        
+        for (size_t i = 0; i < text.size(); ++i) {
+            if (text[i] != '%') {
+                value += text[i];
+                continue;
+            }
+            
+            uint8_t byte = 0;
+            if (i + 2 >= text.size() ||
+                std::from_chars(text.data() + i + 1, text.data() + i + 3, byte, 16).ptr != text.data() + i + 3) {
+                return false;
+            }
+            value += static_cast<char>(byte);
+            i += 2;
+        }
+        return true;
+    }
+    
+    void appendEscaped(std::string& out, std::string_view data) {
+        size_t start = out.size();
+        out.resize(start + escapedLength(data));
+        writeEscaped(&out[start], data);
+    }
+    
+    char* writeEscaped(char* out, std::string_view data) {
+        for (char c : data) {
+            if (c == '\\') {
+                *out++ = '\\';
+                *out++ = '\\';
+            } else if (c == '\n') {
+                *out++ = '\\';
+                *out++ = 'n';
+            } else if (c == '\r') {
+                *out++ = '\\';
+                *out++ = 'r';
+            } else {
+                *out++ = c;
+            }
+        }
+        return out;
+    }
+    
+    size_t escapedLength(std::string_view data) {
+        size_t length = data.size();
+        for (char c : data) {
+            if (c == '\\' || c == '\n' || c == '\r') {
+                length++;
+            }
+        }
+        return length;
+    }
+
 } 
\ No newline at end of file
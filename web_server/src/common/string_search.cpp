@@ -0,0 +1,102 @@
+#include <common/string_search.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+#if defined(__AVX2__)
+    const size_t BLOCK = 32;
+    
+    // Bit i is set where haystack[i] and haystack[i + k - 1] match the
+    // first and last needle bytes
+    inline unsigned candidates(const char* block, size_t k, char first, char last) {
+        __m256i first_bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+        __m256i last_bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + k - 1));
+        __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(first_bytes, _mm256_set1_epi8(first)),
+                                      _mm256_cmpeq_epi8(last_bytes, _mm256_set1_epi8(last)));
+        return static_cast<unsigned>(_mm256_movemask_epi8(eq));
+    }
+    
+    inline unsigned matchesEither(const char* block, char a, char b) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+        __m256i eq = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(a)),
+                                     _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(b)));
+        return static_cast<unsigned>(_mm256_movemask_epi8(eq));
+    }
+#elif defined(__SSE2__)
+    const size_t BLOCK = 16;
+    
+    inline unsigned candidates(const char* block, size_t k, char first, char last) {
+        __m128i first_bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+        __m128i last_bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + k - 1));
+        __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(first_bytes, _mm_set1_epi8(first)),
+                                   _mm_cmpeq_epi8(last_bytes, _mm_set1_epi8(last)));
+        return static_cast<unsigned>(_mm_movemask_epi8(eq));
+    }
+    
+    inline unsigned matchesEither(const char* block, char a, char b) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+        __m128i eq = _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(a)),
+                                  _mm_cmpeq_epi8(bytes, _mm_set1_epi8(b)));
+        return static_cast<unsigned>(_mm_movemask_epi8(eq));
+    }
+#endif
+}
+
+size_t findSubstring(std::string_view haystack, std::string_view needle) {
+    size_t n = haystack.size();
+    size_t k = needle.size();
+    if (k == 0) {
+        return 0;
+    }
+    if (k > n) {
+        return std::string_view::npos;
+    }
+    if (k == 1) {
+        const void* found = memchr(haystack.data(), needle[0], n);
+        return found == nullptr ? std::string_view::npos
+                                : static_cast<const char*>(found) - haystack.data();
+    }
+    
+    size_t pos = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+    const char* data = haystack.data();
+    
+    // Both loads of a block must stay inside the haystack
+    for (; pos + k - 1 + BLOCK <= n; pos += BLOCK) {
+        unsigned mask = candidates(data + pos, k, needle[0], needle[k - 1]);
+        while (mask != 0) {
+            size_t offset = __builtin_ctz(mask);
+            if (memcmp(data + pos + offset + 1, needle.data() + 1, k - 2) == 0) {
+                return pos + offset;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+    return haystack.find(needle, pos);
+}
+
+size_t findEitherByte(std::string_view text, char a, char b, size_t pos) {
+    size_t n = text.size();
+    const char* data = text.data();
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; pos + BLOCK <= n; pos += BLOCK) {
+        unsigned mask = matchesEither(data + pos, a, b);
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+#endif
+    for (; pos < n; ++pos) {
+        if (data[pos] == a || data[pos] == b) {
+            return pos;
+        }
+    }
+    return n;
+}
\ No newline at end of file
@@ -0,0 +1,184 @@
+#include <server/admission_control.h>
+#include <common/logger.h>
+#include <common/protocol.h>
+#include <algorithm>
+#include <chrono>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <string.h>
+
+namespace {
+    // A stripe is not scanned for stale budgets below this many entries
+    const size_t MIN_PRUNE_SIZE = 256;
+    
+    const int64_t NS_PER_SECOND = 1000000000;
+    
+    int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+TokenBucket::TokenBucket() : full_at_ns_(0) {
+}
+
+bool TokenBucket::take(int64_t now_ns, int64_t interval_ns, int64_t capacity_ns) {
+    int64_t full_at = full_at_ns_.load(std::memory_order_relaxed);
+    while (true) {
+        // A bucket that refilled long ago is full, not fuller
+        int64_t next = std::max(full_at, now_ns) + interval_ns;
+        if (next - now_ns > capacity_ns) {
+            return false;
+        }
+        if (full_at_ns_.compare_exchange_weak(full_at, next, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
+
+bool TokenBucket::isFull(int64_t now_ns) const {
+    return full_at_ns_.load(std::memory_order_relaxed) <= now_ns;
+}
+
+PeerBudget::PeerBudget(int64_t request_interval_ns, int64_t request_capacity_ns)
+    : request_interval_ns_(request_interval_ns), request_capacity_ns_(request_capacity_ns) {
+}
+
+bool PeerBudget::takeRequest() {
+    if (request_interval_ns_ == 0) {
+        return true;
+    }
+    return requests_.take(nowNs(), request_interval_ns_, request_capacity_ns_);
+}
+
+AdmissionControl::AdmissionControl(ServerMetrics& metrics, size_t max_connections, size_t connection_rate,
+                                   size_t connection_burst, size_t request_rate, size_t request_burst)
+    : metrics_(metrics), max_connections_(max_connections), per_peer_(connection_rate > 0 || request_rate > 0),
+      connection_interval_ns_(refillInterval(connection_rate)),
+      connection_capacity_ns_(bucketCapacity(connection_rate, connection_burst)),
+      request_interval_ns_(refillInterval(request_rate)),
+      request_capacity_ns_(bucketCapacity(request_rate, request_burst)), stripes_(new Stripe[STRIPES]) {
+    if (max_connections_ > 0 || per_peer_) {
+        Logger::logMessage("AdmissionControl initialized: max connections " +
+                           (max_connections_ > 0 ? std::to_string(max_connections_) : std::string("unlimited")) +
+                           ", per peer " +
+                           (connection_rate > 0 ? std::to_string(connection_rate) : std::string("unlimited")) +
+                           " connections/s and " +
+                           (request_rate > 0 ? std::to_string(request_rate) : std::string("unlimited")) +
+                           " requests/s");
+    }
+}
+
+bool AdmissionControl::admitConnection(int client_socket, const struct sockaddr_storage& peer_addr,
+                                       size_t open_connections, std::shared_ptr<PeerBudget>& budget) {
+    budget.reset();
+    if (max_connections_ > 0 && open_connections >= max_connections_) {
+        refuse(client_socket, ServerMetrics::RejectReason::CONNECTION_LIMIT);
+        return false;
+    }
+    
+    PeerKey key;
+    if (!per_peer_ || !makeKey(peer_addr, key)) {
+        return true;
+    }
+    
+    budget = chargeConnection(key, nowNs());
+    if (!budget) {
+        refuse(client_socket, ServerMetrics::RejectReason::CONNECTION_RATE);
+        return false;
+    }
+    return true;
+}
+
+void AdmissionControl::refuse(int client_socket, ServerMetrics::RejectReason reason) {
+    std::string_view response = Protocol::PREPARED_SERVER_BUSY.encoded(Protocol::Encoding::TEXT);
+    send(client_socket, response.data(), response.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+    close(client_socket);
+    metrics_.recordRejected(reason);
+    Logger::debug("Connection refused: ", ServerMetrics::rejectReasonToString(reason));
+}
+
+size_t AdmissionControl::getTrackedPeers() const {
+    size_t total = 0;
+    for (size_t i = 0; i < STRIPES; ++i) {
+        std::lock_guard<std::mutex> lock(stripes_[i].mutex);
+        total += stripes_[i].peers.size();
+    }
+    return total;
+}
+
+std::shared_ptr<PeerBudget> AdmissionControl::chargeConnection(const PeerKey& key, int64_t now_ns) {
+    // The map hashes the low bits; the stripe is chosen by the high ones
+    size_t hash = PeerKeyHash()(key);
+    Stripe& stripe = stripes_[(hash >> 32) % STRIPES];
+    
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    std::shared_ptr<PeerBudget>& budget = stripe.peers[key];
+    if (!budget) {
+        budget = std::make_shared<PeerBudget>(request_interval_ns_, request_capacity_ns_);
+    }
+    
+    if (connection_interval_ns_ > 0 &&
+        !budget->connections_.take(now_ns, connection_interval_ns_, connection_capacity_ns_)) {
+        return nullptr;
+    }
+    std::shared_ptr<PeerBudget> admitted = budget;
+    
+    // Amortized: the next scan waits until the stripe has doubled
+    if (stripe.peers.size() >= std::max(stripe.prune_at, MIN_PRUNE_SIZE)) {
+        prune(stripe, now_ns);
+        stripe.prune_at = stripe.peers.size() * 2;
+    }
+    return admitted;
+}
+
+void AdmissionControl::prune(Stripe& stripe, int64_t now_ns) {
+    // References are only copied under the stripe lock, so a budget held
+    // by the table alone cannot be picked up while it is erased
+    for (auto it = stripe.peers.begin(); it != stripe.peers.end();) {
+        const PeerBudget& budget = *it->second;
+        if (it->second.use_count() == 1 && budget.connections_.isFull(now_ns) && budget.requests_.isFull(now_ns)) {
+            it = stripe.peers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool AdmissionControl::makeKey(const struct sockaddr_storage& addr, PeerKey& key) {
+    if (addr.ss_family == AF_INET) {
+        const struct sockaddr_in* addr_in = (const struct sockaddr_in*)&addr;
+        memset(key.bytes, 0, 10);
+        key.bytes[10] = 0xff;
+        key.bytes[11] = 0xff;
+        memcpy(key.bytes + 12, &addr_in->sin_addr, 4);
+        return true;
+    }
+    if (addr.ss_family == AF_INET6) {
+        const struct sockaddr_in6* addr_in6 = (const struct sockaddr_in6*)&addr;
+        memcpy(key.bytes, &addr_in6->sin6_addr, 16);
+        return true;
+    }
+    return false;
+}
+
+bool AdmissionControl::PeerKey::operator==(const PeerKey& other) const {
+    return memcmp(bytes, other.bytes, sizeof(bytes)) == 0;
+}
+
+size_t AdmissionControl::PeerKeyHash::operator()(const PeerKey& key) const {
+    // FNV-1a over the 16 address bytes
+    uint64_t hash = 14695981039346656037ULL;
+    for (uint8_t byte : key.bytes) {
+        hash = (hash ^ byte) * 1099511628211ULL;
+    }
+    return static_cast<size_t>(hash);
+}
+
+int64_t AdmissionControl::refillInterval(size_t rate) {
+    return rate > 0 ? std::max<int64_t>(NS_PER_SECOND / static_cast<int64_t>(rate), 1) : 0;
+}
+
+int64_t AdmissionControl::bucketCapacity(size_t rate, size_t burst) {
+    return refillInterval(rate) * static_cast<int64_t>(burst > 0 ? burst : std::max<size_t>(rate, 1));
+}
\ No newline at end of file
@@ -0,0 +1,287 @@
+#include <server/cache_snapshot.h>
+#include <common/checksum.h>
+#include <common/logger.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+namespace {
+    const char SNAPSHOT_MAGIC[8] = {'W', 'S', 'S', 'N', 'A', 'P', '0', '3'};
+    const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+    const size_t RECORD_HEADER_SIZE = sizeof(uint64_t) + sizeof(uint32_t);
+    const size_t WRITE_BUFFER_SIZE = 1024 * 1024;
+    
+    static_assert(sizeof(SnapshotHeader) == 80, "snapshot header layout changed");
+    static_assert(sizeof(SnapshotEntry) == 24, "snapshot entry layout changed");
+    
+    bool writeAll(int fd, const char* data, size_t size) {
+        size_t total_written = 0;
+        
+        while (total_written < size) {
+            ssize_t written = ::write(fd, data + total_written, size - total_written);
+            if (written == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            total_written += written;
+        }
+        return true;
+    }
+    
+    // Make a rename in the directory of path durable
+    bool syncDirectory(const std::string& path) {
+        size_t slash = path.find_last_of('/');
+        std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+        int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd == -1) {
+            return false;
+        }
+        bool ok = fsync(fd) == 0;
+        ::close(fd);
+        return ok;
+    }
+    
+    int64_t elapsedMs(std::chrono::steady_clock::time_point started) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - started).count();
+    }
+}
+
+CacheSnapshot::CacheSnapshot(const std::string& path, DataCache& cache, WriteAheadLog* wal, int interval_ms)
+    : path_(path), cache_(cache), wal_(wal), interval_ms_(interval_ms), stopping_(false),
+      last_seq_(0), last_wal_offset_(0), snapshots_(0) {
+}
+
+CacheSnapshot::~CacheSnapshot() {
+    stop();
+}
+
+void CacheSnapshot::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (worker_.joinable()) {
+        return;
+    }
+    stopping_ = false;
+    worker_ = std::thread(&CacheSnapshot::run, this);
+    Logger::logMessage("Snapshots of the cache are written to " + path_ + " every " +
+                       std::to_string(interval_ms_ / 1000) + " s");
+}
+
+void CacheSnapshot::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+bool CacheSnapshot::takeSnapshot() {
+    std::lock_guard<std::mutex> snapshot_lock(snapshot_mutex_);
+    auto started = std::chrono::steady_clock::now();
+    
+    // Read the log position first: entries are inserted before they are
+    // logged, so every record up to it is already visible in the cache.
+    // Records after it may be captured too; replay skips the ones below the
+    // watermark and finds the others already present.
+    uint64_t wal_offset = wal_ != nullptr ? wal_->getAppendedPosition() : 0;
+    uint64_t committed_seq = cache_.getCommittedSeq();
+    CacheBatch batch = cache_.capture();
+    uint64_t last_seq = batch.entries.empty() ? 0 : batch.entries.back().seq;
+    if (last_seq == last_seq_ && wal_offset == last_wal_offset_) {
+        return true;
+    }
+    
+    // Never point past the durable end of the log, or records appended after
+    // a crash truncated it would be skipped on the next restart
+    if (wal_ != nullptr && !wal_->waitDurable(wal_offset)) {
+        Logger::logError("Snapshot skipped: write-ahead log unavailable");
+        return false;
+    }
+    
+    if (!write(path_, batch, wal_offset, committed_seq)) {
+        return false;
+    }
+    last_seq_ = last_seq;
+    last_wal_offset_ = wal_offset;
+    snapshots_.fetch_add(1, std::memory_order_relaxed);
+    
+    Logger::logMessage("Snapshot of " + std::to_string(batch.entries.size()) + " entries written to " +
+                       path_ + " in " + std::to_string(elapsedMs(started)) + " ms");
+    return true;
+}
+
+size_t CacheSnapshot::getSnapshotCount() const {
+    return snapshots_.load(std::memory_order_relaxed);
+}
+
+bool CacheSnapshot::write(const std::string& path, const CacheBatch& batch, uint64_t wal_offset,
+                          uint64_t committed_seq) {
+    std::vector<SnapshotEntry> table(batch.entries.size());
+    uint64_t records_size = 0;
+    for (size_t i = 0; i < batch.entries.size(); ++i) {
+        const CacheBatch::Entry& entry = batch.entries[i];
+        table[i] = SnapshotEntry{entry.seq, records_size + RECORD_HEADER_SIZE,
+                                 static_cast<uint32_t>(entry.data.size()), 0};
+        records_size += RECORD_HEADER_SIZE + entry.data.size();
+    }
+    
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.table_crc = crc32(table.data(), table.size() * sizeof(SnapshotEntry));
+    header.entry_count = table.size();
+    header.wal_offset = wal_offset;
+    header.committed_seq = committed_seq;
+    header.table_offset = sizeof(SnapshotHeader);
+    header.records_offset = header.table_offset + table.size() * sizeof(SnapshotEntry);
+    header.records_size = records_size;
+    header.created_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    
+    std::string temp_path = path + ".tmp";
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        Logger::logError("Failed to create snapshot " + temp_path + ": " + strerror(errno));
+        return false;
+    }
+    
+    bool ok = writeAll(fd, reinterpret_cast<const char*>(&header), sizeof(header)) &&
+              writeAll(fd, reinterpret_cast<const char*>(table.data()), table.size() * sizeof(SnapshotEntry));
+    
+    // Records are gathered into a large buffer to keep the write count low,
+    // and checksummed a buffer at a time
+    std::string buffer;
+    buffer.reserve(WRITE_BUFFER_SIZE);
+    for (size_t i = 0; ok && i < batch.entries.size(); ++i) {
+        const CacheBatch::Entry& entry = batch.entries[i];
+        uint32_t length = table[i].length;
+        buffer.append(reinterpret_cast<const char*>(&entry.seq), sizeof(entry.seq));
+        buffer.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        buffer.append(entry.data.data(), entry.data.size());
+        if (buffer.size() >= WRITE_BUFFER_SIZE) {
+            header.records_crc = crc32(buffer.data(), buffer.size(), header.records_crc);
+            ok = writeAll(fd, buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+    header.records_crc = crc32(buffer.data(), buffer.size(), header.records_crc);
+    ok = ok && writeAll(fd, buffer.data(), buffer.size());
+    
+    // The header goes in again once the record checksum is known
+    ok = ok && pwrite(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+         fdatasync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    
+    if (!ok || rename(temp_path.c_str(), path.c_str()) == -1) {
+        Logger::logError("Failed to write snapshot " + path + ": " + strerror(errno));
+        unlink(temp_path.c_str());
+        return false;
+    }
+    
+    // Until the directory is synced a crash may bring back the old file
+    if (!syncDirectory(path)) {
+        Logger::logError("Failed to sync the directory of snapshot " + path + ": " + strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool CacheSnapshot::load(const std::string& path, SnapshotImage& image) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        if (errno != ENOENT) {
+            Logger::logError("Failed to open snapshot " + path + ": " + strerror(errno));
+        }
+        return false;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) == -1 || static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+        Logger::logError("Snapshot " + path + " is truncated");
+        ::close(fd);
+        return false;
+    }
+    
+    size_t file_size = static_cast<size_t>(st.st_size);
+    void* mapping = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        Logger::logError("Failed to map snapshot " + path + ": " + strerror(errno));
+        return false;
+    }
+    std::shared_ptr<char[]> owner(static_cast<char*>(mapping), [file_size](char* data) {
+        munmap(data, file_size);
+    });
+    
+    SnapshotHeader header;
+    memcpy(&header, owner.get(), sizeof(header));
+    bool valid = memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) == 0 &&
+                 header.byte_order == SNAPSHOT_BYTE_ORDER &&
+                 header.table_offset == sizeof(SnapshotHeader) &&
+                 header.entry_count <= (file_size - header.table_offset) / sizeof(SnapshotEntry) &&
+                 header.records_offset == header.table_offset + header.entry_count * sizeof(SnapshotEntry) &&
+                 header.records_size == file_size - header.records_offset;
+    if (!valid) {
+        Logger::logError("Snapshot " + path + " has an invalid header");
+        return false;
+    }
+    
+    const SnapshotEntry* entries = reinterpret_cast<const SnapshotEntry*>(owner.get() + header.table_offset);
+    if (crc32(entries, header.entry_count * sizeof(SnapshotEntry)) != header.table_crc) {
+        Logger::logError("Snapshot " + path + " has a corrupt offset table");
+        return false;
+    }
+    
+    // The cache walks records back to back, so they must be contiguous
+    uint64_t expected_offset = RECORD_HEADER_SIZE;
+    for (size_t i = 0; i < header.entry_count; ++i) {
+        if (entries[i].offset != expected_offset || entries[i].offset + entries[i].length > header.records_size ||
+            (i > 0 && entries[i].seq <= entries[i - 1].seq)) {
+            Logger::logError("Snapshot " + path + " has an inconsistent offset table");
+            return false;
+        }
+        expected_offset += entries[i].length + RECORD_HEADER_SIZE;
+    }
+    if (expected_offset - RECORD_HEADER_SIZE != header.records_size) {
+        Logger::logError("Snapshot " + path + " has an inconsistent offset table");
+        return false;
+    }
+    
+    // Reading the records once to check them also faults the pages in
+    madvise(mapping, file_size, MADV_WILLNEED);
+    if (crc32(owner.get() + header.records_offset, header.records_size) != header.records_crc) {
+        Logger::logError("Snapshot " + path + " has corrupt records");
+        return false;
+    }
+    image.entries = entries;
+    image.entry_count = header.entry_count;
+    image.records = owner.get() + header.records_offset;
+    image.records_size = header.records_size;
+    image.wal_offset = header.wal_offset;
+    image.committed_seq = header.committed_seq;
+    image.mapping = std::move(owner);
+    return true;
+}
+
+void CacheSnapshot::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (cv_.wait_for(lock, std::chrono::milliseconds(interval_ms_), [this] { return stopping_; })) {
+            break;
+        }
+        lock.unlock();
+        takeSnapshot();
+        lock.lock();
+    }
+}
\ No newline at end of file
@@ -2,139 +2,708 @@
 #include <common/logger.h>
 #include <sys/socket.h>
 #include <sys/types.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
 #include <unistd.h>
+#include <poll.h>
+#include <errno.h>
 #include <string.h>
+#include <chrono>
 #include <sstream>
+#include <iomanip>
 #include <iostream>
+#include <charconv>
 
-ClientHandler::ClientHandler(int client_socket, DataCache& cache, std::atomic<bool>& server_running)
-    : client_socket_(client_socket), cache_(cache), server_running_(server_running) {
-    Logger::logMessage("ClientHandler created for socket " + std::to_string(client_socket_));
+namespace {
+    // Payloads at least this large are queued by reference rather than copied
+    const size_t MIN_REFERENCED_PAYLOAD = 256;
+    
+    
+    void appendNumber(OutputQueue& output, uint64_t value) {
+        char digits[20];
+        char* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+        output.append(std::string_view(digits, end - digits));
+    }
+}
+
+ClientHandler::ClientHandler(std::shared_ptr<ConnectionContext> context, DataCache& cache, ClientStats& stats,
+                             ServerMetrics& metrics, std::atomic<bool>& server_running, const ServerConfig& config)
+    : context_(std::move(context)), client_socket_(context_->socket), cache_(cache), stats_(stats),
+      metrics_(metrics), server_running_(server_running), config_(config), pending_log_position_(0),
+      defer_acks_(false), input_(config.max_message_size), started_(false), stream_since_(0), stream_cursor_(0), catching_up_(false), request_method_(Protocol::Method::UNKNOWN), request_path_(Protocol::PathId::UNKNOWN), response_status_(0),
+      received_at_(context_->connected_at), timed_from_accept_(false) {
+    stats_.connectionOpened(context_);
+    Logger::debug("ClientHandler created for socket ", client_socket_);
 }
 
 ClientHandler::~ClientHandler() {
+    if (subscription_) {
+        cache_.getSubscriptions()->unsubscribe(subscription_);
+        Logger::logMessage("Client " + getClientIP() + " unsubscribed, " +
+                           std::to_string(subscription_->getDroppedFrames()) + " entries dropped");
+    }
+    stats_.connectionClosed(context_);
     if (client_socket_ != -1) {
         close(client_socket_);
-        Logger::logMessage("ClientHandler destroyed and socket closed");
+        Logger::debug("ClientHandler destroyed and socket closed");
     }
 }
 
-void ClientHandler::handleRequest() {
-    char recvbuf[Protocol::DEFAULT_BUFLEN];
-    memset(recvbuf, 0, Protocol::DEFAULT_BUFLEN);
+bool ClientHandler::handleRequest() {
+    OutputQueue output;
     
-    ssize_t bytes_received = recv(client_socket_, recvbuf, Protocol::DEFAULT_BUFLEN - 1, 0);
-    if (bytes_received > 0) {
-        std::string request(recvbuf);
-        Logger::logMessage("Request received from " + getClientIP() + ": " + request);
-        
-        Protocol::Method method;
-        std::string path, payload;
+    // A request that arrived while the connection waited for a worker is
+    // timed from accept, so the time spent in the queue counts
+    if (!started_) {
+        started_ = true;
+        struct pollfd pfd;
+        pfd.fd = client_socket_;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        timed_from_accept_ = poll(&pfd, 1, 0) > 0;
+    }
+    
+    while (true) {
+        // Missed entries are streamed page by page without waiting
+        bool readable = false;
+        if (!catching_up_) {
+            WaitResult result = waitForData(readable);
+            if (result != WaitResult::READY) {
+                return result == WaitResult::QUIET;
+            }
+        }
         
-        if (parseRequest(request, method, path, payload)) {
-            std::string response;
-            
-            switch (method) {
-                case Protocol::Method::GET:
-                    response = processGET(path);
-                    break;
-                case Protocol::Method::POST:
-                    response = processPOST(path, payload);
-                    break;
-                default:
-                    response = Protocol::RESPONSE_NOT_FOUND;
-                    break;
+        // A subscription wake-up leaves nothing to read
+        if (readable) {
+            ssize_t bytes_received = input_.readFrom(client_socket_);
+            if (bytes_received == 0) {
+                Logger::debug("Client ", getClientIP(), " disconnected");
+                return false;
+            } else if (bytes_received == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno != EMSGSIZE) {
+                    Logger::logError("recv failed for client " + getClientIP());
+                    return false;
+                }
+            } else {
+                markReceived();
             }
-            
-            sendResponse(response);
+        }
+        
+        bool keep_open = processInput(input_, output);
+        
+        if (!output.empty() && !sendResponse(output)) {
+            return false;
+        }
+        
+        if (!keep_open) {
+            return false;
+        }
+    }
+}
+
+ClientHandler::WaitResult ClientHandler::waitForData(bool& readable) {
+    // A quiet connection goes to the idle poller at once, which keeps the
+    // idle timeout; a worker waiting on it would sit idle while others queue
+    while (server_running_) {
+        struct pollfd pfds[2];
+        pfds[0].fd = client_socket_;
+        pfds[1].fd = getSubscriptionFd();
+        for (struct pollfd& pfd : pfds) {
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+        }
+        
+        int ready = poll(pfds, subscription_ ? 2 : 1, 0);
+        if (ready > 0) {
+            readable = pfds[0].revents != 0;
+            return WaitResult::READY;
+        } else if (ready == 0) {
+            return WaitResult::QUIET;
+        } else if (errno != EINTR) {
+            return WaitResult::CLOSED;
+        }
+    }
+    return WaitResult::CLOSED;
+}
+
+bool ClientHandler::processInput(InputBuffer& input, OutputQueue& output) {
+    bool keep_open = true;
+    
+    // Frames are parsed in place; consumed bytes are released afterwards
+    std::string_view buffered = input.data();
+    size_t start = 0;
+    
+    while (start < buffered.size() && keep_open && !subscription_) {
+        std::string_view pending = buffered.substr(start);
+        auto started = std::chrono::steady_clock::now();
+        size_t output_before = output.size();
+        size_t consumed;
+        request_method_ = Protocol::Method::UNKNOWN;
+        request_path_ = Protocol::PathId::UNKNOWN;
+        response_status_ = 0;
+        
+        if (Protocol::detectEncoding(static_cast<uint8_t>(pending[0])) == Protocol::Encoding::BINARY) {
+            consumed = processBinaryFrame(pending, output, keep_open);
         } else {
-            Logger::logError("Failed to parse request: " + request);
-            sendResponse(Protocol::RESPONSE_NOT_FOUND);
+            consumed = processTextFrame(pending, output);
+        }
+        
+        if (consumed == 0) {
+            break;
+        }
+        start += consumed;
+        context_->counters.recordRequest(consumed, output.size() - output_before,
+                                         std::chrono::steady_clock::now() - started);
+        
+        // Blank lines are consumed without an answer
+        if (response_status_ != 0) {
+            metrics_.recordRequest(request_method_, request_path_, response_status_, consumed,
+                                   output.size() - output_before);
+            unsent_.emplace_back(request_path_, received_at_);
+        }
+        
+        // Stop reading once a shutdown request has been answered
+        if (!server_running_) {
+            keep_open = false;
+        }
+    }
+    
+    // An incomplete frame that is already larger than allowed can never finish
+    if (keep_open && !subscription_ && buffered.size() - start > config_.max_message_size) {
+        size_t output_before = output.size();
+        rejectOversizedFrame(buffered.substr(start), output);
+        metrics_.recordRequest(Protocol::Method::UNKNOWN, Protocol::PathId::UNKNOWN, response_status_,
+                               buffered.size() - start, output.size() - output_before);
+        unsent_.emplace_back(Protocol::PathId::UNKNOWN, received_at_);
+        keep_open = false;
+    }
+    
+    // Acknowledge POSTs only once they are durable; one wait covers every
+    // entry added from this batch of input
+    if (pending_log_position_ != 0 && !defer_acks_) {
+        bool durable = cache_.waitDurable(pending_log_position_);
+        pending_log_position_ = 0;
+        if (!durable) {
+            dropUnloggedResponses(output);
+            keep_open = false;
+        }
+    }
+    
+    if (!keep_open) {
+        input.clear();
+    } else if (subscription_) {
+        // A subscribed connection only streams; whatever else it sends is dropped
+        input.clear();
+        if (output.empty()) {
+            keep_open = pumpSubscription(output);
         }
-    } else if (bytes_received == 0) {
-        Logger::logMessage("Client " + getClientIP() + " disconnected");
     } else {
-        Logger::logError("recv failed for client " + getClientIP());
+        input.consume(start);
     }
+    return keep_open;
 }
 
-bool ClientHandler::parseRequest(const std::string& request, Protocol::Method& method, 
-                                std::string& path, std::string& payload) {
-    std::istringstream request_stream(request);
-    std::string method_str;
+void ClientHandler::deferAcks() {
+    defer_acks_ = true;
+}
+
+bool ClientHandler::acksDurable(OutputQueue& output, bool& keep_open) {
+    if (pending_log_position_ == 0) {
+        return true;
+    }
     
-    if (!(request_stream >> method_str >> path)) {
+    bool durable = false;
+    if (!cache_.pollDurable(pending_log_position_, durable)) {
+        dropUnloggedResponses(output);
+        keep_open = false;
+    } else if (!durable) {
         return false;
     }
+    pending_log_position_ = 0;
+    return true;
+}
+
+void ClientHandler::dropUnloggedResponses(OutputQueue& output) {
+    Logger::logError("Write-ahead log unavailable, dropping connection from " + getClientIP());
+    output.clear();
+    unsent_.clear();
+}
+
+void ClientHandler::rejectOversizedFrame(std::string_view pending, OutputQueue& output) {
+    Logger::logError("Request from " + getClientIP() + " exceeds the maximum message size of " +
+                     std::to_string(config_.max_message_size) + " bytes");
+    respond(output, Protocol::detectEncoding(static_cast<uint8_t>(pending[0])), Protocol::PREPARED_PAYLOAD_TOO_LARGE);
+}
+
+size_t ClientHandler::processTextFrame(std::string_view pending, OutputQueue& output) {
+    size_t delimiter = pending.find(Protocol::FRAME_DELIMITER);
+    if (delimiter == std::string_view::npos) {
+        return 0;
+    }
     
-    method = Protocol::parseMethod(method_str);
-    if (method == Protocol::Method::UNKNOWN) {
-        return false;
+    // Tolerate CRLF line endings from interactive tools
+    size_t end = delimiter;
+    if (end > 0 && pending[end - 1] == '\r') {
+        end--;
     }
     
-    // Read the rest of the line as payload
-    std::getline(request_stream, payload);
-    // Trim leading space from payload
-    if (!payload.empty() && payload[0] == ' ') {
-        payload = payload.substr(1);
+    if (end > 0) {
+        processRequest(pending.substr(0, end), output);
+    }
+    return delimiter + 1;
+}
+
+size_t ClientHandler::processBinaryFrame(std::string_view pending, OutputQueue& output, bool& keep_open) {
+    Protocol::BinaryHeader header;
+    if (!Protocol::decodeBinaryHeader(pending, header)) {
+        return 0;
     }
     
-    return true;
+    // Frame boundaries of other versions are unknown, so the stream cannot be resynchronized
+    if (header.version != Protocol::BINARY_VERSION) {
+        Logger::logError("Unsupported binary protocol version " + std::to_string(header.version) +
+                         " from " + getClientIP());
+        respond(output, Protocol::Encoding::BINARY, Protocol::PREPARED_NOT_FOUND);
+        keep_open = false;
+        return pending.size();
+    }
+    
+    // The header announces the size up front, so oversized frames fail early
+    if (header.payload_length > config_.max_message_size) {
+        rejectOversizedFrame(pending, output);
+        keep_open = false;
+        return pending.size();
+    }
+    
+    size_t frame_length = Protocol::BINARY_HEADER_SIZE + header.payload_length;
+    if (pending.size() < frame_length) {
+        return 0;
+    }
+    
+    // Path and payload are views into the receive buffer; nothing is copied
+    std::string_view path = Protocol::idToPath(static_cast<Protocol::PathId>(header.path_id));
+    std::string_view payload = pending.substr(Protocol::BINARY_HEADER_SIZE, header.payload_length);
+    
+    Protocol::Method method = Protocol::Method::UNKNOWN;
+    if (header.opcode == Protocol::Opcode::GET) {
+        method = Protocol::Method::GET;
+    } else if (header.opcode == Protocol::Opcode::POST) {
+        method = Protocol::Method::POST;
+    }
+    
+    Logger::debug("Binary request received from ", getClientIP(), ": ",
+                  [method] { return Protocol::methodToString(method); }, " path id ",
+                  static_cast<unsigned>(header.path_id), " (", payload.size(), " payload bytes)");
+    
+    dispatch(method, path, payload, Protocol::Encoding::BINARY, output);
+    return frame_length;
 }
 
-std::string ClientHandler::processGET(const std::string& path) {
-    if (path == Protocol::PATH_STATUS) {
-        return Protocol::RESPONSE_STATUS_OK;
-    } else if (path == Protocol::PATH_SHUTDOWN) {
-        Logger::logMessage("Shutdown request received from " + getClientIP());
-        server_running_ = false;
-        return "200 OK - Server shutting down";
-    } else {
-        Logger::logMessage("GET request for unknown path: " + path);
-        return Protocol::RESPONSE_NOT_FOUND;
+void ClientHandler::processRequest(std::string_view request, OutputQueue& output) {
+    Logger::debug("Request received from ", getClientIP(), ": ", request);
+    
+    Protocol::Method method;
+    std::string_view path, payload;
+    
+    if (!Protocol::parseRequest(request, method, path, payload)) {
+        Logger::warn("Failed to parse request: ", request);
+        context_->counters.recordCommand(Protocol::Method::UNKNOWN);
+        respond(output, Protocol::Encoding::TEXT, Protocol::PREPARED_NOT_FOUND);
+        return;
     }
+    
+    dispatch(method, path, payload, Protocol::Encoding::TEXT, output);
 }
 
-std::string ClientHandler::processPOST(const std::string& path, const std::string& payload) {
-    if (path == Protocol::PATH_DATA) {
-        cache_.addData(payload);
-        Logger::logMessage("POST data processed from " + getClientIP() + ": " + payload);
-        return Protocol::RESPONSE_DATA_CREATED;
+void ClientHandler::dispatch(Protocol::Method method, std::string_view path, std::string_view payload,
+                             Protocol::Encoding encoding, OutputQueue& output) {
+    context_->counters.recordCommand(method);
+    
+    // Binary GETs carry their query string as the payload
+    std::string_view query = payload;
+    if (method == Protocol::Method::GET && encoding == Protocol::Encoding::TEXT) {
+        Protocol::splitQuery(path, path, query);
+    }
+    request_method_ = method;
+    request_path_ = Protocol::pathToId(path);
+    
+    // Over the peer's request rate: answered without touching the cache
+    if (context_->budget && !context_->budget->takeRequest()) {
+        respond(output, encoding, Protocol::PREPARED_TOO_MANY_REQUESTS);
+        return;
+    }
+    
+    switch (method) {
+        case Protocol::Method::GET:
+            processGET(request_path_, path, query, encoding, output);
+            break;
+        case Protocol::Method::POST:
+            processPOST(request_path_, path, payload, encoding, output);
+            break;
+        default:
+            respond(output, encoding, Protocol::PREPARED_NOT_FOUND);
+            break;
+    }
+}
+
+void ClientHandler::processGET(Protocol::PathId path_id, std::string_view path, std::string_view query,
+                               Protocol::Encoding encoding, OutputQueue& output) {
+    switch (path_id) {
+        case Protocol::PathId::STATUS:
+            respond(output, encoding, Protocol::PREPARED_STATUS_OK);
+            break;
+        case Protocol::PathId::DATA:
+            processDataRead(query, encoding, output);
+            break;
+        case Protocol::PathId::DATA_SEARCH:
+            processSearch(query, encoding, output);
+            break;
+        case Protocol::PathId::DATA_SUBSCRIBE:
+            processSubscribe(query, encoding, output);
+            break;
+        case Protocol::PathId::STATS:
+            respond(output, encoding, formatStats());
+            break;
+        case Protocol::PathId::METRICS:
+            respond(output, encoding, formatMetrics(encoding));
+            break;
+        case Protocol::PathId::SHUTDOWN:
+            Logger::logMessage("Shutdown request received from " + getClientIP());
+            server_running_ = false;
+            respond(output, encoding, Protocol::PREPARED_SHUTTING_DOWN);
+            break;
+        default:
+            Logger::debug("GET request for unknown path: ", path);
+            respond(output, encoding, Protocol::PREPARED_NOT_FOUND);
+            break;
+    }
+}
+
+void ClientHandler::processPOST(Protocol::PathId path_id, std::string_view path, std::string_view payload,
+                                Protocol::Encoding encoding, OutputQueue& output) {
+    if (path_id == Protocol::PathId::DATA) {
+        if (!cache_.addData(payload, &pending_log_position_)) {
+            respond(output, encoding, Protocol::PREPARED_PAYLOAD_TOO_LARGE);
+            return;
+        }
+        Logger::debug("POST data processed from ", getClientIP(), ": ", payload);
+        respond(output, encoding, Protocol::PREPARED_DATA_CREATED);
+    } else if (path_id == Protocol::PathId::DATA_BATCH) {
+        processBatch(payload, encoding, output);
     } else {
-        Logger::logMessage("POST request for unknown path: " + path);
-        return Protocol::RESPONSE_NOT_FOUND;
+        Logger::debug("POST request for unknown path: ", path);
+        respond(output, encoding, Protocol::PREPARED_NOT_FOUND);
     }
 }
 
-void ClientHandler::sendResponse(const std::string& response) {
-    std::string full_response = response + "\n";
-    ssize_t bytes_sent = send(client_socket_, full_response.c_str(), full_response.length(), 0);
+void ClientHandler::processBatch(std::string_view payload, Protocol::Encoding encoding, OutputQueue& output) {
+    if (!Protocol::parseBatch(payload, batch_records_)) {
+        Logger::debug("Invalid batch from ", getClientIP());
+        respond(output, encoding, Protocol::PREPARED_BAD_REQUEST);
+        return;
+    }
     
-    if (bytes_sent == -1) {
-        Logger::logError("Failed to send response to client " + getClientIP());
-    } else {
-        Logger::logMessage("Response sent to " + getClientIP() + ": " + response);
+    uint64_t first_seq = 0;
+    uint64_t last_seq = 0;
+    if (!cache_.addBatch(batch_records_, first_seq, last_seq, &pending_log_position_)) {
+        respond(output, encoding, Protocol::PREPARED_PAYLOAD_TOO_LARGE);
+        return;
+    }
+    
+    // "201 Created – N entries; first=SEQ; last=SEQ", counting the entries
+    // still cached
+    std::string response = Protocol::RESPONSE_BATCH_CREATED + std::to_string(last_seq - first_seq + 1) +
+                           " entries; first=" + std::to_string(first_seq) +
+                           "; last=" + std::to_string(last_seq);
+    respond(output, encoding, response);
+}
+
+bool ClientHandler::sendResponse(OutputQueue& output) {
+    size_t total = output.size();
+    
+    // The socket is blocking, so each call writes at least part of the queue
+    while (!output.empty()) {
+        if (output.writeTo(client_socket_) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            Logger::logError("Failed to send response to client " + getClientIP());
+            return false;
+        }
+    }
+    
+    Logger::debug("Response sent to ", getClientIP(), " (", total, " bytes)");
+    responsesSent();
+    return true;
+}
+
+void ClientHandler::markReceived() {
+    if (timed_from_accept_) {
+        timed_from_accept_ = false;
+        return;
     }
+    received_at_ = std::chrono::steady_clock::now();
 }
 
-std::string ClientHandler::getClientIP() const {
-    struct sockaddr_storage client_addr;
-    socklen_t addr_len = sizeof(client_addr);
+void ClientHandler::responsesSent() {
+    if (unsent_.empty()) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    for (const auto& request : unsent_) {
+        metrics_.recordLatency(request.first, now - request.second);
+    }
+    unsent_.clear();
+}
+
+void ClientHandler::processDataRead(std::string_view query, Protocol::Encoding encoding, OutputQueue& output) {
+    uint64_t since = 0;
+    uint64_t limit = Protocol::DEFAULT_READ_LIMIT;
+    std::string_view value;
     
-    if (getpeername(client_socket_, (struct sockaddr*)&client_addr, &addr_len) == -1) {
-        return "unknown";
+    if ((Protocol::queryParameter(query, "since", value) && !Protocol::parseUnsigned(value, since)) ||
+        (Protocol::queryParameter(query, "limit", value) && !Protocol::parseUnsigned(value, limit))) {
+        Logger::debug("Invalid data query from ", getClientIP(), ": ", query);
+        respond(output, encoding, Protocol::PREPARED_BAD_REQUEST);
+        return;
+    }
+    if (limit > Protocol::MAX_READ_LIMIT) {
+        limit = Protocol::MAX_READ_LIMIT;
     }
     
-    char client_ip[INET6_ADDRSTRLEN];
-    if (client_addr.ss_family == AF_INET) {
-        struct sockaddr_in* addr_in = (struct sockaddr_in*)&client_addr;
-        inet_ntop(AF_INET, &(addr_in->sin_addr), client_ip, INET_ADDRSTRLEN);
+    // Payloads are read straight from the cache arena
+    CacheBatch batch = cache_.readSince(since, limit, Protocol::MAX_READ_BYTES);
+    writeEntries(batch, encoding, output);
+}
+
+void ClientHandler::processSearch(std::string_view query, Protocol::Encoding encoding, OutputQueue& output) {
+    uint64_t since = 0;
+    uint64_t limit = Protocol::DEFAULT_READ_LIMIT;
+    std::string_view value;
+    
+    if ((Protocol::queryParameter(query, "since", value) && !Protocol::parseUnsigned(value, since)) ||
+        (Protocol::queryParameter(query, "limit", value) && !Protocol::parseUnsigned(value, limit))) {
+        Logger::debug("Invalid search query from ", getClientIP(), ": ", query);
+        respond(output, encoding, Protocol::PREPARED_BAD_REQUEST);
+        return;
+    }
+    if (limit > Protocol::MAX_READ_LIMIT) {
+        limit = Protocol::MAX_READ_LIMIT;
+    }
+    
+    // Exactly one non-empty pattern
+    SearchMode mode;
+    std::string_view raw_pattern;
+    bool has_contains = Protocol::queryParameter(query, "contains", raw_pattern);
+    if (has_contains) {
+        mode = SearchMode::CONTAINS;
+    }
+    std::string_view prefix;
+    if (Protocol::queryParameter(query, "prefix", prefix)) {
+        if (has_contains) {
+            respond(output, encoding, Protocol::PREPARED_BAD_REQUEST);
+            return;
+        }
+        mode = SearchMode::PREFIX;
+        raw_pattern = prefix;
+    } else if (!has_contains) {
+        respond(output, encoding, Protocol::PREPARED_BAD_REQUEST);
+        return;
+    }
+    
+    std::string pattern;
+    if (!Protocol::decodeQueryValue(raw_pattern, pattern) || pattern.empty()) {
+        Logger::debug("Invalid search pattern from ", getClientIP(), ": ", raw_pattern);
+        respond(output, encoding, Protocol::PREPARED_BAD_REQUEST);
+        return;
+    }
+    
+    CacheBatch batch = cache_.search(mode, pattern, since, limit, Protocol::MAX_READ_BYTES);
+    writeEntries(batch, encoding, output);
+}
+
+void ClientHandler::processSubscribe(std::string_view query, Protocol::Encoding encoding, OutputQueue& output) {
+    uint64_t since = 0;
+    std::string_view value;
+    bool has_since = Protocol::queryParameter(query, "since", value);
+    if (has_since && !Protocol::parseUnsigned(value, since)) {
+        Logger::debug("Invalid subscribe query from ", getClientIP(), ": ", query);
+        respond(output, encoding, Protocol::PREPARED_BAD_REQUEST);
+        return;
+    }
+    
+    SubscriptionHub* hub = cache_.getSubscriptions();
+    if (hub == nullptr) {
+        respond(output, encoding, Protocol::PREPARED_NOT_FOUND);
+        return;
+    }
+    subscription_ = hub->subscribe(encoding);
+    if (!subscription_) {
+        respond(output, encoding, Protocol::PREPARED_SERVER_BUSY);
+        return;
+    }
+    
+    // Without a cursor only entries added from now on are sent
+    uint64_t live_from = subscription_->getLiveFrom();
+    stream_since_ = has_since ? since : live_from - 1;
+    stream_cursor_ = stream_since_;
+    catching_up_ = stream_cursor_ + 1 < live_from;
+    
+    Logger::logMessage("Client " + getClientIP() + " subscribed after seq " + std::to_string(stream_since_));
+    
+    // "200 OK – Subscribed; next=SEQ", then the entries after SEQ as
+    // "200 OK – N entries; ..." responses
+    respond(output, encoding, Protocol::RESPONSE_SUBSCRIBED + std::to_string(stream_since_));
+}
+
+bool ClientHandler::pumpSubscription(OutputQueue& output) {
+    Protocol::Encoding encoding = subscription_->getEncoding();
+    
+    if (catching_up_) {
+        // Entries from live_from on arrive as frames; leave them out here
+        uint64_t live_from = subscription_->getLiveFrom();
+        CacheBatch batch = cache_.readSince(stream_cursor_, Protocol::MAX_READ_LIMIT, Protocol::MAX_READ_BYTES);
+        while (!batch.entries.empty() && batch.entries.back().seq >= live_from) {
+            batch.entries.pop_back();
+        }
+        if (!batch.entries.empty()) {
+            batch.next_seq = batch.entries.back().seq;
+            stream_cursor_ = batch.next_seq;
+            writeEntries(batch, encoding, output);
+            return true;
+        }
+        catching_up_ = false;
+    }
+    
+    bool open = subscription_->take(stream_frames_);
+    
+    // Frames are shared with the other subscribers and sent in place
+    for (const StreamFrame& frame : stream_frames_) {
+        if (frame.seq > stream_since_) {
+            output.appendView(std::string_view(frame.data.get(), frame.length));
+            output.retain(frame.data);
+        }
+    }
+    stream_frames_.clear();
+    
+    if (!open) {
+        Logger::warn("Subscriber ", getClientIP(), " fell behind, closing the stream");
+    }
+    return open;
+}
+
+void ClientHandler::writeEntries(const CacheBatch& batch, Protocol::Encoding encoding, OutputQueue& output) {
+    bool binary = encoding == Protocol::Encoding::BINARY;
+    response_status_ = 200;
+    
+    // Binary frames announce the body length, so the header is filled in last
+    size_t header = binary ? output.reserve(Protocol::BINARY_HEADER_SIZE) : 0;
+    size_t body_start = output.size();
+    bool referenced = false;
+    
+    // "200 OK – N entries; next=SEQ; SEQ:LEN:DATA SEQ:LEN:DATA ..."
+    output.append("200 OK – ");
+    appendNumber(output, batch.entries.size());
+    output.append(" entries; next=");
+    appendNumber(output, batch.next_seq);
+    output.append(";");
+    for (const CacheBatch::Entry& entry : batch.entries) {
+        size_t length = binary ? entry.data.size() : Protocol::escapedLength(entry.data);
+        output.append(" ");
+        appendNumber(output, entry.seq);
+        output.append(":");
+        appendNumber(output, length);
+        output.append(":");
+        
+        // Large payloads that go out unchanged are sent from the arena chunk
+        if (length == entry.data.size() && length >= MIN_REFERENCED_PAYLOAD) {
+            output.appendView(entry.data);
+            referenced = true;
+        } else if (length == entry.data.size()) {
+            output.append(entry.data);
+        } else {
+            Protocol::writeEscaped(output.at(output.reserve(length)), entry.data);
+        }
+    }
+    
+    if (referenced) {
+        for (const std::shared_ptr<const char[]>& chunk : batch.chunks) {
+            output.retain(chunk);
+        }
+    }
+    
+    if (binary) {
+        Protocol::writeBinaryHeader(output.at(header), Protocol::Opcode::RESPONSE, 200,
+                                    static_cast<uint32_t>(output.size() - body_start));
     } else {
-        struct sockaddr_in6* addr_in6 = (struct sockaddr_in6*)&client_addr;
-        inet_ntop(AF_INET6, &(addr_in6->sin6_addr), client_ip, INET6_ADDRSTRLEN);
+        output.append(std::string_view(&Protocol::FRAME_DELIMITER, 1));
     }
+}
+
+void ClientHandler::respond(OutputQueue& output, Protocol::Encoding encoding,
+                            const Protocol::PreparedResponse& response) {
+    response_status_ = response.getStatus();
+    output.appendView(response.encoded(encoding));
+}
+
+void ClientHandler::respond(OutputQueue& output, Protocol::Encoding encoding, std::string_view response) {
+    response_status_ = Protocol::responseStatus(response);
+    if (encoding == Protocol::Encoding::BINARY) {
+        size_t header = output.reserve(Protocol::BINARY_HEADER_SIZE);
+        Protocol::writeBinaryHeader(output.at(header), Protocol::Opcode::RESPONSE,
+                                    Protocol::responseStatus(response), static_cast<uint32_t>(response.size()));
+        output.append(response);
+    } else {
+        output.append(response);
+        output.append(std::string_view(&Protocol::FRAME_DELIMITER, 1));
+    }
+}
+
+std::string ClientHandler::formatStats() const {
+    std::vector<ClientSummary> clients = stats_.snapshot();
     
-    return std::string(client_ip);
-} 
\ No newline at end of file
+    std::ostringstream stats;
+    stats << "200 OK – " << clients.size() << (clients.size() == 1 ? " client" : " clients");
+    stats << std::fixed << std::setprecision(1);
+    for (const ClientSummary& client : clients) {
+        stats << "; " << client.ip
+              << " connections=" << client.connections
+              << " active=" << client.active_connections
+              << " requests=" << client.totalRequests()
+              << " get=" << client.get_requests
+              << " post=" << client.post_requests
+              << " other=" << client.other_requests
+              << " bytes_in=" << client.bytes_in
+              << " bytes_out=" << client.bytes_out
+              << " avg_response_us=" << client.meanResponseTimeUs();
+    }
+    return stats.str();
+}
+
+std::string ClientHandler::formatMetrics(Protocol::Encoding encoding) const {
+    std::string response = "200 OK – metrics\n" + metrics_.render();
+    if (encoding == Protocol::Encoding::BINARY) {
+        return response;
+    }
+    
+    std::string escaped;
+    Protocol::appendEscaped(escaped, response);
+    return escaped;
+}
+
+bool ClientHandler::isSubscribed() const {
+    return subscription_ != nullptr;
+}
+
+int ClientHandler::getSocket() const {
+    return client_socket_;
+}
+
+int ClientHandler::getSubscriptionFd() const {
+    return subscription_ ? subscription_->getWakeFd() : -1;
+}
+
+const std::string& ClientHandler::getClientIP() const {
+    return context_->peer_ip;
+}
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include <server/client_stats.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <algorithm>
+
+namespace {
+    // Only the owning thread writes, so a load/store pair cannot lose updates
+    void addRelaxed(std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+    
+    uint64_t loadRelaxed(const std::atomic<uint64_t>& counter) {
+        return counter.load(std::memory_order_relaxed);
+    }
+}
+
+void ConnectionCounters::recordCommand(Protocol::Method method) {
+    switch (method) {
+        case Protocol::Method::GET:
+            addRelaxed(get_requests, 1);
+            break;
+        case Protocol::Method::POST:
+            addRelaxed(post_requests, 1);
+            break;
+        default:
+            addRelaxed(other_requests, 1);
+            break;
+    }
+}
+
+void ConnectionCounters::recordRequest(size_t request_bytes, size_t response_bytes,
+                                       std::chrono::nanoseconds elapsed) {
+    addRelaxed(bytes_in, request_bytes);
+    addRelaxed(bytes_out, response_bytes);
+    addRelaxed(response_time_ns, static_cast<uint64_t>(elapsed.count()));
+}
+
+ConnectionContext::ConnectionContext(int socket, const struct sockaddr_storage& peer_addr)
+    : socket(socket), peer_ip(addressToString(peer_addr)), connected_at(std::chrono::steady_clock::now()) {
+}
+
+std::string ConnectionContext::addressToString(const struct sockaddr_storage& addr) {
+    char client_ip[INET6_ADDRSTRLEN];
+    if (addr.ss_family == AF_INET) {
+        const struct sockaddr_in* addr_in = (const struct sockaddr_in*)&addr;
+        inet_ntop(AF_INET, &(addr_in->sin_addr), client_ip, INET_ADDRSTRLEN);
+    } else if (addr.ss_family == AF_INET6) {
+        const struct sockaddr_in6* addr_in6 = (const struct sockaddr_in6*)&addr;
+        inet_ntop(AF_INET6, &(addr_in6->sin6_addr), client_ip, INET6_ADDRSTRLEN);
+    } else {
+        return "unknown";
+    }
+    return std::string(client_ip);
+}
+
+uint64_t ClientSummary::totalRequests() const {
+    return get_requests + post_requests + other_requests;
+}
+
+double ClientSummary::meanResponseTimeUs() const {
+    uint64_t requests = totalRequests();
+    return requests > 0 ? static_cast<double>(response_time_ns) / requests / 1000.0 : 0.0;
+}
+
+void ClientStats::connectionOpened(const std::shared_ptr<ConnectionContext>& context) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    live_.insert(context);
+}
+
+void ClientStats::connectionClosed(const std::shared_ptr<ConnectionContext>& context) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (live_.erase(context) == 0) {
+        return;
+    }
+    
+    auto it = closed_.find(context->peer_ip);
+    if (it == closed_.end()) {
+        const std::string& key = closed_.size() < MAX_TRACKED_CLIENTS ? context->peer_ip : "other";
+        it = closed_.emplace(key, ClientSummary()).first;
+        it->second.ip = key;
+    }
+    it->second.connections++;
+    accumulate(it->second, context->counters);
+}
+
+std::vector<ClientSummary> ClientStats::snapshot() const {
+    std::unordered_map<std::string, ClientSummary> merged;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        merged = closed_;
+        
+        for (const auto& context : live_) {
+            ClientSummary& summary = merged[context->peer_ip];
+            summary.ip = context->peer_ip;
+            summary.connections++;
+            summary.active_connections++;
+            accumulate(summary, context->counters);
+        }
+    }
+    
+    std::vector<ClientSummary> result;
+    result.reserve(merged.size());
+    for (auto& entry : merged) {
+        result.push_back(std::move(entry.second));
+    }
+    std::sort(result.begin(), result.end(), [](const ClientSummary& a, const ClientSummary& b) {
+        return a.totalRequests() != b.totalRequests() ? a.totalRequests() > b.totalRequests() : a.ip < b.ip;
+    });
+    return result;
+}
+
+void ClientStats::accumulate(ClientSummary& summary, const ConnectionCounters& counters) {
+    summary.get_requests += loadRelaxed(counters.get_requests);
+    summary.post_requests += loadRelaxed(counters.post_requests);
+    summary.other_requests += loadRelaxed(counters.other_requests);
+    summary.bytes_in += loadRelaxed(counters.bytes_in);
+    summary.bytes_out += loadRelaxed(counters.bytes_out);
+    summary.response_time_ns += loadRelaxed(counters.response_time_ns);
+}
\ No newline at end of file
@@ -1,33 +1,888 @@
 #include <server/data_cache.h>
+#include <server/write_ahead_log.h>
+#include <server/cache_snapshot.h>
+#include <server/subscription_hub.h>
+#include <server/thread_pool.h>
 #include <common/logger.h>
+#include <common/string_search.h>
+#include <thread>
+#include <future>
+#include <chrono>
+#include <algorithm>
+#include <string.h>
 
-DataCache::DataCache() {
-    Logger::logMessage("DataCache initialized");
+namespace {
+    const size_t RECORD_HEADER_SIZE = sizeof(uint64_t) + sizeof(uint32_t);
+    const size_t MIN_CHUNK_SIZE = 4096;
+    const size_t MAX_CHUNK_SIZE = 1024 * 1024;
+    
+    // Payload prefix lengths covered by the two prefix indexes
+    const size_t PREFIX_INDEX_LENGTHS[2] = {DataCache::INDEXED_PREFIX_LENGTH, 8};
+    
+    // Compact a posting list once this many dead slots lead it
+    const size_t POSTINGS_COMPACT_THRESHOLD = 64;
+    
+    // Threads are numbered in first-use order and spread round-robin over
+    // the shards, so a fixed set of workers maps onto distinct shards
+    std::atomic<size_t> next_thread_index(0);
+    
+    size_t threadIndex() {
+        thread_local size_t index = next_thread_index.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+}
+
+DataCache::DataCache(size_t shard_count, size_t max_bytes, EvictionPolicy policy, int ttl_ms)
+    : shard_count_(shard_count), max_bytes_(max_bytes), policy_(policy), ttl_ms_(ttl_ms), wal_(nullptr),
+      subscriptions_(nullptr), next_seq_(1) {
+    if (shard_count_ == 0) {
+        shard_count_ = std::thread::hardware_concurrency();
+        if (shard_count_ == 0) {
+            shard_count_ = 1;
+        }
+    }
+    shards_.reset(new Shard[shard_count_]);
+    
+    // Several chunks per shard keep the memory released by one eviction small
+    shard_budget_ = max_bytes_ / shard_count_;
+    chunk_size_ = std::min(std::max(shard_budget_ / 8, MIN_CHUNK_SIZE), MAX_CHUNK_SIZE);
+    chunk_size_ = std::min(chunk_size_, shard_budget_);
+    
+    if (shard_count_ > 1) {
+        size_t cores = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        scan_pool_.reset(new ThreadPool(std::min(shard_count_ - 1, cores), shard_count_ * 4));
+    }
+    
+    Logger::logMessage("DataCache initialized with " + std::to_string(shard_count_) + " shard(s), " +
+                       std::to_string(max_bytes_) + " byte budget, " + evictionPolicyToString(policy_) +
+                       " eviction");
 }
 
 DataCache::~DataCache() {
     Logger::logMessage("DataCache destroyed");
 }
 
-void DataCache::addData(const std::string& data) {
-    std::unique_lock<std::shared_mutex> lock(mutex_);
-    data_.push_back(data);
-    Logger::logMessage("Data added to cache: " + data + " (total entries: " + std::to_string(data_.size()) + ")");
+bool DataCache::addData(std::string_view data, uint64_t* log_position) {
+    if (RECORD_HEADER_SIZE + data.size() > shard_budget_) {
+        Logger::warn("Rejected cache entry of ", data.size(), " bytes, larger than the shard budget of ",
+                     shard_budget_, " bytes");
+        return false;
+    }
+    
+    Shard& shard = shardForThisThread();
+    int64_t now_ms = nowMs();
+    uint64_t seq;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        // Taken under the shard lock so each shard's index stays sorted by seq
+        seq = beginInsert(shard, 1);
+        if (policy_ == EvictionPolicy::TTL) {
+            expireChunks(shard, now_ms);
+        }
+        insertRecord(shard, seq, data, now_ms);
+        finishInsert(shard);
+    }
+    
+    // Logged after the shard lock is released; the log batches concurrent
+    // appends itself
+    if (wal_ != nullptr) {
+        uint64_t position = wal_->append(seq, data);
+        if (log_position != nullptr) {
+            *log_position = position;
+        }
+    }
+    if (subscriptions_ != nullptr) {
+        subscriptions_->publish();
+    }
+    
+    // Formatted outside the lock, and only when debug logging is on
+    Logger::debug("Data added to cache: ", data, " (seq ", seq, ")");
+    return true;
+}
+
+bool DataCache::addBatch(const std::vector<std::string_view>& entries, uint64_t& first_seq, uint64_t& last_seq,
+                         uint64_t* log_position) {
+    size_t total_bytes = 0;
+    for (std::string_view data : entries) {
+        total_bytes += data.size();
+    }
+    if (entries.size() * RECORD_HEADER_SIZE + total_bytes > shard_budget_) {
+        Logger::warn("Rejected batch of ", entries.size(), " entries (", total_bytes,
+                     " bytes), larger than the shard budget of ", shard_budget_, " bytes");
+        return false;
+    }
+    if (entries.empty()) {
+        first_seq = next_seq_.load(std::memory_order_relaxed);
+        last_seq = first_seq - 1;
+        return true;
+    }
+    
+    Shard& shard = shardForThisThread();
+    int64_t now_ms = nowMs();
+    uint64_t batch_seq;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        // One range for the batch keeps its entries adjacent in every read
+        batch_seq = beginInsert(shard, entries.size());
+        if (policy_ == EvictionPolicy::TTL) {
+            expireChunks(shard, now_ms);
+        }
+        for (size_t i = 0; i < entries.size(); ++i) {
+            insertRecord(shard, batch_seq + i, entries[i], now_ms);
+        }
+        finishInsert(shard);
+        
+        // Chunks are evicted oldest first, so whatever was lost is a prefix
+        last_seq = batch_seq + entries.size() - 1;
+        first_seq = batch_seq;
+        while (first_seq < last_seq && findEntry(shard, first_seq) == nullptr) {
+            ++first_seq;
+        }
+    }
+    if (first_seq != batch_seq) {
+        Logger::warn("Batch of ", entries.size(), " entries did not fit the shard budget, kept seq ", first_seq,
+                     "-", last_seq);
+    }
+    
+    if (wal_ != nullptr) {
+        uint64_t position = wal_->appendBatch(batch_seq, entries);
+        if (log_position != nullptr) {
+            *log_position = position;
+        }
+    }
+    if (subscriptions_ != nullptr) {
+        subscriptions_->publish();
+    }
+    
+    Logger::debug("Batch of ", entries.size(), " entries (", total_bytes, " bytes) added to cache (seq ",
+                  batch_seq, "-", last_seq, ")");
+    return true;
+}
+
+bool DataCache::restoreEntry(uint64_t seq, std::string_view data) {
+    if (RECORD_HEADER_SIZE + data.size() > shard_budget_) {
+        Logger::warn("Skipped restored entry ", seq, " of ", data.size(),
+                     " bytes, larger than the shard budget of ", shard_budget_, " bytes");
+        return false;
+    }
+    
+    // Snapshot slices are dealt round-robin and writers use their own
+    // shard, so an entry already present may be in any of them
+    for (size_t i = 0; i < shard_count_; ++i) {
+        std::lock_guard<std::mutex> lock(shards_[i].mutex);
+        if (findEntry(shards_[i], seq) != nullptr) {
+            return false;
+        }
+    }
+    
+    Shard& shard = shards_[seq % shard_count_];
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        int64_t now_ms = nowMs();
+        if (policy_ == EvictionPolicy::TTL) {
+            expireChunks(shard, now_ms);
+        }
+        insertRecord(shard, seq, data, now_ms);
+    }
+    
+    uint64_t next = next_seq_.load(std::memory_order_relaxed);
+    while (next <= seq && !next_seq_.compare_exchange_weak(next, seq + 1, std::memory_order_relaxed)) {
+    }
+    return true;
+}
+
+void DataCache::attachWriteAheadLog(WriteAheadLog* wal) {
+    wal_ = wal;
+}
+
+void DataCache::attachSubscriptions(SubscriptionHub* hub) {
+    subscriptions_ = hub;
+}
+
+SubscriptionHub* DataCache::getSubscriptions() const {
+    return subscriptions_;
+}
+
+bool DataCache::waitDurable(uint64_t log_position) {
+    return wal_ == nullptr || wal_->waitDurable(log_position);
+}
+
+bool DataCache::pollDurable(uint64_t log_position, bool& durable) const {
+    durable = true;
+    return wal_ == nullptr || wal_->pollDurable(log_position, durable);
+}
+
+bool DataCache::watchDurable(int event_fd) {
+    if (wal_ == nullptr) {
+        return false;
+    }
+    wal_->addDurableWatcher(event_fd);
+    return true;
+}
+
+void DataCache::unwatchDurable(int event_fd) {
+    if (wal_ != nullptr) {
+        wal_->removeDurableWatcher(event_fd);
+    }
+}
+
+CacheBatch DataCache::readSince(uint64_t since, size_t limit, size_t max_bytes) const {
+    return collect(since, getCommittedSeq(), limit, max_bytes, true);
+}
+
+CacheBatch DataCache::peekSince(uint64_t since, size_t limit, size_t max_bytes) const {
+    return collect(since, getCommittedSeq(), limit, max_bytes, false);
+}
+
+CacheBatch DataCache::capture() const {
+    return collect(0, UINT64_MAX, SIZE_MAX, SIZE_MAX, false);
+}
+
+size_t DataCache::adoptSnapshot(const SnapshotImage& image) {
+    int64_t now_ms = nowMs();
+    size_t slice = 0;
+    size_t i = 0;
+    
+    while (i < image.entry_count) {
+        // Cut the region between records, at most one chunk size per slice
+        size_t begin = image.entries[i].offset - RECORD_HEADER_SIZE;
+        size_t end = image.entries[i].offset + image.entries[i].length;
+        size_t j = i + 1;
+        while (j < image.entry_count && image.entries[j].offset + image.entries[j].length - begin <= chunk_size_) {
+            end = image.entries[j].offset + image.entries[j].length;
+            j++;
+        }
+        
+        // Consecutive slices go to consecutive shards, so each shard still
+        // receives ascending sequence numbers
+        Shard& shard = shards_[slice++ % shard_count_];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        
+        // The chunk shares ownership of the whole mapping. It is full, so
+        // new records always go to a fresh heap chunk.
+        Chunk chunk;
+        chunk.data = std::shared_ptr<char[]>(image.mapping, image.records + begin);
+        chunk.capacity = end - begin;
+        chunk.used = end - begin;
+        chunk.newest_ms = now_ms;
+        chunk.min_seq = image.entries[i].seq;
+        chunk.max_seq = image.entries[j - 1].seq;
+        shard.chunks.push_back(std::move(chunk));
+        shard.allocated_bytes.fetch_add(end - begin, std::memory_order_relaxed);
+        
+        uint64_t chunk_id = shard.first_chunk_id + shard.chunks.size() - 1;
+        for (size_t k = i; k < j; ++k) {
+            const SnapshotEntry& entry = image.entries[k];
+            shard.index.push_back(IndexEntry{entry.seq, chunk_id, static_cast<uint32_t>(entry.offset - begin),
+                                             entry.length, now_ms, true, false});
+            shard.stored_bytes.fetch_add(entry.length, std::memory_order_relaxed);
+            indexPrefix(shard, entry.seq, image.records + entry.offset, entry.length);
+        }
+        shard.count.fetch_add(j - i, std::memory_order_relaxed);
+        
+        // A snapshot taken with a larger budget keeps only its newest part
+        while (shard.allocated_bytes.load(std::memory_order_relaxed) > shard_budget_) {
+            releaseOldestChunk(shard, now_ms);
+        }
+        i = j;
+    }
+    
+    if (image.entry_count > 0) {
+        uint64_t next = image.entries[image.entry_count - 1].seq + 1;
+        if (next_seq_.load(std::memory_order_relaxed) < next) {
+            next_seq_.store(next, std::memory_order_relaxed);
+        }
+    }
+    return size();
+}
+
+CacheBatch DataCache::search(SearchMode mode, std::string_view pattern, uint64_t since, size_t limit,
+                             size_t max_bytes) const {
+    std::vector<CacheBatch> runs(shard_count_);
+    uint64_t committed = getCommittedSeq();
+    
+    if (mode == SearchMode::PREFIX && pattern.size() >= INDEXED_PREFIX_LENGTH) {
+        // Lookups are cheap, so shards go one after another and each only
+        // looks below the limit-th match found so far
+        int64_t now_ms = nowMs();
+        uint64_t before = committed;
+        std::vector<uint64_t> found;
+        for (size_t i = 0; i < shard_count_; ++i) {
+            searchIndex(shards_[i], pattern, since, before, limit, now_ms, runs[i]);
+            for (const CacheBatch::Entry& entry : runs[i].entries) {
+                found.push_back(entry.seq);
+            }
+            if (limit > 0 && found.size() >= limit) {
+                std::nth_element(found.begin(), found.begin() + (limit - 1), found.end());
+                before = found[limit - 1];
+                found.resize(limit);
+            }
+        }
+        return mergeRuns(runs, since, limit, max_bytes);
+    }
+    
+    // The pool scans the other shards while this thread takes the first;
+    // a task the pool turns away runs here as well
+    std::vector<std::future<void>> pending;
+    for (size_t i = 1; i < shard_count_; ++i) {
+        auto task = std::make_shared<std::packaged_task<void()>>([&, i] {
+            scanShard(shards_[i], mode, pattern, since, committed, limit, runs[i]);
+        });
+        pending.push_back(task->get_future());
+        if (!scan_pool_->submit([task] { (*task)(); })) {
+            (*task)();
+        }
+    }
+    scanShard(shards_[0], mode, pattern, since, committed, limit, runs[0]);
+    for (auto& scan : pending) {
+        scan.wait();
+    }
+    return mergeRuns(runs, since, limit, max_bytes);
+}
+
+CacheBatch DataCache::collect(uint64_t since, uint64_t before, size_t limit, size_t max_bytes,
+                              bool mark_read) const {
+    int64_t now_ms = nowMs();
+    std::vector<CacheBatch> runs(shard_count_);
+    
+    // Shards are visited one at a time; with before at the watermark, an
+    // entry below it is found whichever shard it went to
+    for (size_t i = 0; i < shard_count_; ++i) {
+        collectShard(shards_[i], since, before, limit, max_bytes, mark_read, now_ms, runs[i]);
+    }
+    return mergeRuns(runs, since, limit, max_bytes);
+}
+
+void DataCache::collectShard(Shard& shard, uint64_t since, uint64_t before, size_t limit, size_t max_bytes,
+                             bool mark_read, int64_t now_ms, CacheBatch& run) const {
+    size_t run_bytes = 0;
+    
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = std::upper_bound(shard.index.begin(), shard.index.end(), since,
+                               [](uint64_t value, const IndexEntry& entry) { return value < entry.seq; });
+    for (; it != shard.index.end() && it->seq < before && run.entries.size() < limit && run_bytes < max_bytes;
+         ++it) {
+        IndexEntry& entry = *it;
+        if (!entry.live || isExpired(entry, now_ms)) {
+            continue;
+        }
+        
+        // Records are never modified once written, so the view stays valid
+        // without the lock as long as the chunk is referenced
+        const std::shared_ptr<char[]>& chunk = shard.chunks[entry.chunk_id - shard.first_chunk_id].data;
+        if (run.chunks.empty() || run.chunks.back().get() != chunk.get()) {
+            run.chunks.push_back(chunk);
+        }
+        run.entries.push_back(CacheBatch::Entry{entry.seq, std::string_view(chunk.get() + entry.offset, entry.length)});
+        run_bytes += entry.length;
+        entry.referenced = entry.referenced || mark_read;
+    }
+}
+
+CacheBatch DataCache::mergeRuns(std::vector<CacheBatch>& runs, uint64_t since, size_t limit, size_t max_bytes) {
+    size_t shard_count = runs.size();
+    CacheBatch batch;
+    batch.next_seq = since;
+    std::vector<size_t> positions(shard_count, 0);
+    size_t batch_bytes = 0;
+    while (batch.entries.size() < limit && batch_bytes < max_bytes) {
+        size_t best = shard_count;
+        for (size_t i = 0; i < shard_count; ++i) {
+            if (positions[i] < runs[i].entries.size() &&
+                (best == shard_count || runs[i].entries[positions[i]].seq < runs[best].entries[positions[best]].seq)) {
+                best = i;
+            }
+        }
+        if (best == shard_count) {
+            break;
+        }
+        
+        const CacheBatch::Entry& entry = runs[best].entries[positions[best]++];
+        batch.entries.push_back(entry);
+        batch.next_seq = entry.seq;
+        batch_bytes += entry.data.size();
+    }
+    
+    for (CacheBatch& run : runs) {
+        for (auto& chunk : run.chunks) {
+            batch.chunks.push_back(std::move(chunk));
+        }
+    }
+    return batch;
 }
 
 std::vector<std::string> DataCache::getData() const {
-    std::shared_lock<std::shared_mutex> lock(mutex_);
-    return data_;
+    CacheBatch batch = readSince(0, SIZE_MAX);
+    
+    std::vector<std::string> result;
+    result.reserve(batch.entries.size());
+    for (const CacheBatch::Entry& entry : batch.entries) {
+        result.emplace_back(entry.data);
+    }
+    return result;
+}
+
+uint64_t DataCache::getNextSeq() const {
+    return next_seq_.load();
+}
+
+uint64_t DataCache::getCommittedSeq() const {
+    // Read before the shards: a number taken before this load was announced
+    // before it was taken, so it is seen below unless already stored
+    uint64_t committed = next_seq_.load();
+    for (size_t i = 0; i < shard_count_; ++i) {
+        committed = std::min(committed, shards_[i].inserting.load());
+    }
+    return committed;
 }
 
 size_t DataCache::size() const {
-    std::shared_lock<std::shared_mutex> lock(mutex_);
-    return data_.size();
+    return sumCounters(&Shard::count);
 }
 
 void DataCache::clear() {
-    std::unique_lock<std::shared_mutex> lock(mutex_);
-    size_t prev_size = data_.size();
-    data_.clear();
+    size_t prev_size = 0;
+    for (size_t i = 0; i < shard_count_; ++i) {
+        Shard& shard = shards_[i];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        prev_size += shard.count.load(std::memory_order_relaxed);
+        shard.first_chunk_id += shard.chunks.size();
+        shard.chunks.clear();
+        shard.index.clear();
+        shard.prefix_index[0].clear();
+        shard.prefix_index[1].clear();
+        shard.count.store(0, std::memory_order_relaxed);
+        shard.stored_bytes.store(0, std::memory_order_relaxed);
+        shard.allocated_bytes.store(0, std::memory_order_relaxed);
+    }
     Logger::logMessage("Cache cleared, removed " + std::to_string(prev_size) + " entries");
-} 
\ No newline at end of file
+}
+
+size_t DataCache::getShardCount() const {
+    return shard_count_;
+}
+
+EvictionPolicy DataCache::getEvictionPolicy() const {
+    return policy_;
+}
+
+size_t DataCache::getMaxBytes() const {
+    return max_bytes_;
+}
+
+size_t DataCache::getMemoryUsage() const {
+    return sumCounters(&Shard::allocated_bytes);
+}
+
+size_t DataCache::getStoredBytes() const {
+    return sumCounters(&Shard::stored_bytes);
+}
+
+size_t DataCache::getEvictedEntries() const {
+    return sumCounters(&Shard::evicted);
+}
+
+size_t DataCache::getExpiredEntries() const {
+    return sumCounters(&Shard::expired);
+}
+
+bool DataCache::parseEvictionPolicy(const std::string& name, EvictionPolicy& policy) {
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    
+    if (lower == "fifo") {
+        policy = EvictionPolicy::FIFO;
+    } else if (lower == "lru") {
+        policy = EvictionPolicy::LRU;
+    } else if (lower == "ttl") {
+        policy = EvictionPolicy::TTL;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* DataCache::evictionPolicyToString(EvictionPolicy policy) {
+    switch (policy) {
+        case EvictionPolicy::FIFO:
+            return "fifo";
+        case EvictionPolicy::LRU:
+            return "lru";
+        case EvictionPolicy::TTL:
+            return "ttl";
+        default:
+            return "unknown";
+    }
+}
+
+size_t DataCache::sumCounters(std::atomic<size_t> Shard::*counter) const {
+    size_t total = 0;
+    for (size_t i = 0; i < shard_count_; ++i) {
+        total += (shards_[i].*counter).load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+DataCache::Shard& DataCache::shardForThisThread() {
+    return shards_[threadIndex() % shard_count_];
+}
+
+uint64_t DataCache::beginInsert(Shard& shard, size_t count) {
+    // next_seq_ only grows, so the numbers taken next are at least this
+    shard.inserting.store(next_seq_.load());
+    return next_seq_.fetch_add(count);
+}
+
+void DataCache::finishInsert(Shard& shard) {
+    shard.inserting.store(UINT64_MAX);
+}
+
+void DataCache::insertRecord(Shard& shard, uint64_t seq, std::string_view data, int64_t now_ms) {
+    size_t record_size = RECORD_HEADER_SIZE + data.size();
+    
+    // Free whole chunks from the old end until the record fits the budget
+    while (!shard.chunks.empty() && !fitsBudget(shard, record_size)) {
+        releaseOldestChunk(shard, now_ms);
+    }
+    
+    // New entries always go last; restored ones may arrive slightly out of order
+    IndexEntry entry{seq, 0, 0, static_cast<uint32_t>(data.size()), now_ms, true, false};
+    auto it = shard.index.end();
+    if (!shard.index.empty() && shard.index.back().seq > seq) {
+        it = std::upper_bound(shard.index.begin(), shard.index.end(), seq,
+                              [](uint64_t value, const IndexEntry& e) { return value < e.seq; });
+    }
+    it = shard.index.insert(it, entry);
+    appendRecord(shard, *it, data.data());
+    indexPrefix(shard, seq, data.data(), data.size());
+    
+    shard.count.fetch_add(1, std::memory_order_relaxed);
+    shard.stored_bytes.fetch_add(data.size(), std::memory_order_relaxed);
+}
+
+bool DataCache::fitsBudget(const Shard& shard, size_t record_size) const {
+    const Chunk& newest = shard.chunks.back();
+    size_t needed = newest.capacity - newest.used >= record_size ? 0 : std::max(chunk_size_, record_size);
+    return shard.allocated_bytes.load(std::memory_order_relaxed) + needed <= shard_budget_;
+}
+
+void DataCache::appendRecord(Shard& shard, IndexEntry& entry, const char* payload) {
+    size_t record_size = RECORD_HEADER_SIZE + entry.length;
+    if (shard.chunks.empty() || shard.chunks.back().capacity - shard.chunks.back().used < record_size) {
+        Chunk chunk;
+        chunk.capacity = std::max(chunk_size_, record_size);
+        chunk.data.reset(new char[chunk.capacity]);
+        shard.chunks.push_back(std::move(chunk));
+        shard.allocated_bytes.fetch_add(shard.chunks.back().capacity, std::memory_order_relaxed);
+    }
+    
+    Chunk& chunk = shard.chunks.back();
+    char* record = chunk.data.get() + chunk.used;
+    memcpy(record, &entry.seq, sizeof(entry.seq));
+    memcpy(record + sizeof(entry.seq), &entry.length, sizeof(entry.length));
+    memcpy(record + RECORD_HEADER_SIZE, payload, entry.length);
+    
+    entry.chunk_id = shard.first_chunk_id + shard.chunks.size() - 1;
+    entry.offset = static_cast<uint32_t>(chunk.used + RECORD_HEADER_SIZE);
+    chunk.used += record_size;
+    chunk.newest_ms = std::max(chunk.newest_ms, entry.inserted_ms);
+    chunk.ordered = chunk.ordered && entry.seq > chunk.max_seq;
+    chunk.min_seq = std::min(chunk.min_seq, entry.seq);
+    chunk.max_seq = std::max(chunk.max_seq, entry.seq);
+}
+
+void DataCache::releaseOldestChunk(Shard& shard, int64_t now_ms) {
+    // Deque references stay valid while relocated records are appended at the back
+    Chunk& oldest = shard.chunks.front();
+    uint64_t oldest_id = shard.first_chunk_id;
+    bool can_relocate = policy_ == EvictionPolicy::LRU && shard.chunks.size() > 1;
+    
+    size_t pos = 0;
+    while (pos < oldest.used) {
+        uint64_t seq;
+        uint32_t length;
+        memcpy(&seq, oldest.data.get() + pos, sizeof(seq));
+        memcpy(&length, oldest.data.get() + pos + sizeof(seq), sizeof(length));
+        
+        IndexEntry* entry = findEntry(shard, seq);
+        if (entry != nullptr && entry->live && entry->chunk_id == oldest_id) {
+            bool expired = isExpired(*entry, now_ms);
+            if (!expired && can_relocate && entry->referenced && fitsBudget(shard, RECORD_HEADER_SIZE + length)) {
+                // Second chance: recently read entries move to the newest chunk
+                entry->referenced = false;
+                appendRecord(shard, *entry, oldest.data.get() + pos + RECORD_HEADER_SIZE);
+            } else {
+                entry->live = false;
+                unindexPrefix(shard, oldest.data.get() + pos + RECORD_HEADER_SIZE, length);
+                shard.count.fetch_sub(1, std::memory_order_relaxed);
+                shard.stored_bytes.fetch_sub(length, std::memory_order_relaxed);
+                (expired ? shard.expired : shard.evicted).fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        pos += RECORD_HEADER_SIZE + length;
+    }
+    
+    shard.allocated_bytes.fetch_sub(oldest.capacity, std::memory_order_relaxed);
+    shard.chunks.pop_front();
+    shard.first_chunk_id++;
+    trimIndex(shard);
+}
+
+void DataCache::searchIndex(Shard& shard, std::string_view prefix, uint64_t since, uint64_t before, size_t limit,
+                            int64_t now_ms, CacheBatch& run) const {
+    // Use the longest indexed prefix the pattern covers
+    size_t level = prefix.size() >= PREFIX_INDEX_LENGTHS[1] ? 1 : 0;
+    uint64_t key;
+    prefixKey(prefix.data(), prefix.size(), level, key);
+    
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto postings = shard.prefix_index[level].find(key);
+    if (postings == shard.prefix_index[level].end()) {
+        return;
+    }
+    
+    const std::vector<uint64_t>& seqs = postings->second.seqs;
+    auto it = std::upper_bound(seqs.begin() + postings->second.head, seqs.end(), since);
+    for (; it != seqs.end() && *it < before && run.entries.size() < limit; ++it) {
+        IndexEntry* entry = findEntry(shard, *it);
+        if (entry == nullptr || !entry->live || isExpired(*entry, now_ms)) {
+            continue;
+        }
+        
+        const std::shared_ptr<char[]>& chunk = shard.chunks[entry->chunk_id - shard.first_chunk_id].data;
+        std::string_view data(chunk.get() + entry->offset, entry->length);
+        if (data.compare(0, prefix.size(), prefix) != 0) {
+            continue;
+        }
+        if (run.chunks.empty() || run.chunks.back().get() != chunk.get()) {
+            run.chunks.push_back(chunk);
+        }
+        run.entries.push_back(CacheBatch::Entry{entry->seq, data});
+    }
+}
+
+void DataCache::scanShard(Shard& shard, SearchMode mode, std::string_view pattern, uint64_t since, uint64_t before,
+                          size_t limit, CacheBatch& run) const {
+    uint64_t chunk_id = 0;
+    if (limit == 0) {
+        return;
+    }
+    
+    // One chunk per lock hold keeps writers to this shard waiting briefly
+    while (true) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        chunk_id = std::max(chunk_id, shard.first_chunk_id);
+        if (chunk_id >= shard.first_chunk_id + shard.chunks.size()) {
+            break;
+        }
+        
+        // Chunks that cannot hold an entry in (since, before) are skipped
+        // without being read. Chunks fill in sequence order, so once limit
+        // matches are found only chunks with relocated entries remain.
+        const Chunk& chunk = shard.chunks[chunk_id - shard.first_chunk_id];
+        if (chunk.max_seq > since && chunk.min_seq < before) {
+            scanChunk(shard, chunk_id, mode, pattern, since, before, limit, nowMs(), run);
+            
+            if (run.entries.size() >= limit) {
+                auto by_seq = [](const CacheBatch::Entry& a, const CacheBatch::Entry& b) { return a.seq < b.seq; };
+                std::nth_element(run.entries.begin(), run.entries.begin() + (limit - 1), run.entries.end(), by_seq);
+                before = run.entries[limit - 1].seq;
+                run.entries.resize(limit);
+            }
+        }
+        chunk_id++;
+    }
+    
+    std::sort(run.entries.begin(), run.entries.end(),
+              [](const CacheBatch::Entry& a, const CacheBatch::Entry& b) { return a.seq < b.seq; });
+}
+
+void DataCache::scanChunk(Shard& shard, uint64_t chunk_id, SearchMode mode, std::string_view pattern,
+                          uint64_t since, uint64_t before, size_t limit, int64_t now_ms, CacheBatch& run) const {
+    const Chunk& chunk = shard.chunks[chunk_id - shard.first_chunk_id];
+    const char* base = chunk.data.get();
+    size_t matched_before = run.entries.size();
+    size_t record = 0;
+    size_t pos = 0;
+    
+    while (pos < chunk.used) {
+        if (mode == SearchMode::CONTAINS) {
+            // Search the raw chunk bytes, then find the record the hit falls in
+            size_t hit = findSubstring(std::string_view(base + pos, chunk.used - pos), pattern);
+            if (hit == std::string_view::npos) {
+                break;
+            }
+            hit += pos;
+            
+            uint32_t length;
+            while (true) {
+                memcpy(&length, base + record + sizeof(uint64_t), sizeof(length));
+                if (record + RECORD_HEADER_SIZE + length > hit) {
+                    break;
+                }
+                record += RECORD_HEADER_SIZE + length;
+            }
+            if (hit < record + RECORD_HEADER_SIZE || hit + pattern.size() > record + RECORD_HEADER_SIZE + length) {
+                // The hit straddles a record header
+                pos = hit + 1;
+                continue;
+            }
+        }
+        
+        uint64_t seq;
+        uint32_t length;
+        memcpy(&seq, base + record, sizeof(seq));
+        memcpy(&length, base + record + sizeof(seq), sizeof(length));
+        size_t offset = record + RECORD_HEADER_SIZE;
+        record = offset + length;
+        pos = record;
+        
+        if (seq <= since || seq >= before) {
+            continue;
+        }
+        if (mode == SearchMode::PREFIX && std::string_view(base + offset, length).compare(0, pattern.size(), pattern) != 0) {
+            continue;
+        }
+        
+        // Skip dead records and stale copies left behind by relocation
+        const IndexEntry* entry = findEntry(shard, seq);
+        if (entry == nullptr || !entry->live || entry->chunk_id != chunk_id || entry->offset != offset ||
+            isExpired(*entry, now_ms)) {
+            continue;
+        }
+        run.entries.push_back(CacheBatch::Entry{seq, std::string_view(base + offset, length)});
+        
+        // Later records of an ordered chunk can only have larger sequence
+        // numbers than the limit matches it already produced
+        if (chunk.ordered && run.entries.size() - matched_before >= limit) {
+            break;
+        }
+    }
+    
+    if (run.entries.size() > matched_before) {
+        run.chunks.push_back(chunk.data);
+    }
+}
+
+void DataCache::indexPrefix(Shard& shard, uint64_t seq, const char* payload, size_t length) {
+    for (size_t level = 0; level < 2; ++level) {
+        uint64_t key;
+        if (!prefixKey(payload, length, level, key)) {
+            break;
+        }
+        
+        // New entries always go last; restored ones may arrive slightly out of order
+        std::vector<uint64_t>& seqs = shard.prefix_index[level][key].seqs;
+        if (seqs.empty() || seqs.back() < seq) {
+            seqs.push_back(seq);
+        } else {
+            seqs.insert(std::upper_bound(seqs.begin(), seqs.end(), seq), seq);
+        }
+    }
+}
+
+void DataCache::unindexPrefix(Shard& shard, const char* payload, size_t length) {
+    for (size_t level = 0; level < 2; ++level) {
+        uint64_t key;
+        if (!prefixKey(payload, length, level, key)) {
+            break;
+        }
+        auto it = shard.prefix_index[level].find(key);
+        if (it == shard.prefix_index[level].end()) {
+            continue;
+        }
+        
+        Postings& postings = it->second;
+        while (postings.head < postings.seqs.size()) {
+            const IndexEntry* entry = findEntry(shard, postings.seqs[postings.head]);
+            if (entry != nullptr && entry->live) {
+                break;
+            }
+            postings.head++;
+        }
+        
+        if (postings.head == postings.seqs.size()) {
+            shard.prefix_index[level].erase(it);
+        } else if (postings.head >= POSTINGS_COMPACT_THRESHOLD && postings.head * 2 >= postings.seqs.size()) {
+            postings.seqs.erase(postings.seqs.begin(), postings.seqs.begin() + postings.head);
+            postings.head = 0;
+        }
+    }
+}
+
+bool DataCache::prefixKey(const char* payload, size_t length, size_t level, uint64_t& key) {
+    size_t prefix_length = PREFIX_INDEX_LENGTHS[level];
+    if (length < prefix_length) {
+        return false;
+    }
+    
+    // Big-endian packing keeps keys of one level distinct
+    key = 0;
+    for (size_t i = 0; i < prefix_length; ++i) {
+        key = key << 8 | static_cast<unsigned char>(payload[i]);
+    }
+    return true;
+}
+
+void DataCache::expireChunks(Shard& shard, int64_t now_ms) {
+    while (ttl_ms_ > 0 && !shard.chunks.empty() && shard.chunks.front().newest_ms + ttl_ms_ <= now_ms) {
+        releaseOldestChunk(shard, now_ms);
+    }
+}
+
+void DataCache::trimIndex(Shard& shard) {
+    while (!shard.index.empty() && !shard.index.front().live) {
+        shard.index.pop_front();
+    }
+}
+
+DataCache::IndexEntry* DataCache::findEntry(Shard& shard, uint64_t seq) const {
+    std::deque<IndexEntry>& index = shard.index;
+    if (index.empty() || seq < index.front().seq || seq > index.back().seq) {
+        return nullptr;
+    }
+    
+    // A shard's sequence numbers are close to evenly spaced, so interpolate
+    // a starting point and gallop from it to bracket the entry
+    size_t size = index.size();
+    uint64_t first = index.front().seq;
+    uint64_t span = index.back().seq - first;
+    size_t guess = span == 0 ? 0 : static_cast<size_t>(static_cast<double>(seq - first) / span * (size - 1));
+    size_t lo = 0;
+    size_t hi = size;
+    if (index[guess].seq < seq) {
+        lo = guess + 1;
+        for (size_t step = 1; guess + step < size; step *= 2) {
+            if (index[guess + step].seq >= seq) {
+                hi = guess + step + 1;
+                break;
+            }
+            lo = guess + step + 1;
+        }
+    } else {
+        hi = guess + 1;
+        for (size_t step = 1; step <= guess; step *= 2) {
+            if (index[guess - step].seq < seq) {
+                lo = guess - step + 1;
+                break;
+            }
+            hi = guess - step + 1;
+        }
+    }
+    
+    auto it = std::lower_bound(index.begin() + lo, index.begin() + hi, seq,
+                               [](const IndexEntry& entry, uint64_t value) { return entry.seq < value; });
+    if (it == index.begin() + hi || it->seq != seq) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+bool DataCache::isExpired(const IndexEntry& entry, int64_t now_ms) const {
+    return policy_ == EvictionPolicy::TTL && ttl_ms_ > 0 && entry.inserted_ms + ttl_ms_ <= now_ms;
+}
+
+int64_t DataCache::nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
\ No newline at end of file
@@ -0,0 +1,383 @@
+#include <server/event_reactor.h>
+#include <common/logger.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <iostream>
+#include <vector>
+
+namespace {
+    const int MAX_EVENTS = 128;
+    const int EPOLL_TIMEOUT_MS = 100;
+    const int IDLE_SWEEP_INTERVAL_MS = 1000;
+}
+
+EventReactor::EventReactor(int listen_socket, size_t listener, DataCache& cache, ClientStats& stats,
+                           ServerMetrics& metrics, AdmissionControl& admission, std::atomic<bool>& server_running,
+                           std::atomic<size_t>& active_connections, const ServerConfig& config)
+    : listen_socket_(listen_socket), listener_(listener), epoll_fd_(-1), cache_(cache), stats_(stats), metrics_(metrics),
+      admission_(admission), server_running_(server_running), active_connections_(active_connections),
+      config_(config), durable_fd_(-1), last_idle_sweep_(std::chrono::steady_clock::now()) {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ == -1) {
+        Logger::logError("epoll_create1 failed: " + std::string(strerror(errno)));
+        return;
+    }
+    
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = listen_socket_;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_socket_, &ev) == -1) {
+        Logger::logError("epoll_ctl failed for listening socket: " + std::string(strerror(errno)));
+    }
+    
+    // Without the wake-up, handlers block until their entries are durable
+    durable_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ev.data.fd = durable_fd_;
+    if (durable_fd_ != -1 && (!cache_.watchDurable(durable_fd_) ||
+                              epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, durable_fd_, &ev) == -1)) {
+        cache_.unwatchDurable(durable_fd_);
+        close(durable_fd_);
+        durable_fd_ = -1;
+    }
+}
+
+EventReactor::~EventReactor() {
+    while (!connections_.empty()) {
+        closeConnection(connections_.begin()->first);
+    }
+    if (durable_fd_ != -1) {
+        cache_.unwatchDurable(durable_fd_);
+        close(durable_fd_);
+    }
+    if (epoll_fd_ != -1) {
+        close(epoll_fd_);
+    }
+}
+
+void EventReactor::run() {
+    if (epoll_fd_ == -1) {
+        return;
+    }
+    
+    struct epoll_event events[MAX_EVENTS];
+    
+    while (server_running_) {
+        int ready = epoll_wait(epoll_fd_, events, MAX_EVENTS, EPOLL_TIMEOUT_MS);
+        if (ready == -1) {
+            if (errno != EINTR) {
+                Logger::logError("epoll_wait failed: " + std::string(strerror(errno)));
+                break;
+            }
+            continue;
+        }
+        
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+            
+            if (fd == listen_socket_) {
+                acceptPending();
+                continue;
+            }
+            if (fd == durable_fd_) {
+                resumeSyncing();
+                continue;
+            }
+            
+            // New entries for a subscribed connection: nothing to read, but
+            // its frames are queued once the output has drained
+            uint32_t socket_events = events[i].events;
+            auto wakeup = stream_wakeups_.find(fd);
+            if (wakeup != stream_wakeups_.end()) {
+                fd = wakeup->second;
+                socket_events = 0;
+            }
+            
+            auto it = connections_.find(fd);
+            if (it == connections_.end()) {
+                continue;
+            }
+            Connection& conn = it->second;
+            
+            if (socket_events & (EPOLLERR | EPOLLHUP)) {
+                closeConnection(fd);
+                continue;
+            }
+            service(fd, conn, (socket_events & (EPOLLIN | EPOLLRDHUP)) != 0);
+        }
+        
+        closeIdleConnections();
+    }
+}
+
+void EventReactor::acceptPending() {
+    while (true) {
+        struct sockaddr_storage client_addr;
+        socklen_t addr_len = sizeof(client_addr);
+        
+        int client_socket = accept4(listen_socket_, (struct sockaddr*)&client_addr, &addr_len,
+                                    SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_socket == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK && server_running_) {
+                Logger::logError("accept failed: " + std::string(strerror(errno)));
+            }
+            return;
+        }
+        
+        metrics_.recordAccepted(listener_);
+        std::shared_ptr<PeerBudget> budget;
+        if (!admission_.admitConnection(client_socket, client_addr, active_connections_.load(), budget)) {
+            continue;
+        }
+        
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = client_socket;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, client_socket, &ev) == -1) {
+            Logger::logError("epoll_ctl failed for client socket: " + std::string(strerror(errno)));
+            close(client_socket);
+            continue;
+        }
+        
+        Connection& conn = connections_.emplace(client_socket, Connection(config_.max_message_size)).first->second;
+        auto context = std::make_shared<ConnectionContext>(client_socket, client_addr);
+        context->budget = std::move(budget);
+        conn.handler.reset(new ClientHandler(context, cache_, stats_, metrics_, server_running_, config_));
+        if (durable_fd_ != -1) {
+            conn.handler->deferAcks();
+        }
+        conn.last_activity = std::chrono::steady_clock::now();
+        active_connections_++;
+        
+        if (Logger::isEnabled(LogLevel::INFO)) {
+            std::string conn_msg = "New connection from " + conn.handler->getClientIP();
+            Logger::logMessage(conn_msg);
+            std::cout << conn_msg << std::endl;
+        }
+    }
+}
+
+void EventReactor::service(int fd, Connection& conn, bool readable) {
+    // A full input buffer stops reading before EAGAIN, so no new edge will
+    // arrive for the rest; read again whenever parsing frees space
+    bool try_read = readable || conn.read_blocked;
+    while (true) {
+        if (try_read) {
+            handleReadable(fd, conn);
+        }
+        size_t buffered = conn.input.size();
+        advance(fd, conn);
+        
+        try_read = conn.read_blocked && conn.state != ConnectionState::CLOSING &&
+                   conn.input.size() < buffered;
+        if (!try_read) {
+            break;
+        }
+    }
+    
+    if (conn.state == ConnectionState::CLOSING && conn.output.empty()) {
+        closeConnection(fd);
+    }
+}
+
+void EventReactor::resumeSyncing() {
+    uint64_t count;
+    while (read(durable_fd_, &count, sizeof(count)) == -1 && errno == EINTR) {
+    }
+    
+    // Serving a connection may park it again, so walk a copy
+    std::vector<int> syncing(syncing_.begin(), syncing_.end());
+    for (int fd : syncing) {
+        auto it = connections_.find(fd);
+        if (it == connections_.end()) {
+            continue;
+        }
+        Connection& conn = it->second;
+        bool keep_open = conn.state != ConnectionState::CLOSING;
+        if (!conn.handler->acksDurable(conn.output, keep_open)) {
+            continue;
+        }
+        
+        conn.syncing = false;
+        syncing_.erase(fd);
+        if (!keep_open) {
+            conn.state = ConnectionState::CLOSING;
+        }
+        service(fd, conn, false);
+    }
+}
+
+void EventReactor::handleReadable(int fd, Connection& conn) {
+    conn.read_blocked = false;
+    
+    // Edge-triggered: keep reading until the kernel buffer is drained
+    while (true) {
+        ssize_t bytes_received = conn.input.readFrom(fd);
+        if (bytes_received > 0) {
+            conn.last_activity = std::chrono::steady_clock::now();
+            conn.handler->markReceived();
+        } else if (bytes_received == 0) {
+            conn.peer_closed = true;
+            return;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return;
+        } else if (errno == EMSGSIZE) {
+            conn.read_blocked = true;
+            return;
+        } else {
+            Logger::logError("recv failed for client " + conn.handler->getClientIP());
+            conn.state = ConnectionState::CLOSING;
+            conn.output.clear();
+            return;
+        }
+    }
+}
+
+void EventReactor::handleParse(int fd, Connection& conn) {
+    bool keep_open = conn.handler->processInput(conn.input, conn.output);
+    bool durable = conn.handler->acksDurable(conn.output, keep_open);
+    
+    if (!keep_open) {
+        conn.state = ConnectionState::CLOSING;
+    } else if (!conn.output.empty()) {
+        conn.state = ConnectionState::WRITING;
+    } else {
+        conn.state = ConnectionState::READING;
+    }
+    
+    if (keep_open && conn.wake_fd == -1 && conn.handler->isSubscribed()) {
+        watchSubscription(fd, conn);
+    }
+    
+    // The log signals every advance after the check above, so a parked
+    // connection is woken by the one that makes its entries durable
+    if (!durable) {
+        conn.syncing = true;
+        syncing_.insert(fd);
+    }
+}
+
+void EventReactor::watchSubscription(int fd, Connection& conn) {
+    int wake_fd = conn.handler->getSubscriptionFd();
+    
+    // Frames queued before this still raise an event: the eventfd is readable
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = wake_fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd, &ev) == -1) {
+        Logger::logError("epoll_ctl failed for subscription: " + std::string(strerror(errno)));
+        conn.state = ConnectionState::CLOSING;
+        return;
+    }
+    conn.wake_fd = wake_fd;
+    stream_wakeups_[wake_fd] = fd;
+}
+
+void EventReactor::handleWritable(int fd, Connection& conn) {
+    size_t total = conn.output.size();
+    
+    while (!conn.output.empty()) {
+        ssize_t bytes_sent = conn.output.writeTo(fd);
+        if (bytes_sent > 0) {
+            conn.last_activity = std::chrono::steady_clock::now();
+        } else if (bytes_sent == -1 && errno == EINTR) {
+            continue;
+        } else if (bytes_sent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // Wait for the next EPOLLOUT edge
+            return;
+        } else {
+            Logger::logError("Failed to send response to client " + conn.handler->getClientIP());
+            conn.state = ConnectionState::CLOSING;
+            conn.output.clear();
+            return;
+        }
+    }
+    
+    Logger::debug("Response sent to ", conn.handler->getClientIP(), " (", total, " bytes)");
+    conn.handler->responsesSent();
+    if (conn.state == ConnectionState::WRITING) {
+        conn.state = ConnectionState::READING;
+    }
+}
+
+void EventReactor::advance(int fd, Connection& conn) {
+    // Nothing is sent or parsed until the held output may go
+    if (conn.syncing) {
+        return;
+    }
+    
+    while (true) {
+        if (!conn.output.empty()) {
+            handleWritable(fd, conn);
+            if (!conn.output.empty()) {
+                return;
+            }
+        }
+        
+        if (conn.state == ConnectionState::CLOSING) {
+            return;
+        }
+        
+        // Output is drained: parse whatever complete requests are buffered
+        handleParse(fd, conn);
+        if (conn.output.empty()) {
+            if (conn.peer_closed) {
+                Logger::debug("Client ", conn.handler->getClientIP(), " disconnected");
+                conn.state = ConnectionState::CLOSING;
+            }
+            return;
+        }
+    }
+}
+
+void EventReactor::closeIdleConnections() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_idle_sweep_ < std::chrono::milliseconds(IDLE_SWEEP_INTERVAL_MS)) {
+        return;
+    }
+    last_idle_sweep_ = now;
+    
+    auto timeout = std::chrono::milliseconds(config_.idle_timeout_ms);
+    for (auto it = connections_.begin(); it != connections_.end();) {
+        int fd = it->first;
+        Connection& conn = it->second;
+        ++it;
+        
+        if (now - conn.last_activity >= timeout && !conn.handler->isSubscribed()) {
+            Logger::logMessage("Closing idle connection from " + conn.handler->getClientIP());
+            closeConnection(fd);
+        }
+    }
+}
+
+void EventReactor::closeConnection(int fd) {
+    auto it = connections_.find(fd);
+    if (it == connections_.end()) {
+        return;
+    }
+    
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    syncing_.erase(fd);
+    if (it->second.wake_fd != -1) {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, it->second.wake_fd, nullptr);
+        stream_wakeups_.erase(it->second.wake_fd);
+    }
+    // ClientHandler owns the socket and closes it on destruction
+    connections_.erase(it);
+    
+    active_connections_--;
+    Logger::debug("Client handler finished, active connections: ", active_connections_.load());
+}
\ No newline at end of file
@@ -0,0 +1,184 @@
+#include <server/idle_poller.h>
+#include <common/logger.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+    const int MAX_EVENTS = 128;
+    const int IDLE_SWEEP_INTERVAL_MS = 1000;
+}
+
+IdlePoller::IdlePoller(int idle_timeout_ms, std::atomic<size_t>& active_connections, Resume resume)
+    : epoll_fd_(-1), wake_fd_(-1), idle_timeout_ms_(idle_timeout_ms), active_connections_(active_connections),
+      resume_(std::move(resume)), stopped_(false) {
+}
+
+IdlePoller::~IdlePoller() {
+    stop();
+    if (wake_fd_ != -1) {
+        close(wake_fd_);
+    }
+    if (epoll_fd_ != -1) {
+        close(epoll_fd_);
+    }
+}
+
+bool IdlePoller::start() {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epoll_fd_ == -1 || wake_fd_ == -1) {
+        Logger::logError("Failed to create the idle connection poller: " + std::string(strerror(errno)));
+        return false;
+    }
+    
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = wake_fd_;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event) == -1) {
+        Logger::logError("Failed to watch the idle poller eventfd: " + std::string(strerror(errno)));
+        return false;
+    }
+    
+    thread_ = std::thread(&IdlePoller::run, this);
+    return true;
+}
+
+void IdlePoller::park(std::shared_ptr<ClientHandler> handler) {
+    int socket = handler->getSocket();
+    int wake_fd = handler->getSubscriptionFd();
+    
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!stopped_ && epoll_fd_ != -1) {
+        if (arm(socket, socket) && (wake_fd == -1 || arm(wake_fd, socket))) {
+            parked_[socket] = Parked{std::move(handler), std::chrono::steady_clock::now()};
+            return;
+        }
+        Logger::logError("Failed to park connection from " + handler->getClientIP() + ": " + strerror(errno));
+    }
+    lock.unlock();
+    
+    // ClientHandler owns the socket and closes it on destruction, which
+    // also takes it out of the epoll set
+    handler.reset();
+    active_connections_--;
+}
+
+void IdlePoller::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+    }
+    if (thread_.joinable()) {
+        uint64_t one = 1;
+        while (write(wake_fd_, &one, sizeof(one)) == -1 && errno == EINTR) {
+        }
+        thread_.join();
+    }
+    
+    std::unordered_map<int, Parked> parked;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& entry : parked_) {
+            unwatch(*entry.second.handler);
+        }
+        parked.swap(parked_);
+    }
+    size_t closed = parked.size();
+    parked.clear();
+    active_connections_ -= closed;
+}
+
+size_t IdlePoller::getParkedConnections() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return parked_.size();
+}
+
+void IdlePoller::run() {
+    struct epoll_event events[MAX_EVENTS];
+    auto last_sweep = std::chrono::steady_clock::now();
+    std::vector<std::shared_ptr<ClientHandler>> ready;
+    
+    while (true) {
+        int count = epoll_wait(epoll_fd_, events, MAX_EVENTS, IDLE_SWEEP_INTERVAL_MS);
+        if (count == -1 && errno != EINTR) {
+            Logger::logError("epoll_wait failed in the idle poller: " + std::string(strerror(errno)));
+            break;
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopped_) {
+                break;
+            }
+            
+            // Both descriptors of a connection can be in one batch. The one
+            // that fired is disarmed; the other may fire once while the
+            // connection is served, and is skipped then.
+            for (int i = 0; i < count; ++i) {
+                auto it = parked_.find(events[i].data.fd);
+                if (it == parked_.end()) {
+                    continue;
+                }
+                ready.push_back(std::move(it->second.handler));
+                parked_.erase(it);
+            }
+        }
+        
+        for (std::shared_ptr<ClientHandler>& handler : ready) {
+            resume_(std::move(handler));
+        }
+        ready.clear();
+        
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_sweep >= std::chrono::milliseconds(IDLE_SWEEP_INTERVAL_MS)) {
+            last_sweep = now;
+            closeIdle(now);
+        }
+    }
+}
+
+void IdlePoller::closeIdle(std::chrono::steady_clock::time_point now) {
+    auto timeout = std::chrono::milliseconds(idle_timeout_ms_);
+    std::vector<std::shared_ptr<ClientHandler>> idle;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = parked_.begin(); it != parked_.end();) {
+            const ClientHandler& handler = *it->second.handler;
+            if (now - it->second.since >= timeout && !handler.isSubscribed()) {
+                Logger::logMessage("Closing idle connection from " + handler.getClientIP());
+                unwatch(handler);
+                idle.push_back(std::move(it->second.handler));
+                it = parked_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    
+    // Closed outside the lock, so workers parking connections do not wait
+    size_t closed = idle.size();
+    idle.clear();
+    active_connections_ -= closed;
+}
+
+bool IdlePoller::arm(int fd, int socket) {
+    // Both descriptors report the socket, the key of the connection
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    event.data.fd = socket;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event) == 0) {
+        return true;
+    }
+    return errno == ENOENT && epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+void IdlePoller::unwatch(const ClientHandler& handler) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, handler.getSocket(), nullptr);
+    if (handler.getSubscriptionFd() != -1) {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, handler.getSubscriptionFd(), nullptr);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,597 @@
+#include <server/io_uring_reactor.h>
+#include <common/logger.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <iostream>
+
+namespace {
+    const unsigned SUBMISSION_ENTRIES = 256;
+    
+    // Multishot requests post many completions each; a larger completion
+    // queue keeps a busy batch from overflowing it
+    const unsigned COMPLETION_ENTRIES = 4096;
+    
+    // Receive buffers the kernel picks from; the count must be a power of two
+    const unsigned RECV_BUFFER_COUNT = 256;
+    const size_t RECV_BUFFER_SIZE = 16 * 1024;
+    const uint16_t RECV_BUFFER_GROUP = 0;
+    
+    const int WAIT_TIMEOUT_MS = 100;
+    const int IDLE_SWEEP_INTERVAL_MS = 1000;
+    
+    // How long shutdown waits for cancelled requests to complete
+    const int DRAIN_TIMEOUT_MS = 1000;
+    
+    uint64_t userData(int fd, uint8_t operation) {
+        return (static_cast<uint64_t>(fd) << 8) | operation;
+    }
+    
+    struct __kernel_timespec toTimespec(int milliseconds) {
+        struct __kernel_timespec ts;
+        ts.tv_sec = milliseconds / 1000;
+        ts.tv_nsec = static_cast<long long>(milliseconds % 1000) * 1000000;
+        return ts;
+    }
+}
+
+IoUringReactor::IoUringReactor(int listen_socket, DataCache& cache, ClientStats& stats, ServerMetrics& metrics,
+                               AdmissionControl& admission, std::atomic<bool>& server_running,
+                               std::atomic<size_t>& active_connections, const ServerConfig& config)
+    : listen_socket_(listen_socket), cache_(cache), stats_(stats), metrics_(metrics), admission_(admission),
+      server_running_(server_running), active_connections_(active_connections), config_(config),
+      ring_ready_(false), buffer_ring_(nullptr), accepting_(false), buffers_returned_(false), durable_fd_(-1),
+      durable_count_(0), last_idle_sweep_(std::chrono::steady_clock::now()) {
+    memset(&ring_, 0, sizeof(ring_));
+}
+
+IoUringReactor::~IoUringReactor() {
+    if (ring_ready_) {
+        // In-flight sends read connection memory, so let every request
+        // complete before the connections and buffers go away
+        if (accepting_) {
+            struct io_uring_sqe* sqe = nextSqe();
+            io_uring_prep_cancel64(sqe, userData(listen_socket_, static_cast<uint8_t>(Operation::ACCEPT)), 0);
+            io_uring_sqe_set_data64(sqe, userData(listen_socket_, static_cast<uint8_t>(Operation::CANCEL)));
+        }
+        for (auto& entry : connections_) {
+            closeConnection(entry.first);
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(DRAIN_TIMEOUT_MS);
+        while (!connections_.empty() && std::chrono::steady_clock::now() < deadline) {
+            struct io_uring_cqe* cqe = nullptr;
+            struct __kernel_timespec timeout = toTimespec(WAIT_TIMEOUT_MS);
+            io_uring_submit_and_wait_timeout(&ring_, &cqe, 1, &timeout, nullptr);
+            
+            unsigned head;
+            unsigned count = 0;
+            io_uring_for_each_cqe(&ring_, head, cqe) {
+                handleCompletion(cqe);
+                ++count;
+            }
+            io_uring_cq_advance(&ring_, count);
+        }
+        
+        if (buffer_ring_ != nullptr) {
+            io_uring_free_buf_ring(&ring_, buffer_ring_, RECV_BUFFER_COUNT, RECV_BUFFER_GROUP);
+        }
+        io_uring_queue_exit(&ring_);
+    }
+    if (durable_fd_ != -1) {
+        cache_.unwatchDurable(durable_fd_);
+        close(durable_fd_);
+    }
+    
+    active_connections_ -= connections_.size();
+    connections_.clear();
+}
+
+bool IoUringReactor::open() {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = COMPLETION_ENTRIES;
+    
+    int rc = io_uring_queue_init_params(SUBMISSION_ENTRIES, &ring_, &params);
+    if (rc < 0) {
+        Logger::warn("io_uring setup failed: ", strerror(-rc));
+        return false;
+    }
+    ring_ready_ = true;
+    
+    int error = 0;
+    buffer_ring_ = io_uring_setup_buf_ring(&ring_, RECV_BUFFER_COUNT, RECV_BUFFER_GROUP, 0, &error);
+    if (buffer_ring_ == nullptr) {
+        Logger::warn("io_uring receive buffer ring unavailable: ", strerror(-error));
+        return false;
+    }
+    
+    buffers_.reset(new char[RECV_BUFFER_COUNT * RECV_BUFFER_SIZE]);
+    for (unsigned i = 0; i < RECV_BUFFER_COUNT; ++i) {
+        io_uring_buf_ring_add(buffer_ring_, buffers_.get() + i * RECV_BUFFER_SIZE, RECV_BUFFER_SIZE, i,
+                              io_uring_buf_ring_mask(RECV_BUFFER_COUNT), i);
+    }
+    io_uring_buf_ring_advance(buffer_ring_, RECV_BUFFER_COUNT);
+    
+    // Without the wake-up, handlers block until their entries are durable
+    durable_fd_ = eventfd(0, EFD_CLOEXEC);
+    if (durable_fd_ != -1 && !cache_.watchDurable(durable_fd_)) {
+        close(durable_fd_);
+        durable_fd_ = -1;
+    }
+    return true;
+}
+
+void IoUringReactor::run() {
+    if (buffer_ring_ == nullptr) {
+        return;
+    }
+    
+    armAccept();
+    if (durable_fd_ != -1) {
+        armDurable();
+    }
+    
+    while (server_running_) {
+        // Submit everything queued while handling the last batch and wait
+        // for the next one with a single io_uring_enter
+        struct io_uring_cqe* cqe = nullptr;
+        struct __kernel_timespec timeout = toTimespec(WAIT_TIMEOUT_MS);
+        int rc = io_uring_submit_and_wait_timeout(&ring_, &cqe, 1, &timeout, nullptr);
+        if (rc < 0 && rc != -ETIME && rc != -EINTR) {
+            Logger::logError("io_uring wait failed: " + std::string(strerror(-rc)));
+            break;
+        }
+        
+        unsigned head;
+        unsigned count = 0;
+        io_uring_for_each_cqe(&ring_, head, cqe) {
+            handleCompletion(cqe);
+            ++count;
+        }
+        io_uring_cq_advance(&ring_, count);
+        
+        resumeStarved();
+        closeIdleConnections();
+    }
+}
+
+struct io_uring_sqe* IoUringReactor::nextSqe() {
+    struct io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
+    while (sqe == nullptr) {
+        io_uring_submit(&ring_);
+        sqe = io_uring_get_sqe(&ring_);
+    }
+    return sqe;
+}
+
+void IoUringReactor::armAccept() {
+    struct io_uring_sqe* sqe = nextSqe();
+    io_uring_prep_multishot_accept(sqe, listen_socket_, nullptr, nullptr, SOCK_CLOEXEC);
+    io_uring_sqe_set_data64(sqe, userData(listen_socket_, static_cast<uint8_t>(Operation::ACCEPT)));
+    accepting_ = true;
+}
+
+void IoUringReactor::armRecv(int fd, Connection& conn) {
+    struct io_uring_sqe* sqe = nextSqe();
+    io_uring_prep_recv_multishot(sqe, fd, nullptr, 0, 0);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = RECV_BUFFER_GROUP;
+    io_uring_sqe_set_data64(sqe, userData(fd, static_cast<uint8_t>(Operation::RECV)));
+    conn.receiving = true;
+    conn.in_flight++;
+}
+
+void IoUringReactor::submitSend(int fd, Connection& conn) {
+    memset(&conn.message, 0, sizeof(conn.message));
+    conn.message.msg_iov = conn.iov;
+    conn.message.msg_iovlen = conn.output.gather(conn.iov, SEND_IOVECS);
+    
+    struct io_uring_sqe* sqe = nextSqe();
+    io_uring_prep_sendmsg(sqe, fd, &conn.message, MSG_NOSIGNAL);
+    io_uring_sqe_set_data64(sqe, userData(fd, static_cast<uint8_t>(Operation::SEND)));
+    conn.sending = true;
+    conn.in_flight++;
+}
+
+void IoUringReactor::armWake(int fd, Connection& conn) {
+    struct io_uring_sqe* sqe = nextSqe();
+    // Polled, not read: the eventfd is non-blocking, so a read would fail
+    // with EAGAIN at once, and take() resets it anyway
+    io_uring_prep_poll_add(sqe, conn.handler->getSubscriptionFd(), POLLIN);
+    io_uring_sqe_set_data64(sqe, userData(fd, static_cast<uint8_t>(Operation::WAKE)));
+    conn.watching = true;
+    conn.in_flight++;
+}
+
+void IoUringReactor::armDurable() {
+    struct io_uring_sqe* sqe = nextSqe();
+    io_uring_prep_read(sqe, durable_fd_, &durable_count_, sizeof(durable_count_), 0);
+    io_uring_sqe_set_data64(sqe, userData(durable_fd_, static_cast<uint8_t>(Operation::DURABLE)));
+}
+
+void IoUringReactor::cancel(int fd, Operation operation) {
+    struct io_uring_sqe* sqe = nextSqe();
+    io_uring_prep_cancel64(sqe, userData(fd, static_cast<uint8_t>(operation)), 0);
+    io_uring_sqe_set_data64(sqe, userData(fd, static_cast<uint8_t>(Operation::CANCEL)));
+}
+
+void IoUringReactor::handleCompletion(const struct io_uring_cqe* cqe) {
+    uint64_t data = io_uring_cqe_get_data64(cqe);
+    Operation operation = static_cast<Operation>(data & 0xff);
+    int fd = static_cast<int>(data >> 8);
+    
+    if (operation == Operation::ACCEPT) {
+        handleAccept(cqe);
+        return;
+    }
+    if (operation == Operation::CANCEL) {
+        return;
+    }
+    if (operation == Operation::DURABLE) {
+        handleDurable(cqe);
+        return;
+    }
+    
+    auto it = connections_.find(fd);
+    if (it == connections_.end()) {
+        if (cqe->flags & IORING_CQE_F_BUFFER) {
+            recycleBuffer(static_cast<uint16_t>(cqe->flags >> IORING_CQE_BUFFER_SHIFT));
+        }
+        return;
+    }
+    Connection& conn = it->second;
+    
+    if (operation == Operation::RECV) {
+        handleRecv(fd, conn, cqe);
+    } else if (operation == Operation::SEND) {
+        handleSend(fd, conn, cqe);
+    } else {
+        handleWake(fd, conn, cqe);
+    }
+    releaseIfIdle(fd, conn);
+}
+
+void IoUringReactor::handleAccept(const struct io_uring_cqe* cqe) {
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        accepting_ = false;
+    }
+    
+    if (cqe->res < 0) {
+        if (cqe->res != -ECANCELED && server_running_) {
+            Logger::logError("accept failed: " + std::string(strerror(-cqe->res)));
+        }
+    } else if (!server_running_) {
+        close(cqe->res);
+    } else {
+        int client_socket = cqe->res;
+        
+        // Multishot accept does not report the peer address
+        struct sockaddr_storage client_addr;
+        socklen_t addr_len = sizeof(client_addr);
+        memset(&client_addr, 0, sizeof(client_addr));
+        getpeername(client_socket, (struct sockaddr*)&client_addr, &addr_len);
+        
+        metrics_.recordAccepted();
+        std::shared_ptr<PeerBudget> budget;
+        if (admission_.admitConnection(client_socket, client_addr, active_connections_.load(), budget)) {
+            Connection& conn = connections_.emplace(client_socket, Connection(config_.max_message_size)).first->second;
+            auto context = std::make_shared<ConnectionContext>(client_socket, client_addr);
+            context->budget = std::move(budget);
+            conn.handler.reset(new ClientHandler(context, cache_, stats_, metrics_, server_running_, config_));
+            if (durable_fd_ != -1) {
+                conn.handler->deferAcks();
+            }
+            conn.last_activity = std::chrono::steady_clock::now();
+            active_connections_++;
+            
+            if (Logger::isEnabled(LogLevel::INFO)) {
+                std::string conn_msg = "New connection from " + conn.handler->getClientIP();
+                Logger::logMessage(conn_msg);
+                std::cout << conn_msg << std::endl;
+            }
+            
+            armRecv(client_socket, conn);
+        }
+    }
+    
+    // The kernel ends a multishot accept on errors; start another one
+    if (!accepting_ && server_running_) {
+        armAccept();
+    }
+}
+
+void IoUringReactor::handleRecv(int fd, Connection& conn, const struct io_uring_cqe* cqe) {
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        conn.receiving = false;
+        conn.in_flight--;
+    }
+    
+    if (cqe->flags & IORING_CQE_F_BUFFER) {
+        uint16_t buffer_id = static_cast<uint16_t>(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+        if (cqe->res > 0 && !conn.closed) {
+            conn.last_activity = std::chrono::steady_clock::now();
+            conn.handler->markReceived();
+            deliver(fd, conn, buffer_id, static_cast<size_t>(cqe->res));
+        } else {
+            recycleBuffer(buffer_id);
+        }
+    }
+    
+    if (conn.closed) {
+        return;
+    }
+    
+    if (cqe->res == 0) {
+        conn.peer_closed = true;
+    } else if (cqe->res == -ENOBUFS) {
+        // Every receive buffer is taken; wait until one is returned
+        if (!conn.starved) {
+            conn.starved = true;
+            starved_.push_back(fd);
+        }
+    } else if (cqe->res < 0 && cqe->res != -ECANCELED) {
+        Logger::logError("recv failed for client " + conn.handler->getClientIP() + ": " +
+                         strerror(-cqe->res));
+        closeConnection(fd);
+        return;
+    }
+    
+    advance(fd, conn);
+}
+
+void IoUringReactor::handleSend(int fd, Connection& conn, const struct io_uring_cqe* cqe) {
+    conn.sending = false;
+    conn.in_flight--;
+    if (conn.closed) {
+        return;
+    }
+    
+    if (cqe->res < 0) {
+        Logger::logError("Failed to send response to client " + conn.handler->getClientIP());
+        closeConnection(fd);
+        return;
+    }
+    
+    conn.last_activity = std::chrono::steady_clock::now();
+    conn.output.consume(static_cast<size_t>(cqe->res));
+    if (conn.output.empty()) {
+        Logger::debug("Response sent to ", conn.handler->getClientIP());
+        conn.handler->responsesSent();
+    }
+    advance(fd, conn);
+}
+
+void IoUringReactor::handleWake(int fd, Connection& conn, const struct io_uring_cqe* cqe) {
+    conn.watching = false;
+    conn.in_flight--;
+    if (conn.closed) {
+        return;
+    }
+    
+    if (cqe->res < 0 && cqe->res != -ECANCELED) {
+        Logger::logError("Subscription wake-up failed for client " + conn.handler->getClientIP() + ": " +
+                         strerror(-cqe->res));
+        closeConnection(fd);
+        return;
+    }
+    
+    // New entries are waiting; advance() queues them once the output drains
+    advance(fd, conn);
+}
+
+void IoUringReactor::handleDurable(const struct io_uring_cqe* cqe) {
+    if (cqe->res < 0) {
+        if (cqe->res != -ECANCELED) {
+            Logger::logError("Write-ahead log wake-up failed: " + std::string(strerror(-cqe->res)));
+        }
+        return;
+    }
+    
+    // Serving a connection may park it again, so walk a copy
+    std::vector<int> syncing(syncing_.begin(), syncing_.end());
+    for (int fd : syncing) {
+        auto it = connections_.find(fd);
+        if (it == connections_.end()) {
+            continue;
+        }
+        Connection& conn = it->second;
+        bool keep_open = !conn.closing;
+        if (!conn.handler->acksDurable(conn.output, keep_open)) {
+            continue;
+        }
+        
+        conn.syncing = false;
+        syncing_.erase(fd);
+        conn.closing = !keep_open;
+        advance(fd, conn);
+        releaseIfIdle(fd, conn);
+    }
+    
+    if (server_running_) {
+        armDurable();
+    }
+}
+
+void IoUringReactor::deliver(int fd, Connection& conn, uint16_t buffer_id, size_t length) {
+    const char* data = buffers_.get() + buffer_id * RECV_BUFFER_SIZE;
+    size_t taken = conn.held.empty() ? conn.input.append(data, length) : 0;
+    if (taken == length) {
+        recycleBuffer(buffer_id);
+        return;
+    }
+    
+    // The input buffer is full: keep the rest out of the ring and stop
+    // receiving until parsing has made room
+    conn.held.push_back(HeldBuffer{buffer_id, taken, length - taken});
+    if (!conn.paused) {
+        conn.paused = true;
+        if (conn.receiving) {
+            cancel(fd, Operation::RECV);
+        }
+    }
+}
+
+void IoUringReactor::drainHeld(Connection& conn) {
+    while (!conn.held.empty()) {
+        HeldBuffer& held = conn.held.front();
+        const char* data = buffers_.get() + held.id * RECV_BUFFER_SIZE + held.offset;
+        size_t taken = conn.input.append(data, held.length);
+        if (taken < held.length) {
+            held.offset += taken;
+            held.length -= taken;
+            return;
+        }
+        recycleBuffer(held.id);
+        conn.held.pop_front();
+    }
+}
+
+void IoUringReactor::recycleBuffer(uint16_t buffer_id) {
+    io_uring_buf_ring_add(buffer_ring_, buffers_.get() + buffer_id * RECV_BUFFER_SIZE, RECV_BUFFER_SIZE,
+                          buffer_id, io_uring_buf_ring_mask(RECV_BUFFER_COUNT), 0);
+    io_uring_buf_ring_advance(buffer_ring_, 1);
+    buffers_returned_ = true;
+}
+
+void IoUringReactor::resumeStarved() {
+    if (starved_.empty() || !buffers_returned_) {
+        return;
+    }
+    buffers_returned_ = false;
+    
+    std::vector<int> starved;
+    starved.swap(starved_);
+    for (int fd : starved) {
+        auto it = connections_.find(fd);
+        if (it == connections_.end()) {
+            continue;
+        }
+        Connection& conn = it->second;
+        conn.starved = false;
+        if (!conn.closed && !conn.receiving && !conn.paused && !conn.peer_closed) {
+            armRecv(fd, conn);
+        }
+    }
+}
+
+void IoUringReactor::advance(int fd, Connection& conn) {
+    // The kernel reads the output until the send completes, and held
+    // output waits for the log
+    if (conn.closed || conn.sending || conn.syncing) {
+        return;
+    }
+    
+    while (true) {
+        if (!conn.output.empty()) {
+            submitSend(fd, conn);
+            return;
+        }
+        if (conn.closing) {
+            closeConnection(fd);
+            return;
+        }
+        
+        // Output is drained: parse whatever complete requests are buffered
+        drainHeld(conn);
+        bool keep_open = conn.handler->processInput(conn.input, conn.output);
+        if (!conn.handler->acksDurable(conn.output, keep_open)) {
+            // The log signals every advance after this check
+            conn.syncing = true;
+            conn.closing = !keep_open;
+            syncing_.insert(fd);
+            return;
+        }
+        if (!keep_open) {
+            conn.closing = true;
+            continue;
+        }
+        if (conn.output.empty()) {
+            break;
+        }
+    }
+    
+    if (conn.paused && conn.held.empty()) {
+        conn.paused = false;
+    }
+    if (conn.peer_closed) {
+        if (conn.held.empty()) {
+            Logger::debug("Client ", conn.handler->getClientIP(), " disconnected");
+            closeConnection(fd);
+        }
+        return;
+    }
+    
+    // A recv cancelled to pause input is re-armed here; a starved one
+    // once buffers have been returned
+    if (!conn.receiving && !conn.paused && !conn.starved) {
+        armRecv(fd, conn);
+    }
+    if (!conn.watching && conn.handler->isSubscribed()) {
+        armWake(fd, conn);
+    }
+}
+
+void IoUringReactor::closeIdleConnections() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_idle_sweep_ < std::chrono::milliseconds(IDLE_SWEEP_INTERVAL_MS)) {
+        return;
+    }
+    last_idle_sweep_ = now;
+    
+    auto timeout = std::chrono::milliseconds(config_.idle_timeout_ms);
+    for (auto it = connections_.begin(); it != connections_.end();) {
+        int fd = it->first;
+        Connection& conn = it->second;
+        ++it;
+        
+        if (!conn.closed && now - conn.last_activity >= timeout && !conn.handler->isSubscribed()) {
+            Logger::logMessage("Closing idle connection from " + conn.handler->getClientIP());
+            closeConnection(fd);
+            releaseIfIdle(fd, conn);
+        }
+    }
+}
+
+void IoUringReactor::closeConnection(int fd) {
+    auto it = connections_.find(fd);
+    if (it == connections_.end() || it->second.closed) {
+        return;
+    }
+    Connection& conn = it->second;
+    conn.closed = true;
+    syncing_.erase(fd);
+    
+    // The socket stays open until its requests complete, so a new
+    // connection cannot reuse the descriptor while they are in flight.
+    // Shutting it down ends a send that waits for a full socket buffer.
+    if (conn.receiving) {
+        cancel(fd, Operation::RECV);
+    }
+    if (conn.watching) {
+        cancel(fd, Operation::WAKE);
+    }
+    if (conn.sending) {
+        shutdown(fd, SHUT_RDWR);
+    }
+    for (const HeldBuffer& held : conn.held) {
+        recycleBuffer(held.id);
+    }
+    conn.held.clear();
+}
+
+void IoUringReactor::releaseIfIdle(int fd, Connection& conn) {
+    if (!conn.closed || conn.in_flight > 0) {
+        return;
+    }
+    
+    // ClientHandler owns the socket and closes it on destruction
+    connections_.erase(fd);
+    active_connections_--;
+    Logger::debug("Client handler finished, active connections: ", active_connections_.load());
+}
\ No newline at end of file
@@ -1,19 +1,203 @@
 #include <iostream>
+#include <string>
 #include <server/tcp_server.h>
+#include <server/server_config.h>
 #include <common/logger.h>
 #include <common/protocol.h>
 #include <signal.h>
 
-int main() {
+void printUsage(const char* programName) {
+    std::cout << "Usage: " << programName << " [--port PORT] [--mode threads|epoll|reuseport|io_uring]"
+              << " [--workers N] [--queue N] [--overflow reject|block] [--cpu-affinity on|off]"
+              << " [--idle-timeout SECONDS]"
+              << " [--max-message-size BYTES] [--cache-shards N] [--cache-size BYTES]"
+              << " [--eviction fifo|lru|ttl] [--cache-ttl SECONDS]"
+              << " [--wal PATH] [--wal-sync fsync|interval|os] [--wal-sync-interval MS]"
+              << " [--snapshot PATH] [--snapshot-interval SECONDS]"
+              << " [--subscriber-queue N] [--slow-subscriber drop|disconnect]"
+              << " [--max-connections N] [--conn-rate N] [--conn-burst N]"
+              << " [--request-rate N] [--request-burst N] [--shed-queue-depth N]"
+              << " [--log-level trace|debug|info|warn|error]" << std::endl;
+    std::cout << "Examples:" << std::endl;
+    std::cout << "  " << programName << std::endl;
+    std::cout << "  " << programName << " --mode epoll" << std::endl;
+    std::cout << "  " << programName << " --port 9090 --mode threads --workers 8 --queue 256" << std::endl;
+    std::cout << "  " << programName << " --mode epoll --log-level warn" << std::endl;
+    std::cout << "  " << programName << " --mode reuseport --workers 8 --cpu-affinity on --cache-shards 8" << std::endl;
+    std::cout << "  " << programName << " --mode io_uring" << std::endl;
+    std::cout << "  " << programName << " --wal data.wal --wal-sync interval --wal-sync-interval 50" << std::endl;
+    std::cout << "  " << programName << " --wal data.wal --snapshot data.snap --snapshot-interval 300" << std::endl;
+    std::cout << "  " << programName << " --mode epoll --subscriber-queue 256 --slow-subscriber disconnect" << std::endl;
+    std::cout << "  " << programName << " --max-connections 10000 --conn-rate 20 --request-rate 1000 --shed-queue-depth 64"
+              << std::endl;
+}
+
+bool parseCount(const std::string& value, size_t& out) {
+    try {
+        size_t pos = 0;
+        out = std::stoul(value, &pos);
+        return pos == value.size();
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool parseArguments(int argc, char* argv[], ServerConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        
+        if (arg == "--help" || arg == "-h") {
+            return false;
+        }
+        
+        if (i + 1 >= argc) {
+            std::cerr << "Error: Missing value for '" << arg << "'" << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        
+        if (arg == "--port") {
+            config.port = value;
+        } else if (arg == "--mode") {
+            if (value == "threads") {
+                config.mode = ServerMode::THREAD_POOL;
+            } else if (value == "epoll") {
+                config.mode = ServerMode::EPOLL;
+            } else if (value == "reuseport") {
+                config.mode = ServerMode::REUSEPORT;
+            } else if (value == "io_uring") {
+                config.mode = ServerMode::IO_URING;
+            } else {
+                std::cerr << "Error: Unknown mode '" << value << "'" << std::endl;
+                return false;
+            }
+        } else if (arg == "--workers" || arg == "--queue" || arg == "--cache-shards") {
+            size_t& target = arg == "--workers" ? config.worker_threads
+                           : arg == "--queue" ? config.queue_capacity : config.cache_shards;
+            if (!parseCount(value, target)) {
+                std::cerr << "Error: Invalid number '" << value << "' for " << arg << std::endl;
+                return false;
+            }
+        } else if (arg == "--max-connections" || arg == "--conn-rate" || arg == "--conn-burst" ||
+                   arg == "--request-rate" || arg == "--request-burst" || arg == "--shed-queue-depth") {
+            size_t& target = arg == "--max-connections" ? config.max_connections
+                           : arg == "--conn-rate"       ? config.connection_rate
+                           : arg == "--conn-burst"      ? config.connection_burst
+                           : arg == "--request-rate"    ? config.request_rate
+                           : arg == "--request-burst"   ? config.request_burst
+                                                        : config.shed_queue_depth;
+            if (!parseCount(value, target)) {
+                std::cerr << "Error: Invalid number '" << value << "' for " << arg << std::endl;
+                return false;
+            }
+        } else if (arg == "--idle-timeout") {
+            size_t seconds = 0;
+            if (!parseCount(value, seconds) || seconds == 0) {
+                std::cerr << "Error: Invalid idle timeout '" << value << "'" << std::endl;
+                return false;
+            }
+            config.idle_timeout_ms = static_cast<int>(seconds * 1000);
+        } else if (arg == "--max-message-size") {
+            if (!parseCount(value, config.max_message_size) || config.max_message_size == 0) {
+                std::cerr << "Error: Invalid maximum message size '" << value << "'" << std::endl;
+                return false;
+            }
+        } else if (arg == "--cache-size") {
+            if (!parseCount(value, config.cache_max_bytes) || config.cache_max_bytes == 0) {
+                std::cerr << "Error: Invalid cache size '" << value << "'" << std::endl;
+                return false;
+            }
+        } else if (arg == "--eviction") {
+            if (!DataCache::parseEvictionPolicy(value, config.eviction_policy)) {
+                std::cerr << "Error: Unknown eviction policy '" << value << "'" << std::endl;
+                return false;
+            }
+        } else if (arg == "--cache-ttl") {
+            size_t seconds = 0;
+            if (!parseCount(value, seconds) || seconds == 0) {
+                std::cerr << "Error: Invalid cache TTL '" << value << "'" << std::endl;
+                return false;
+            }
+            config.cache_ttl_ms = static_cast<int>(seconds * 1000);
+        } else if (arg == "--wal") {
+            config.wal_path = value;
+        } else if (arg == "--wal-sync") {
+            if (!WriteAheadLog::parseSyncMode(value, config.wal_sync_mode)) {
+                std::cerr << "Error: Unknown WAL sync mode '" << value << "'" << std::endl;
+                return false;
+            }
+        } else if (arg == "--wal-sync-interval") {
+            size_t interval_ms = 0;
+            if (!parseCount(value, interval_ms) || interval_ms == 0) {
+                std::cerr << "Error: Invalid WAL sync interval '" << value << "'" << std::endl;
+                return false;
+            }
+            config.wal_sync_interval_ms = static_cast<int>(interval_ms);
+        } else if (arg == "--snapshot") {
+            config.snapshot_path = value;
+        } else if (arg == "--snapshot-interval") {
+            size_t seconds = 0;
+            if (!parseCount(value, seconds) || seconds == 0) {
+                std::cerr << "Error: Invalid snapshot interval '" << value << "'" << std::endl;
+                return false;
+            }
+            config.snapshot_interval_ms = static_cast<int>(seconds * 1000);
+        } else if (arg == "--subscriber-queue") {
+            if (!parseCount(value, config.subscriber_queue) || config.subscriber_queue == 0) {
+                std::cerr << "Error: Invalid subscriber queue length '" << value << "'" << std::endl;
+                return false;
+            }
+        } else if (arg == "--slow-subscriber") {
+            if (!SubscriptionHub::parsePolicy(value, config.slow_subscriber_policy)) {
+                std::cerr << "Error: Unknown slow subscriber policy '" << value << "'" << std::endl;
+                return false;
+            }
+        } else if (arg == "--log-level") {
+            if (!Logger::parseLevel(value, config.log_level)) {
+                std::cerr << "Error: Unknown log level '" << value << "'" << std::endl;
+                return false;
+            }
+        } else if (arg == "--cpu-affinity") {
+            if (value == "on" || value == "off") {
+                config.cpu_affinity = value == "on";
+            } else {
+                std::cerr << "Error: --cpu-affinity takes 'on' or 'off'" << std::endl;
+                return false;
+            }
+        } else if (arg == "--overflow") {
+            if (value == "reject") {
+                config.overflow_policy = OverflowPolicy::REJECT;
+            } else if (value == "block") {
+                config.overflow_policy = OverflowPolicy::BLOCK;
+            } else {
+                std::cerr << "Error: Unknown overflow policy '" << value << "'" << std::endl;
+                return false;
+            }
+        } else {
+            std::cerr << "Error: Unknown option '" << arg << "'" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
     std::cout << "=== WebServer - Multi-threaded TCP Server ===" << std::endl;
     
+    ServerConfig config;
+    if (!parseArguments(argc, argv, config)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    
+    Logger::setLevel(config.log_level);
     Logger::logMessage("=== Server Starting ===");
     
     // Create server instance
-    TCPServer server(Protocol::DEFAULT_PORT);
+    TCPServer server(config);
     
     // Setup signal handler for graceful shutdown
-    signal(SIGINT, [](int sig) {
+    signal(SIGINT, [](int) {
         Logger::logMessage("Received SIGINT, shutting down gracefully...");
         std::cout << "\nReceived SIGINT, shutting down gracefully..." << std::endl;
         exit(0);
@@ -0,0 +1,121 @@
+#include <server/output_queue.h>
+#include <sys/socket.h>
+#include <string.h>
+
+namespace {
+    // Segments handed to one sendmsg() call; well below IOV_MAX
+    const size_t MAX_IOVECS = 64;
+}
+
+OutputQueue::OutputQueue() : head_(0), head_written_(0), size_(0) {
+}
+
+void OutputQueue::append(std::string_view data) {
+    if (data.empty()) {
+        return;
+    }
+    
+    // Consecutive copies extend the last buffer segment
+    if (!segments_.empty() && segments_.back().data == nullptr) {
+        segments_.back().length += data.size();
+    } else {
+        segments_.push_back(Segment{nullptr, buffer_.size(), data.size()});
+    }
+    buffer_.append(data.data(), data.size());
+    size_ += data.size();
+}
+
+void OutputQueue::appendView(std::string_view data) {
+    if (data.empty()) {
+        return;
+    }
+    segments_.push_back(Segment{data.data(), 0, data.size()});
+    size_ += data.size();
+}
+
+void OutputQueue::retain(std::shared_ptr<const char[]> owner) {
+    owners_.push_back(std::move(owner));
+}
+
+size_t OutputQueue::reserve(size_t length) {
+    size_t position = buffer_.size();
+    if (!segments_.empty() && segments_.back().data == nullptr) {
+        segments_.back().length += length;
+    } else {
+        segments_.push_back(Segment{nullptr, position, length});
+    }
+    buffer_.resize(position + length);
+    size_ += length;
+    return position;
+}
+
+char* OutputQueue::at(size_t position) {
+    return &buffer_[position];
+}
+
+size_t OutputQueue::size() const {
+    return size_;
+}
+
+bool OutputQueue::empty() const {
+    return size_ == 0;
+}
+
+ssize_t OutputQueue::writeTo(int fd) {
+    if (size_ == 0) {
+        return 0;
+    }
+    
+    struct iovec iov[MAX_IOVECS];
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = iov;
+    message.msg_iovlen = gather(iov, MAX_IOVECS);
+    
+    ssize_t written = sendmsg(fd, &message, MSG_NOSIGNAL);
+    if (written > 0) {
+        consume(static_cast<size_t>(written));
+    }
+    return written;
+}
+
+size_t OutputQueue::gather(struct iovec* iov, size_t max) const {
+    size_t count = 0;
+    for (size_t i = head_; i < segments_.size() && count < max; ++i, ++count) {
+        const Segment& segment = segments_[i];
+        const char* data = segment.data != nullptr ? segment.data : buffer_.data() + segment.offset;
+        size_t skip = i == head_ ? head_written_ : 0;
+        iov[count].iov_base = const_cast<char*>(data + skip);
+        iov[count].iov_len = segment.length - skip;
+    }
+    return count;
+}
+
+void OutputQueue::consume(size_t length) {
+    // Advance past what the kernel took; a partial write stops mid-segment
+    size_t remaining = length < size_ ? length : size_;
+    size_ -= remaining;
+    while (remaining > 0) {
+        size_t left = segments_[head_].length - head_written_;
+        if (remaining < left) {
+            head_written_ += remaining;
+            break;
+        }
+        remaining -= left;
+        head_++;
+        head_written_ = 0;
+    }
+    
+    if (size_ == 0) {
+        clear();
+    }
+}
+
+void OutputQueue::clear() {
+    buffer_.clear();
+    segments_.clear();
+    owners_.clear();
+    head_ = 0;
+    head_written_ = 0;
+    size_ = 0;
+}
\ No newline at end of file
@@ -0,0 +1,287 @@
+#include <server/server_metrics.h>
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+    // Upper bounds of the latency buckets and their "le" labels in seconds
+    const int64_t LATENCY_BOUNDS_NS[] = {
+        10000, 25000, 50000, 100000, 250000, 500000,
+        1000000, 2500000, 5000000, 10000000, 25000000, 50000000, 100000000, 250000000, 500000000,
+        1000000000, 2500000000, 5000000000, 10000000000,
+    };
+    const char* const LATENCY_LABELS[] = {
+        "0.00001", "0.000025", "0.00005", "0.0001", "0.00025", "0.0005",
+        "0.001", "0.0025", "0.005", "0.01", "0.025", "0.05", "0.1", "0.25", "0.5",
+        "1", "2.5", "5", "10",
+    };
+    const size_t LATENCY_BOUNDS = sizeof(LATENCY_BOUNDS_NS) / sizeof(LATENCY_BOUNDS_NS[0]);
+    static_assert(LATENCY_BOUNDS == sizeof(LATENCY_LABELS) / sizeof(LATENCY_LABELS[0]),
+                  "every latency bound needs a label");
+    
+    const uint16_t STATUS_CODES[] = {200, 201, 400, 404, 413, 429, 503};
+    const size_t STATUS_CODE_COUNT = sizeof(STATUS_CODES) / sizeof(STATUS_CODES[0]);
+    
+    const char* const METHOD_NAMES[] = {"GET", "POST", "OTHER"};
+    
+    std::atomic<uint64_t> next_instance_id(1);
+    
+    // Only the owning thread writes, so a load/store pair cannot lose updates
+    void addRelaxed(std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+    
+    uint64_t loadRelaxed(const std::atomic<uint64_t>& counter) {
+        return counter.load(std::memory_order_relaxed);
+    }
+    
+    size_t methodIndex(Protocol::Method method) {
+        switch (method) {
+            case Protocol::Method::GET:
+                return 0;
+            case Protocol::Method::POST:
+                return 1;
+            default:
+                return 2;
+        }
+    }
+    
+    std::string pathLabel(size_t index) {
+        std::string_view path = Protocol::idToPath(static_cast<Protocol::PathId>(index));
+        return path.empty() ? "other" : std::string(path);
+    }
+    
+    // Integers print exactly; sums of seconds keep 15 significant digits
+    void appendValue(std::string& out, double value) {
+        char buffer[32];
+        int length = std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+        out.append(buffer, length);
+    }
+    
+    void appendHeader(std::string& out, const std::string& name, const std::string& help, const char* type) {
+        out += "# HELP " + name + " " + help + "\n";
+        out += "# TYPE " + name + " " + type + "\n";
+    }
+    
+    void appendSample(std::string& out, const std::string& name, const std::string& labels, double value) {
+        out += name;
+        if (!labels.empty()) {
+            out += "{" + labels + "}";
+        }
+        out += " ";
+        appendValue(out, value);
+        out += "\n";
+    }
+}
+
+ServerMetrics::ServerMetrics(size_t listeners)
+    : id_(next_instance_id.fetch_add(1, std::memory_order_relaxed)), listener_count_(std::max<size_t>(listeners, 1)),
+      listeners_(new ListenerCounter[listener_count_]) {
+}
+
+void ServerMetrics::recordRequest(Protocol::Method method, Protocol::PathId path, uint16_t status,
+                                  size_t bytes_in, size_t bytes_out) {
+    Slot& slot = slotForThisThread();
+    size_t path_index = static_cast<size_t>(path) < PATH_LABELS ? static_cast<size_t>(path) : 0;
+    addRelaxed(slot.requests[methodIndex(method)][path_index], 1);
+    addRelaxed(slot.responses[statusIndex(status)], 1);
+    addRelaxed(slot.bytes_in, bytes_in);
+    addRelaxed(slot.bytes_out, bytes_out);
+}
+
+void ServerMetrics::recordLatency(Protocol::PathId path, std::chrono::nanoseconds latency) {
+    Slot& slot = slotForThisThread();
+    size_t path_index = static_cast<size_t>(path) < PATH_LABELS ? static_cast<size_t>(path) : 0;
+    addRelaxed(slot.latency_buckets[path_index][latencyBucket(latency)], 1);
+    addRelaxed(slot.latency_sum_ns[path_index], static_cast<uint64_t>(std::max<int64_t>(latency.count(), 0)));
+}
+
+void ServerMetrics::recordAccepted(size_t listener) {
+    addRelaxed(listeners_[listener % listener_count_].accepted, 1);
+}
+
+void ServerMetrics::recordRejected(RejectReason reason) {
+    addRelaxed(slotForThisThread().rejected[static_cast<size_t>(reason)], 1);
+}
+
+size_t ServerMetrics::getListenerCount() const {
+    return listener_count_;
+}
+
+uint64_t ServerMetrics::getAcceptedConnections(size_t listener) const {
+    return listener < listener_count_ ? loadRelaxed(listeners_[listener].accepted) : 0;
+}
+
+void ServerMetrics::addGauge(const std::string& name, const std::string& help, Gauge value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    gauges_.push_back(RegisteredGauge{name, help, std::move(value)});
+}
+
+std::string ServerMetrics::render() const {
+    // Sum the slots first so the lock is not held while formatting
+    uint64_t requests[METHOD_LABELS][PATH_LABELS] = {};
+    uint64_t responses[STATUS_LABELS] = {};
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+    uint64_t rejected[REJECT_REASONS] = {};
+    uint64_t latency_buckets[PATH_LABELS][LATENCY_BUCKETS] = {};
+    uint64_t latency_sum_ns[PATH_LABELS] = {};
+    std::vector<std::pair<const RegisteredGauge*, double>> gauge_values;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& entry : slots_) {
+            const Slot& slot = *entry.second;
+            for (size_t m = 0; m < METHOD_LABELS; ++m) {
+                for (size_t p = 0; p < PATH_LABELS; ++p) {
+                    requests[m][p] += loadRelaxed(slot.requests[m][p]);
+                }
+            }
+            for (size_t s = 0; s < STATUS_LABELS; ++s) {
+                responses[s] += loadRelaxed(slot.responses[s]);
+            }
+            bytes_in += loadRelaxed(slot.bytes_in);
+            bytes_out += loadRelaxed(slot.bytes_out);
+            for (size_t r = 0; r < REJECT_REASONS; ++r) {
+                rejected[r] += loadRelaxed(slot.rejected[r]);
+            }
+            for (size_t p = 0; p < PATH_LABELS; ++p) {
+                for (size_t b = 0; b < LATENCY_BUCKETS; ++b) {
+                    latency_buckets[p][b] += loadRelaxed(slot.latency_buckets[p][b]);
+                }
+                latency_sum_ns[p] += loadRelaxed(slot.latency_sum_ns[p]);
+            }
+        }
+        
+        // Gauges are only added before serving, so their addresses are stable
+        for (const RegisteredGauge& gauge : gauges_) {
+            gauge_values.emplace_back(&gauge, 0.0);
+        }
+    }
+    for (auto& gauge : gauge_values) {
+        gauge.second = gauge.first->value();
+    }
+    
+    std::string out;
+    
+    appendHeader(out, "webserver_requests_total", "Requests served, by method and path.", "counter");
+    for (size_t m = 0; m < METHOD_LABELS; ++m) {
+        for (size_t p = 0; p < PATH_LABELS; ++p) {
+            if (requests[m][p] > 0) {
+                appendSample(out, "webserver_requests_total",
+                             std::string("method=\"") + METHOD_NAMES[m] + "\",path=\"" + pathLabel(p) + "\"",
+                             static_cast<double>(requests[m][p]));
+            }
+        }
+    }
+    
+    appendHeader(out, "webserver_responses_total", "Responses sent, by status code.", "counter");
+    for (size_t s = 0; s < STATUS_LABELS; ++s) {
+        if (responses[s] > 0) {
+            std::string code = s < STATUS_CODE_COUNT ? std::to_string(STATUS_CODES[s]) : "other";
+            appendSample(out, "webserver_responses_total", "code=\"" + code + "\"", static_cast<double>(responses[s]));
+        }
+    }
+    
+    appendHeader(out, "webserver_received_bytes_total", "Request bytes received.", "counter");
+    appendSample(out, "webserver_received_bytes_total", "", static_cast<double>(bytes_in));
+    appendHeader(out, "webserver_sent_bytes_total", "Response bytes queued for sending.", "counter");
+    appendSample(out, "webserver_sent_bytes_total", "", static_cast<double>(bytes_out));
+    uint64_t accepted = 0;
+    for (size_t l = 0; l < listener_count_; ++l) {
+        accepted += getAcceptedConnections(l);
+    }
+    appendHeader(out, "webserver_connections_accepted_total", "Connections accepted.", "counter");
+    appendSample(out, "webserver_connections_accepted_total", "", static_cast<double>(accepted));
+    if (listener_count_ > 1) {
+        appendHeader(out, "webserver_listener_connections_accepted_total",
+                     "Connections accepted, by listening socket.", "counter");
+        for (size_t l = 0; l < listener_count_; ++l) {
+            appendSample(out, "webserver_listener_connections_accepted_total",
+                         "listener=\"" + std::to_string(l) + "\"", static_cast<double>(getAcceptedConnections(l)));
+        }
+    }
+    appendHeader(out, "webserver_connections_rejected_total", "Connections turned away at accept, by reason.",
+                 "counter");
+    for (size_t r = 0; r < REJECT_REASONS; ++r) {
+        appendSample(out, "webserver_connections_rejected_total",
+                     std::string("reason=\"") + rejectReasonToString(static_cast<RejectReason>(r)) + "\"",
+                     static_cast<double>(rejected[r]));
+    }
+    
+    for (const auto& gauge : gauge_values) {
+        appendHeader(out, gauge.first->name, gauge.first->help, "gauge");
+        appendSample(out, gauge.first->name, "", gauge.second);
+    }
+    
+    appendHeader(out, "webserver_request_duration_seconds",
+                 "Time from receiving a request to sending its response, by path.", "histogram");
+    for (size_t p = 0; p < PATH_LABELS; ++p) {
+        std::string path = "path=\"" + pathLabel(p) + "\"";
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b < LATENCY_BUCKETS; ++b) {
+            cumulative += latency_buckets[p][b];
+        }
+        if (cumulative == 0) {
+            continue;
+        }
+        
+        cumulative = 0;
+        for (size_t b = 0; b < LATENCY_BUCKETS; ++b) {
+            cumulative += latency_buckets[p][b];
+            const char* le = b < LATENCY_BOUNDS ? LATENCY_LABELS[b] : "+Inf";
+            appendSample(out, "webserver_request_duration_seconds_bucket", path + ",le=\"" + le + "\"",
+                         static_cast<double>(cumulative));
+        }
+        appendSample(out, "webserver_request_duration_seconds_sum", path, latency_sum_ns[p] / 1e9);
+        appendSample(out, "webserver_request_duration_seconds_count", path, static_cast<double>(cumulative));
+    }
+    return out;
+}
+
+const char* ServerMetrics::rejectReasonToString(RejectReason reason) {
+    switch (reason) {
+        case RejectReason::QUEUE_FULL:
+            return "queue_full";
+        case RejectReason::OVERLOADED:
+            return "overloaded";
+        case RejectReason::CONNECTION_LIMIT:
+            return "connection_limit";
+        case RejectReason::CONNECTION_RATE:
+            return "connection_rate";
+        default:
+            return "unknown";
+    }
+}
+
+ServerMetrics::Slot& ServerMetrics::slotForThisThread() {
+    // Most threads only ever record into one instance
+    thread_local uint64_t cached_id = 0;
+    thread_local Slot* cached_slot = nullptr;
+    if (cached_id == id_) {
+        return *cached_slot;
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unique_ptr<Slot>& slot = slots_[std::this_thread::get_id()];
+    if (!slot) {
+        slot.reset(new Slot());
+    }
+    cached_id = id_;
+    cached_slot = slot.get();
+    return *cached_slot;
+}
+
+size_t ServerMetrics::statusIndex(uint16_t status) {
+    static_assert(STATUS_LABELS == STATUS_CODE_COUNT + 1, "STATUS_LABELS must match STATUS_CODES");
+    for (size_t i = 0; i < STATUS_CODE_COUNT; ++i) {
+        if (STATUS_CODES[i] == status) {
+            return i;
+        }
+    }
+    return STATUS_LABELS - 1;
+}
+
+size_t ServerMetrics::latencyBucket(std::chrono::nanoseconds latency) {
+    static_assert(LATENCY_BUCKETS == LATENCY_BOUNDS + 1, "LATENCY_BUCKETS must match LATENCY_BOUNDS_NS");
+    const int64_t* bound = std::lower_bound(LATENCY_BOUNDS_NS, LATENCY_BOUNDS_NS + LATENCY_BOUNDS, latency.count());
+    return static_cast<size_t>(bound - LATENCY_BOUNDS_NS);
+}
\ No newline at end of file
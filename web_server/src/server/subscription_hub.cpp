@@ -0,0 +1,315 @@
+#include <server/subscription_hub.h>
+#include <server/data_cache.h>
+#include <common/logger.h>
+#include <algorithm>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+Subscription::Subscription(Protocol::Encoding encoding, size_t capacity, SlowSubscriberPolicy policy,
+                           uint64_t live_from)
+    : encoding_(encoding), capacity_(capacity), policy_(policy), live_from_(live_from), wake_fd_(-1),
+      cut_off_(false), dropped_(0) {
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ == -1) {
+        Logger::logError("eventfd failed for subscription: " + std::string(strerror(errno)));
+    }
+}
+
+Subscription::~Subscription() {
+    if (wake_fd_ != -1) {
+        close(wake_fd_);
+    }
+}
+
+int Subscription::getWakeFd() const {
+    return wake_fd_;
+}
+
+Protocol::Encoding Subscription::getEncoding() const {
+    return encoding_;
+}
+
+uint64_t Subscription::getLiveFrom() const {
+    return live_from_;
+}
+
+bool Subscription::take(std::vector<StreamFrame>& frames) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    // Reset under the lock, so a frame offered after this wakes the owner again
+    uint64_t count;
+    while (read(wake_fd_, &count, sizeof(count)) == -1 && errno == EINTR) {
+    }
+    
+    for (StreamFrame& frame : queue_) {
+        frames.push_back(std::move(frame));
+    }
+    queue_.clear();
+    return !cut_off_;
+}
+
+uint64_t Subscription::getDroppedFrames() const {
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+bool Subscription::offer(const StreamFrame& frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (cut_off_) {
+        return false;
+    }
+    
+    if (queue_.size() >= capacity_) {
+        if (policy_ == SlowSubscriberPolicy::DISCONNECT) {
+            cut_off_ = true;
+            wake();
+        } else {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return false;
+    }
+    
+    // The owner takes the whole queue at once, so only the first frame
+    // after that needs to wake it
+    if (queue_.empty()) {
+        wake();
+    }
+    queue_.push_back(frame);
+    return true;
+}
+
+void Subscription::wake() {
+    uint64_t one = 1;
+    while (write(wake_fd_, &one, sizeof(one)) == -1 && errno == EINTR) {
+    }
+}
+
+SubscriptionHub::SubscriptionHub(DataCache& cache, size_t queue_capacity, SlowSubscriberPolicy policy)
+    : cache_(cache), queue_capacity_(std::max<size_t>(queue_capacity, 1)), policy_(policy), subscriber_count_(0),
+      published_(1), publish_pending_(false), stopping_(false), dropped_frames_(0), disconnected_(0) {
+    publisher_ = std::thread(&SubscriptionHub::publishLoop, this);
+    Logger::logMessage("SubscriptionHub initialized with " + std::to_string(queue_capacity_) +
+                       " queued entries per subscriber, " + policyToString(policy_) + " when full");
+}
+
+SubscriptionHub::~SubscriptionHub() {
+    {
+        std::lock_guard<std::mutex> lock(signal_mutex_);
+        stopping_ = true;
+    }
+    publish_cv_.notify_one();
+    publisher_.join();
+}
+
+std::shared_ptr<Subscription> SubscriptionHub::subscribe(Protocol::Encoding encoding) {
+    // No publisher runs meanwhile, so live_from splits the entries cleanly
+    // between the cache and the stream
+    std::lock_guard<std::mutex> publish_lock(publish_mutex_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = subscribers_ ? subscribers_->size() : 0;
+    
+    // Nothing was published without subscribers, so start at the watermark.
+    // The count is raised first and a writer checks it after storing its
+    // entry, both sequentially consistent: an entry at or past the watermark
+    // is still being stored by a writer that will see the subscriber and
+    // publish it.
+    subscriber_count_.store(count + 1);
+    if (count == 0) {
+        published_ = std::max(published_, cache_.getCommittedSeq());
+    }
+    uint64_t live_from = published_;
+    
+    auto subscription = std::make_shared<Subscription>(encoding, queue_capacity_, policy_, live_from);
+    if (subscription->getWakeFd() == -1) {
+        subscriber_count_.store(count);
+        return nullptr;
+    }
+    
+    auto subscribers = std::make_shared<SubscriberList>();
+    if (subscribers_) {
+        *subscribers = *subscribers_;
+    }
+    subscribers->push_back(subscription);
+    subscribers_ = std::move(subscribers);
+    return subscription;
+}
+
+bool SubscriptionHub::unsubscribe(const std::shared_ptr<Subscription>& subscription) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!subscribers_) {
+        return false;
+    }
+    auto it = std::find(subscribers_->begin(), subscribers_->end(), subscription);
+    if (it == subscribers_->end()) {
+        return false;
+    }
+    
+    auto subscribers = std::make_shared<SubscriberList>(*subscribers_);
+    subscribers->erase(subscribers->begin() + (it - subscribers_->begin()));
+    subscriber_count_.store(subscribers->size());
+    if (subscribers->empty()) {
+        subscribers_.reset();
+    } else {
+        subscribers_ = std::move(subscribers);
+    }
+    return true;
+}
+
+void SubscriptionHub::publish() {
+    if (subscriber_count_.load() == 0) {
+        return;
+    }
+    
+    // Only the writer raising the flag wakes the publisher; it clears the
+    // flag before reading the watermark, so a later entry raises it again
+    if (publish_pending_.exchange(true)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(signal_mutex_);
+    }
+    publish_cv_.notify_one();
+}
+
+void SubscriptionHub::publishLoop() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(signal_mutex_);
+            publish_cv_.wait(lock, [this] { return stopping_ || publish_pending_.load(); });
+            if (stopping_) {
+                return;
+            }
+        }
+        
+        publish_pending_.store(false);
+        std::lock_guard<std::mutex> lock(publish_mutex_);
+        deliverCommitted();
+    }
+}
+
+void SubscriptionHub::deliverCommitted() {
+    std::shared_ptr<const SubscriberList> subscribers = snapshot();
+    uint64_t committed = cache_.getCommittedSeq();
+    if (!subscribers) {
+        published_ = std::max(published_, committed);
+        return;
+    }
+    
+    while (published_ < committed) {
+        CacheBatch batch = cache_.peekSince(published_ - 1, PUBLISH_PAGE);
+        for (const CacheBatch::Entry& entry : batch.entries) {
+            deliver(*subscribers, entry.seq, entry.data);
+        }
+        
+        // A short page holds everything committed when it was read; entries
+        // missing below the watermark were evicted before they got here
+        if (batch.entries.size() < PUBLISH_PAGE) {
+            published_ = std::max(batch.next_seq + 1, committed);
+            break;
+        }
+        published_ = batch.next_seq + 1;
+    }
+}
+
+size_t SubscriptionHub::getSubscriberCount() const {
+    return subscriber_count_.load(std::memory_order_relaxed);
+}
+
+uint64_t SubscriptionHub::getDroppedFrames() const {
+    return dropped_frames_.load(std::memory_order_relaxed);
+}
+
+uint64_t SubscriptionHub::getDisconnectedSubscribers() const {
+    return disconnected_.load(std::memory_order_relaxed);
+}
+
+bool SubscriptionHub::parsePolicy(const std::string& name, SlowSubscriberPolicy& policy) {
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    
+    if (lower == "drop") {
+        policy = SlowSubscriberPolicy::DROP;
+    } else if (lower == "disconnect") {
+        policy = SlowSubscriberPolicy::DISCONNECT;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* SubscriptionHub::policyToString(SlowSubscriberPolicy policy) {
+    switch (policy) {
+        case SlowSubscriberPolicy::DROP:
+            return "drop";
+        case SlowSubscriberPolicy::DISCONNECT:
+            return "disconnect";
+        default:
+            return "unknown";
+    }
+}
+
+std::shared_ptr<const SubscriptionHub::SubscriberList> SubscriptionHub::snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return subscribers_;
+}
+
+void SubscriptionHub::deliver(const SubscriberList& subscribers, uint64_t seq, std::string_view data) {
+    // Framed lazily, once per encoding, and shared by all its subscribers
+    StreamFrame frames[2];
+    
+    for (const std::shared_ptr<Subscription>& subscription : subscribers) {
+        // Entries from before the subscription started are read from the cache
+        if (seq < subscription->getLiveFrom()) {
+            continue;
+        }
+        
+        StreamFrame& frame = frames[subscription->getEncoding() == Protocol::Encoding::BINARY ? 1 : 0];
+        if (!frame.data) {
+            frame = makeFrame(seq, data, subscription->getEncoding());
+        }
+        if (subscription->offer(frame)) {
+            continue;
+        }
+        
+        if (policy_ == SlowSubscriberPolicy::DROP) {
+            dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+        } else if (unsubscribe(subscription)) {
+            disconnected_.fetch_add(1, std::memory_order_relaxed);
+            Logger::warn("Subscriber fell ", queue_capacity_, " entries behind, disconnecting it");
+        }
+    }
+}
+
+StreamFrame SubscriptionHub::makeFrame(uint64_t seq, std::string_view data, Protocol::Encoding encoding) {
+    bool binary = encoding == Protocol::Encoding::BINARY;
+    size_t length = binary ? data.size() : Protocol::escapedLength(data);
+    
+    // "200 OK – 1 entries; next=SEQ; SEQ:LEN:DATA", the same as GET /data
+    // returns, so clients parse both alike
+    std::string head = "200 OK – 1 entries; next=" + std::to_string(seq) + "; " + std::to_string(seq) + ":" +
+                       std::to_string(length) + ":";
+    size_t body_length = head.size() + length;
+    
+    StreamFrame frame;
+    frame.seq = seq;
+    frame.length = binary ? Protocol::BINARY_HEADER_SIZE + body_length : body_length + 1;
+    std::shared_ptr<char[]> buffer(new char[frame.length]);
+    
+    char* out = buffer.get();
+    if (binary) {
+        Protocol::writeBinaryHeader(out, Protocol::Opcode::RESPONSE, 200, static_cast<uint32_t>(body_length));
+        out += Protocol::BINARY_HEADER_SIZE;
+    }
+    memcpy(out, head.data(), head.size());
+    out += head.size();
+    if (binary) {
+        memcpy(out, data.data(), data.size());
+    } else {
+        out = Protocol::writeEscaped(out, data);
+        *out = Protocol::FRAME_DELIMITER;
+    }
+    
+    frame.data = std::move(buffer);
+    return frame;
+}
\ No newline at end of file
@@ -1,19 +1,58 @@
 #include <server/tcp_server.h>
 #include <server/client_handler.h>
+#include <server/event_reactor.h>
+#ifdef WEBSERVER_HAVE_LIBURING
+#include <server/io_uring_reactor.h>
+#endif
 #include <common/logger.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
-#include <arpa/inet.h>
 #include <unistd.h>
 #include <netdb.h>
+#include <fcntl.h>
 #include <string.h>
 #include <iostream>
-#include <algorithm>
 #include <signal.h>
+#include <sched.h>
+#include <pthread.h>
+#include <errno.h>
+#include <chrono>
+#include <thread>
+
+namespace {
+    // Restrict the calling thread to one CPU
+    void pinToCpu(int cpu) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (rc != 0) {
+            Logger::warn("Failed to pin listener thread to CPU ", cpu, ": ", strerror(rc));
+        }
+    }
+    
+    // Defaults for every setting but the port
+    ServerConfig configForPort(const std::string& port) {
+        ServerConfig config;
+        config.port = port;
+        return config;
+    }
+}
 
 TCPServer::TCPServer(const std::string& port) 
-    : port_(port), sockfd_(-1), running_(false), active_connections_(0) {
+    : TCPServer(configForPort(port)) {
+}
+
+TCPServer::TCPServer(const ServerConfig& config)
+    : config_(config), port_(config.port), sockfd_(-1), running_(false), active_connections_(0),
+      cache_(config.cache_shards, config.cache_max_bytes, config.eviction_policy, config.cache_ttl_ms),
+      subscriptions_(cache_, config.subscriber_queue, config.slow_subscriber_policy),
+      metrics_(config.mode == ServerMode::REUSEPORT ? listenerCount(config) : 1),
+      admission_(metrics_, config.max_connections, config.connection_rate, config.connection_burst,
+                 config.request_rate, config.request_burst) {
+    cache_.attachSubscriptions(&subscriptions_);
+    registerGauges();
     Logger::logMessage("TCPServer created for port " + port_);
 }
 
@@ -28,42 +67,92 @@ bool TCPServer::start() {
         return true;
     }
     
+    if (!wal_ && !snapshots_ && !restoreCache()) {
+        Logger::logError("Failed to restore the cache");
+        return false;
+    }
+    
     if (!initializeSocket()) {
         Logger::logError("Failed to initialize socket");
         return false;
     }
     
     running_ = true;
-    Logger::logMessage("Server started on port " + port_);
-    std::cout << "Server listening on port " << port_ << "..." << std::endl;
+    
+    if (config_.mode == ServerMode::THREAD_POOL) {
+        pool_.reset(new ThreadPool(config_.worker_threads, config_.queue_capacity, config_.overflow_policy));
+        idle_poller_.reset(new IdlePoller(config_.idle_timeout_ms, active_connections_,
+                                          [this](std::shared_ptr<ClientHandler> handler) {
+                                              resumeClient(std::move(handler));
+                                          }));
+        if (!idle_poller_->start()) {
+            stop();
+            return false;
+        }
+    }
+    
+    const char* mode_name = config_.mode == ServerMode::EPOLL       ? "epoll"
+                          : config_.mode == ServerMode::REUSEPORT ? "reuseport"
+                          : config_.mode == ServerMode::IO_URING  ? "io_uring"
+                                                                  : "thread pool";
+    Logger::logMessage("Server started on port " + port_ + " (" + mode_name + " mode)");
+    std::cout << "Server listening on port " << port_ << " (" << mode_name << " mode)..." << std::endl;
     
     // Start accepting connections
-    acceptConnections();
+    if (config_.mode == ServerMode::EPOLL || config_.mode == ServerMode::IO_URING) {
+        runEventLoop();
+    } else if (config_.mode == ServerMode::REUSEPORT) {
+        runListeners();
+    } else {
+        acceptConnections();
+    }
     
     return true;
 }
 
 void TCPServer::stop() {
-    if (!running_) {
+    // A shutdown request clears running_ before stop() runs, so check resources too
+    if (!running_ && sockfd_ == -1 && reuseport_sockets_.empty() && !pool_ && !wal_ && !snapshots_) {
         return;
     }
     
     running_ = false;
     Logger::logMessage("Server stopping...");
     
-    // Close server socket
+    // Close server sockets
     if (sockfd_ != -1) {
         close(sockfd_);
         sockfd_ = -1;
     }
+    for (int listener : reuseport_sockets_) {
+        close(listener);
+    }
+    reuseport_sockets_.clear();
     
-    // Wait for all client threads to finish
-    for (auto& thread : client_threads_) {
-        if (thread.joinable()) {
-            thread.join();
-        }
+    // Stop resuming parked clients, let workers finish queued ones, then
+    // join them and close whatever was parked meanwhile
+    if (idle_poller_) {
+        idle_poller_->stop();
+    }
+    if (pool_) {
+        pool_->shutdown();
+        pool_.reset();
+    }
+    idle_poller_.reset();
+    
+    // A final snapshot keeps the log tail short for the next start
+    if (snapshots_) {
+        snapshots_->stop();
+        snapshots_->takeSnapshot();
+        snapshots_.reset();
+    }
+    
+    // No handler can append any more; sync what is queued
+    if (wal_) {
+        cache_.attachWriteAheadLog(nullptr);
+        wal_->close();
+        wal_.reset();
     }
-    client_threads_.clear();
     
     Logger::logMessage("Server stopped");
     std::cout << "Server stopped." << std::endl;
@@ -81,10 +170,142 @@ size_t TCPServer::getActiveConnections() const {
     return active_connections_;
 }
 
+size_t TCPServer::getQueueDepth() const {
+    return pool_ ? pool_->getQueueDepth() : 0;
+}
+
+size_t TCPServer::getIdleConnections() const {
+    return idle_poller_ ? idle_poller_->getParkedConnections() : 0;
+}
+
+double TCPServer::getWorkerUtilization() const {
+    return pool_ ? pool_->getUtilization() : 0.0;
+}
+
+size_t TCPServer::getRejectedConnections() const {
+    return pool_ ? pool_->getRejectedTasks() : 0;
+}
+
+const ClientStats& TCPServer::getClientStats() const {
+    return stats_;
+}
+
+const ServerMetrics& TCPServer::getMetrics() const {
+    return metrics_;
+}
+
+void TCPServer::registerGauges() {
+    metrics_.addGauge("webserver_active_connections", "Connections currently open.",
+                      [this] { return static_cast<double>(active_connections_.load()); });
+    metrics_.addGauge("webserver_worker_queue_depth", "Connections waiting for a worker.",
+                      [this] { return static_cast<double>(getQueueDepth()); });
+    metrics_.addGauge("webserver_idle_connections", "Thread-pool connections parked until they send.",
+                      [this] { return static_cast<double>(getIdleConnections()); });
+    metrics_.addGauge("webserver_admission_tracked_peers", "Peer addresses with a rate limit budget.",
+                      [this] { return static_cast<double>(admission_.getTrackedPeers()); });
+    metrics_.addGauge("webserver_cache_entries", "Entries held by the cache.",
+                      [this] { return static_cast<double>(cache_.size()); });
+    metrics_.addGauge("webserver_cache_stored_bytes", "Payload bytes of the cached entries.",
+                      [this] { return static_cast<double>(cache_.getStoredBytes()); });
+    metrics_.addGauge("webserver_cache_memory_bytes", "Arena bytes allocated by the cache.",
+                      [this] { return static_cast<double>(cache_.getMemoryUsage()); });
+    metrics_.addGauge("webserver_subscribers", "Open GET /data/subscribe streams.",
+                      [this] { return static_cast<double>(subscriptions_.getSubscriberCount()); });
+    metrics_.addGauge("webserver_subscription_dropped_frames", "Stream frames dropped for slow subscribers.",
+                      [this] { return static_cast<double>(subscriptions_.getDroppedFrames()); });
+    metrics_.addGauge("webserver_subscription_disconnects", "Subscribers disconnected for falling behind.",
+                      [this] { return static_cast<double>(subscriptions_.getDisconnectedSubscribers()); });
+    metrics_.addGauge("webserver_log_queue_depth", "Log records waiting to be written.",
+                      [] { return static_cast<double>(Logger::getQueueDepth()); });
+}
+
+bool TCPServer::restoreCache() {
+    auto started = std::chrono::steady_clock::now();
+    uint64_t wal_offset = 0;
+    uint64_t committed_seq = 0;
+    size_t from_snapshot = 0;
+    
+    if (!config_.snapshot_path.empty()) {
+        SnapshotImage image;
+        if (CacheSnapshot::load(config_.snapshot_path, image)) {
+            from_snapshot = cache_.adoptSnapshot(image);
+            wal_offset = image.wal_offset;
+            committed_seq = image.committed_seq;
+        }
+    }
+    
+    if (!config_.wal_path.empty() && !openWriteAheadLog(wal_offset, committed_seq)) {
+        return false;
+    }
+    
+    if (!config_.snapshot_path.empty()) {
+        snapshots_.reset(new CacheSnapshot(config_.snapshot_path, cache_, wal_.get(), config_.snapshot_interval_ms));
+        snapshots_->start();
+    }
+    
+    if (wal_ || from_snapshot > 0) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - started);
+        Logger::logMessage("Cache restored with " + std::to_string(cache_.size()) + " entries (" +
+                           std::to_string(from_snapshot) + " from snapshot) in " +
+                           std::to_string(elapsed.count()) + " ms");
+    }
+    return true;
+}
+
+bool TCPServer::openWriteAheadLog(uint64_t offset, uint64_t first_seq) {
+    std::unique_ptr<WriteAheadLog> wal(new WriteAheadLog(config_.wal_path, config_.wal_sync_mode,
+                                                         config_.wal_sync_interval_ms));
+    if (!wal->open()) {
+        return false;
+    }
+    
+    // Entries below first_seq are in the snapshot, or were evicted before
+    // it was taken and must stay gone
+    bool replayed = wal->replay(offset, [this, first_seq](uint64_t seq, std::string_view payload) {
+        if (seq >= first_seq) {
+            cache_.restoreEntry(seq, payload);
+        }
+    });
+    if (!replayed) {
+        return false;
+    }
+    
+    wal->start();
+    wal_ = std::move(wal);
+    cache_.attachWriteAheadLog(wal_.get());
+    return true;
+}
+
 bool TCPServer::initializeSocket() {
+    if (config_.mode != ServerMode::REUSEPORT) {
+        sockfd_ = openListeningSocket(false);
+        return sockfd_ != -1;
+    }
+    
+    // Every listener binds the same port; the kernel spreads new
+    // connections over them by a hash of their addresses
+    size_t count = listenerCount(config_);
+    for (size_t i = 0; i < count; ++i) {
+        int listener = openListeningSocket(true);
+        if (listener == -1) {
+            for (int opened : reuseport_sockets_) {
+                close(opened);
+            }
+            reuseport_sockets_.clear();
+            return false;
+        }
+        reuseport_sockets_.push_back(listener);
+    }
+    Logger::logMessage("Opened " + std::to_string(count) + " SO_REUSEPORT listeners on port " + port_);
+    return true;
+}
+
+int TCPServer::openListeningSocket(bool reuse_port) {
     struct addrinfo hints, *servinfo, *p;
     int yes = 1;
     int rv;
+    int listener = -1;
     
     memset(&hints, 0, sizeof hints);
     hints.ai_family = AF_UNSPEC;
@@ -93,25 +314,26 @@ bool TCPServer::initializeSocket() {
     
     if ((rv = getaddrinfo(NULL, port_.c_str(), &hints, &servinfo)) != 0) {
         Logger::logError("getaddrinfo: " + std::string(gai_strerror(rv)));
-        return false;
+        return -1;
     }
     
     // Loop through all results and bind to the first we can
     for (p = servinfo; p != NULL; p = p->ai_next) {
-        if ((sockfd_ = socket(p->ai_family, p->ai_socktype, p->ai_protocol)) == -1) {
+        if ((listener = socket(p->ai_family, p->ai_socktype, p->ai_protocol)) == -1) {
             Logger::logError("socket creation failed");
             continue;
         }
         
-        if (setsockopt(sockfd_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(int)) == -1) {
-            Logger::logError("setsockopt failed");
-            close(sockfd_);
+        if (setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(int)) == -1 ||
+            (reuse_port && setsockopt(listener, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(int)) == -1)) {
+            Logger::logError("setsockopt failed: " + std::string(strerror(errno)));
+            close(listener);
             freeaddrinfo(servinfo);
-            return false;
+            return -1;
         }
         
-        if (bind(sockfd_, p->ai_addr, p->ai_addrlen) == -1) {
-            close(sockfd_);
+        if (bind(listener, p->ai_addr, p->ai_addrlen) == -1) {
+            close(listener);
             Logger::logError("bind failed");
             continue;
         }
@@ -123,16 +345,34 @@ bool TCPServer::initializeSocket() {
     
     if (p == NULL) {
         Logger::logError("Failed to bind socket");
-        return false;
+        return -1;
     }
     
-    if (listen(sockfd_, SOMAXCONN) == -1) {
+    if (listen(listener, SOMAXCONN) == -1) {
         Logger::logError("listen failed");
-        close(sockfd_);
-        return false;
+        close(listener);
+        return -1;
     }
     
-    return true;
+    // The reactors accept until EAGAIN, so their listeners must not block
+    if (config_.mode != ServerMode::THREAD_POOL) {
+        int flags = fcntl(listener, F_GETFL, 0);
+        if (flags == -1 || fcntl(listener, F_SETFL, flags | O_NONBLOCK) == -1) {
+            Logger::logError("Failed to make listening socket non-blocking");
+            close(listener);
+            return -1;
+        }
+    }
+    
+    return listener;
+}
+
+size_t TCPServer::listenerCount(const ServerConfig& config) {
+    size_t count = config.worker_threads;
+    if (count == 0) {
+        count = std::thread::hardware_concurrency();
+    }
+    return count == 0 ? 1 : count;
 }
 
 void TCPServer::acceptConnections() {
@@ -149,57 +389,148 @@ void TCPServer::acceptConnections() {
             continue;
         }
         
-        // Get client IP for logging
-        char client_ip[INET6_ADDRSTRLEN];
-        if (client_addr.ss_family == AF_INET) {
-            struct sockaddr_in* addr_in = (struct sockaddr_in*)&client_addr;
-            inet_ntop(AF_INET, &(addr_in->sin_addr), client_ip, INET_ADDRSTRLEN);
-        } else {
-            struct sockaddr_in6* addr_in6 = (struct sockaddr_in6*)&client_addr;
-            inet_ntop(AF_INET6, &(addr_in6->sin6_addr), client_ip, INET6_ADDRSTRLEN);
+        metrics_.recordAccepted();
+        
+        // Shed load before the queue fills, so the clients already waiting
+        // are served without delay; refused clients cost one send
+        if (config_.shed_queue_depth > 0 && pool_->getQueueDepth() >= config_.shed_queue_depth) {
+            admission_.refuse(client_socket, ServerMetrics::RejectReason::OVERLOADED);
+            continue;
         }
         
-        std::string conn_msg = "New connection from " + std::string(client_ip);
-        Logger::logMessage(conn_msg);
-        std::cout << conn_msg << std::endl;
+        std::shared_ptr<PeerBudget> budget;
+        if (!admission_.admitConnection(client_socket, client_addr, active_connections_.load(), budget)) {
+            continue;
+        }
         
-        // Clean up finished threads before creating new ones
-        cleanupThreads();
+        // Resolve the peer address once; the handler reuses it for every log line
+        auto context = std::make_shared<ConnectionContext>(client_socket, client_addr);
+        context->budget = std::move(budget);
         
-        // Create new thread to handle client
+        if (Logger::isEnabled(LogLevel::INFO)) {
+            std::string conn_msg = "New connection from " + context->peer_ip;
+            Logger::logMessage(conn_msg);
+            std::cout << conn_msg << std::endl;
+        }
+        
+        // Hand the client to a worker; a full queue rejects or blocks per policy
         active_connections_++;
-        client_threads_.emplace_back(&TCPServer::handleClient, this, client_socket);
+        if (!pool_->submit([this, context] { handleClient(context); })) {
+            active_connections_--;
+            rejectClient(client_socket);
+        }
+    }
+}
+
+void TCPServer::runEventLoop() {
+    if (config_.mode == ServerMode::IO_URING) {
+#ifdef WEBSERVER_HAVE_LIBURING
+        IoUringReactor reactor(sockfd_, cache_, stats_, metrics_, admission_, running_, active_connections_,
+                               config_);
+        if (reactor.open()) {
+            reactor.run();
+            return;
+        }
+        Logger::warn("io_uring is not available on this kernel, falling back to epoll");
+#else
+        Logger::warn("Built without liburing, falling back to epoll");
+#endif
+    }
+    
+    EventReactor reactor(sockfd_, 0, cache_, stats_, metrics_, admission_, running_, active_connections_, config_);
+    reactor.run();
+}
+
+void TCPServer::runListeners() {
+    std::vector<int> cpus;
+    if (config_.cpu_affinity) {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &allowed)) {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+    }
+    
+    // Each listener's connections live on its thread from accept to close
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < reuseport_sockets_.size(); ++i) {
+        threads.emplace_back([this, i, &cpus] {
+            if (!cpus.empty()) {
+                pinToCpu(cpus[i % cpus.size()]);
+            }
+            EventReactor reactor(reuseport_sockets_[i], i, cache_, stats_, metrics_, admission_, running_,
+                                 active_connections_, config_);
+            reactor.run();
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    
+    // Shows whether the kernel balanced the connections
+    for (size_t i = 0; i < reuseport_sockets_.size(); ++i) {
+        Logger::logMessage("Listener " + std::to_string(i) + " accepted " +
+                           std::to_string(metrics_.getAcceptedConnections(i)) + " connections");
     }
 }
 
-void TCPServer::handleClient(int client_socket) {
+void TCPServer::handleClient(const std::shared_ptr<ConnectionContext>& context) {
+    std::shared_ptr<ClientHandler> handler;
     try {
-        ClientHandler handler(client_socket, cache_, running_);
-        handler.handleRequest();
+        handler = std::make_shared<ClientHandler>(context, cache_, stats_, metrics_, running_, config_);
     } catch (const std::exception& e) {
         Logger::logError("Exception in client handler: " + std::string(e.what()));
     } catch (...) {
         Logger::logError("Unknown exception in client handler");
     }
     
+    if (handler) {
+        serveClient(std::move(handler));
+    } else {
+        active_connections_--;
+    }
+}
+
+void TCPServer::serveClient(std::shared_ptr<ClientHandler> handler) {
+    bool quiet = false;
+    try {
+        quiet = handler->handleRequest();
+    } catch (const std::exception& e) {
+        Logger::logError("Exception in client handler: " + std::string(e.what()));
+    } catch (...) {
+        Logger::logError("Unknown exception in client handler");
+    }
+    
+    // The worker is free while the client is not sending
+    if (quiet) {
+        idle_poller_->park(std::move(handler));
+        return;
+    }
+    
+    handler.reset();
     active_connections_--;
-    Logger::logMessage("Client handler finished, active connections: " + std::to_string(active_connections_));
-}
-
-void TCPServer::cleanupThreads() {
-    // Remove finished threads
-    client_threads_.erase(
-        std::remove_if(client_threads_.begin(), client_threads_.end(),
-                      [](std::thread& t) {
-                          if (t.joinable()) {
-                              // Note: This is a simplified cleanup. In a production system,
-                              // you might want to use a more sophisticated thread management approach
-                              return false;
-                          }
-                          return true;
-                      }),
-        client_threads_.end()
-    );
+    Logger::debug("Client handler finished, active connections: ", active_connections_.load());
+}
+
+void TCPServer::resumeClient(std::shared_ptr<ClientHandler> handler) {
+    if (!pool_->submit([this, handler] { serveClient(handler); })) {
+        // Queued tasks run at shutdown, rejected ones never do
+        if (running_) {
+            Logger::logError("Worker queue full, closing connection from " + handler->getClientIP());
+        }
+        handler.reset();
+        active_connections_--;
+    }
+}
+
+void TCPServer::rejectClient(int client_socket) {
+    admission_.refuse(client_socket, ServerMetrics::RejectReason::QUEUE_FULL);
+    Logger::logError("Worker queue full, connection rejected (queue depth: " +
+                     std::to_string(pool_->getQueueDepth()) + ")");
 }
 
 void TCPServer::setupSignalHandlers() {
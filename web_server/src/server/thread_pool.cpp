@@ -0,0 +1,123 @@
+#include <server/thread_pool.h>
+#include <common/logger.h>
+
+ThreadPool::ThreadPool(size_t num_workers, size_t queue_capacity, OverflowPolicy policy)
+    : queue_(queue_capacity > 0 ? queue_capacity : 1), head_(0), count_(0),
+      policy_(policy), stopping_(false), busy_workers_(0), rejected_tasks_(0) {
+    if (num_workers == 0) {
+        num_workers = std::thread::hardware_concurrency();
+        if (num_workers == 0) {
+            num_workers = 1;
+        }
+    }
+    
+    workers_.reserve(num_workers);
+    for (size_t i = 0; i < num_workers; ++i) {
+        workers_.emplace_back(&ThreadPool::workerLoop, this);
+    }
+    
+    Logger::logMessage("ThreadPool started with " + std::to_string(num_workers) +
+                       " workers, queue capacity " + std::to_string(queue_.size()));
+}
+
+ThreadPool::~ThreadPool() {
+    shutdown();
+}
+
+bool ThreadPool::submit(Task task) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    
+    if (policy_ == OverflowPolicy::BLOCK) {
+        not_full_.wait(lock, [this] { return stopping_ || count_ < queue_.size(); });
+    }
+    
+    if (stopping_ || count_ == queue_.size()) {
+        rejected_tasks_++;
+        return false;
+    }
+    
+    queue_[(head_ + count_) % queue_.size()] = std::move(task);
+    count_++;
+    lock.unlock();
+    
+    not_empty_.notify_one();
+    return true;
+}
+
+void ThreadPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+    
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    
+    Logger::logMessage("ThreadPool stopped, rejected tasks: " + std::to_string(rejected_tasks_));
+}
+
+size_t ThreadPool::getWorkerCount() const {
+    return workers_.size();
+}
+
+size_t ThreadPool::getQueueCapacity() const {
+    return queue_.size();
+}
+
+size_t ThreadPool::getQueueDepth() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return count_;
+}
+
+size_t ThreadPool::getBusyWorkers() const {
+    return busy_workers_;
+}
+
+double ThreadPool::getUtilization() const {
+    if (workers_.empty()) {
+        return 0.0;
+    }
+    return static_cast<double>(busy_workers_) / static_cast<double>(workers_.size());
+}
+
+size_t ThreadPool::getRejectedTasks() const {
+    return rejected_tasks_;
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_empty_.wait(lock, [this] { return stopping_ || count_ > 0; });
+            
+            // Drain remaining tasks before exiting
+            if (count_ == 0) {
+                return;
+            }
+            
+            task = std::move(queue_[head_]);
+            head_ = (head_ + 1) % queue_.size();
+            count_--;
+        }
+        not_full_.notify_one();
+        
+        busy_workers_++;
+        try {
+            task();
+        } catch (const std::exception& e) {
+            Logger::logError("Exception in worker thread: " + std::string(e.what()));
+        } catch (...) {
+            Logger::logError("Unknown exception in worker thread");
+        }
+        busy_workers_--;
+    }
+}
\ No newline at end of file
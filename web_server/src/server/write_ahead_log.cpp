@@ -0,0 +1,399 @@
+#include <server/write_ahead_log.h>
+#include <common/checksum.h>
+#include <common/logger.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+
+namespace {
+    const char FILE_MAGIC[8] = {'W', 'S', 'W', 'A', 'L', '0', '0', '1'};
+    const size_t RECORD_HEADER_SIZE = 16;
+    
+    void putU32(char* out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            out[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+        }
+    }
+    
+    void putU64(char* out, uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            out[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+        }
+    }
+    
+    uint32_t getU32(const char* in) {
+        uint32_t value = 0;
+        for (int i = 3; i >= 0; --i) {
+            value = (value << 8) | static_cast<unsigned char>(in[i]);
+        }
+        return value;
+    }
+    
+    uint64_t getU64(const char* in) {
+        uint64_t value = 0;
+        for (int i = 7; i >= 0; --i) {
+            value = (value << 8) | static_cast<unsigned char>(in[i]);
+        }
+        return value;
+    }
+    
+    // The checksum covers the sequence number and the payload
+    uint32_t recordChecksum(const char* seq_bytes, std::string_view payload) {
+        return crc32(payload.data(), payload.size(), crc32(seq_bytes, sizeof(uint64_t)));
+    }
+}
+
+WriteAheadLog::WriteAheadLog(const std::string& path, WalSyncMode mode, int sync_interval_ms)
+    : path_(path), mode_(mode), sync_interval_ms_(sync_interval_ms), fd_(-1),
+      appended_position_(0), written_position_(0), synced_position_(0),
+      stopping_(false), running_(false), failed_(false), batches_(0), records_(0) {
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    close();
+}
+
+bool WriteAheadLog::open() {
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ == -1) {
+        Logger::logError("Failed to open write-ahead log " + path_ + ": " + strerror(errno));
+        return false;
+    }
+    
+    struct stat st;
+    if (fstat(fd_, &st) == -1) {
+        Logger::logError("Failed to stat write-ahead log " + path_ + ": " + strerror(errno));
+        return false;
+    }
+    
+    if (st.st_size == 0) {
+        std::string header(FILE_MAGIC, sizeof(FILE_MAGIC));
+        if (!writeAll(header) || fdatasync(fd_) == -1) {
+            Logger::logError("Failed to initialize write-ahead log " + path_);
+            return false;
+        }
+        appended_position_ = sizeof(FILE_MAGIC);
+    } else {
+        char magic[sizeof(FILE_MAGIC)];
+        if (pread(fd_, magic, sizeof(magic), 0) != static_cast<ssize_t>(sizeof(magic)) ||
+            memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0) {
+            Logger::logError("Not a write-ahead log: " + path_);
+            return false;
+        }
+        appended_position_ = static_cast<uint64_t>(st.st_size);
+    }
+    
+    written_position_ = appended_position_;
+    synced_position_ = appended_position_;
+    return true;
+}
+
+bool WriteAheadLog::replay(uint64_t offset,
+                           const std::function<void(uint64_t seq, std::string_view payload)>& apply) {
+    auto started = std::chrono::steady_clock::now();
+    uint64_t file_size = appended_position_;
+    uint64_t position = std::max<uint64_t>(offset, sizeof(FILE_MAGIC));
+    size_t replayed = 0;
+    
+    // A snapshot can only refer to synced data, so this means the log was
+    // replaced or damaged behind it
+    if (position > file_size) {
+        Logger::warn("Write-ahead log ", path_, " ends at ", file_size, ", before the replay offset ", position);
+        position = file_size;
+    }
+    
+    if (position < file_size) {
+        void* mapping = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (mapping == MAP_FAILED) {
+            Logger::logError("Failed to map write-ahead log " + path_ + ": " + strerror(errno));
+            return false;
+        }
+        madvise(mapping, file_size, MADV_SEQUENTIAL);
+        const char* data = static_cast<const char*>(mapping);
+        
+        while (file_size - position >= RECORD_HEADER_SIZE) {
+            const char* header = data + position;
+            uint32_t length = getU32(header);
+            if (file_size - position - RECORD_HEADER_SIZE < length) {
+                break;
+            }
+            
+            std::string_view payload(header + RECORD_HEADER_SIZE, length);
+            if (getU32(header + 4) != recordChecksum(header + 8, payload)) {
+                break;
+            }
+            
+            apply(getU64(header + 8), payload);
+            position += RECORD_HEADER_SIZE + length;
+            replayed++;
+        }
+        munmap(mapping, file_size);
+    }
+    
+    // Drop a torn or corrupt tail so new records follow the last good one
+    if (position < file_size) {
+        Logger::warn("Write-ahead log ", path_, ": discarding ", file_size - position,
+                     " bytes after the last intact record");
+        if (ftruncate(fd_, static_cast<off_t>(position)) == -1) {
+            Logger::logError("Failed to truncate write-ahead log " + path_ + ": " + strerror(errno));
+            return false;
+        }
+        appended_position_ = written_position_ = synced_position_ = position;
+    }
+    
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+    Logger::logMessage("Replayed " + std::to_string(replayed) + " records from " + path_ + " in " +
+                       std::to_string(elapsed.count()) + " ms");
+    return true;
+}
+
+void WriteAheadLog::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_ || fd_ == -1) {
+        return;
+    }
+    running_ = true;
+    flusher_ = std::thread(&WriteAheadLog::flushLoop, this);
+    Logger::logMessage("Write-ahead log " + path_ + " started (" + syncModeToString(mode_) + " mode)");
+}
+
+uint64_t WriteAheadLog::append(uint64_t seq, std::string_view payload) {
+    // Encode outside the lock; the critical section is a single copy
+    char header[RECORD_HEADER_SIZE];
+    putU32(header, static_cast<uint32_t>(payload.size()));
+    putU64(header + 8, seq);
+    putU32(header + 4, recordChecksum(header + 8, payload));
+    
+    uint64_t position;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.append(header, RECORD_HEADER_SIZE);
+        pending_.append(payload.data(), payload.size());
+        appended_position_ += RECORD_HEADER_SIZE + payload.size();
+        position = appended_position_;
+    }
+    records_.fetch_add(1, std::memory_order_relaxed);
+    pending_cv_.notify_one();
+    return position;
+}
+
+uint64_t WriteAheadLog::appendBatch(uint64_t first_seq, const std::vector<std::string_view>& payloads) {
+    // Encode every record outside the lock into one buffer sized up front
+    size_t total = 0;
+    for (std::string_view payload : payloads) {
+        total += RECORD_HEADER_SIZE + payload.size();
+    }
+    std::string records;
+    records.reserve(total);
+    for (size_t i = 0; i < payloads.size(); ++i) {
+        char header[RECORD_HEADER_SIZE];
+        putU32(header, static_cast<uint32_t>(payloads[i].size()));
+        putU64(header + 8, first_seq + i);
+        putU32(header + 4, recordChecksum(header + 8, payloads[i]));
+        records.append(header, RECORD_HEADER_SIZE);
+        records.append(payloads[i].data(), payloads[i].size());
+    }
+    
+    uint64_t position;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.append(records);
+        appended_position_ += records.size();
+        position = appended_position_;
+    }
+    records_.fetch_add(payloads.size(), std::memory_order_relaxed);
+    pending_cv_.notify_one();
+    return position;
+}
+
+bool WriteAheadLog::waitDurable(uint64_t position) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t* durable = mode_ == WalSyncMode::FSYNC ? &synced_position_ : &written_position_;
+    durable_cv_.wait(lock, [&] { return failed_ || !running_ || *durable >= position; });
+    return !failed_ && *durable >= position;
+}
+
+bool WriteAheadLog::pollDurable(uint64_t position, bool& durable) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    durable = (mode_ == WalSyncMode::FSYNC ? synced_position_ : written_position_) >= position;
+    return !failed_ && (durable || running_);
+}
+
+void WriteAheadLog::addDurableWatcher(int event_fd) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    durable_watchers_.push_back(event_fd);
+}
+
+void WriteAheadLog::removeDurableWatcher(int event_fd) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    durable_watchers_.erase(std::remove(durable_watchers_.begin(), durable_watchers_.end(), event_fd),
+                            durable_watchers_.end());
+}
+
+void WriteAheadLog::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    pending_cv_.notify_one();
+    if (flusher_.joinable()) {
+        flusher_.join();
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+        notifyWatchers();
+    }
+    durable_cv_.notify_all();
+    
+    if (fd_ != -1) {
+        ::close(fd_);
+        fd_ = -1;
+        Logger::logMessage("Write-ahead log " + path_ + " closed");
+    }
+}
+
+const std::string& WriteAheadLog::getPath() const {
+    return path_;
+}
+
+WalSyncMode WriteAheadLog::getSyncMode() const {
+    return mode_;
+}
+
+uint64_t WriteAheadLog::getDurablePosition() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return mode_ == WalSyncMode::FSYNC ? synced_position_ : written_position_;
+}
+
+uint64_t WriteAheadLog::getAppendedPosition() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return appended_position_;
+}
+
+size_t WriteAheadLog::getBatchCount() const {
+    return batches_.load(std::memory_order_relaxed);
+}
+
+size_t WriteAheadLog::getRecordCount() const {
+    return records_.load(std::memory_order_relaxed);
+}
+
+bool WriteAheadLog::parseSyncMode(const std::string& name, WalSyncMode& mode) {
+    if (name == "fsync") {
+        mode = WalSyncMode::FSYNC;
+    } else if (name == "interval") {
+        mode = WalSyncMode::INTERVAL;
+    } else if (name == "os") {
+        mode = WalSyncMode::OS;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* WriteAheadLog::syncModeToString(WalSyncMode mode) {
+    switch (mode) {
+        case WalSyncMode::FSYNC:
+            return "fsync";
+        case WalSyncMode::INTERVAL:
+            return "interval";
+        case WalSyncMode::OS:
+            return "os";
+        default:
+            return "unknown";
+    }
+}
+
+void WriteAheadLog::flushLoop() {
+    auto interval = std::chrono::milliseconds(sync_interval_ms_);
+    auto last_sync = std::chrono::steady_clock::now();
+    std::string batch;
+    
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        if (pending_.empty() && !stopping_) {
+            // In interval mode wake up in time to sync data written since the last sync
+            if (mode_ == WalSyncMode::INTERVAL && synced_position_ < written_position_) {
+                pending_cv_.wait_until(lock, last_sync + interval);
+            } else {
+                pending_cv_.wait(lock);
+            }
+        }
+        
+        // Everything queued so far goes out as one batch
+        bool stopping = stopping_;
+        uint64_t batch_end = appended_position_;
+        batch.swap(pending_);
+        lock.unlock();
+        
+        bool ok = true;
+        if (!batch.empty()) {
+            ok = writeAll(batch);
+            batch.clear();
+            batches_.fetch_add(1, std::memory_order_relaxed);
+        }
+        
+        // synced_position_ is only written by this thread
+        auto now = std::chrono::steady_clock::now();
+        bool sync = ok && synced_position_ < batch_end &&
+                    (mode_ == WalSyncMode::FSYNC || stopping ||
+                     (mode_ == WalSyncMode::INTERVAL && now - last_sync >= interval));
+        if (sync) {
+            ok = fdatasync(fd_) == 0;
+            last_sync = now;
+        }
+        
+        lock.lock();
+        uint64_t durable = mode_ == WalSyncMode::FSYNC ? synced_position_ : written_position_;
+        if (!ok) {
+            if (!failed_) {
+                Logger::logError("Write-ahead log " + path_ + " failed: " + strerror(errno));
+            }
+            failed_ = true;
+        } else {
+            written_position_ = batch_end;
+            if (sync) {
+                synced_position_ = batch_end;
+            }
+        }
+        durable_cv_.notify_all();
+        if (!ok || durable != (mode_ == WalSyncMode::FSYNC ? synced_position_ : written_position_)) {
+            notifyWatchers();
+        }
+        
+        if (stopping && pending_.empty()) {
+            break;
+        }
+    }
+}
+
+void WriteAheadLog::notifyWatchers() {
+    uint64_t one = 1;
+    for (int event_fd : durable_watchers_) {
+        while (write(event_fd, &one, sizeof(one)) == -1 && errno == EINTR) {
+        }
+    }
+}
+
+bool WriteAheadLog::writeAll(const std::string& data) {
+    size_t total_written = 0;
+    
+    while (total_written < data.size()) {
+        ssize_t written = write(fd_, data.data() + total_written, data.size() - total_written);
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        total_written += written;
+    }
+    return true;
+}
\ No newline at end of file